@@ -0,0 +1,90 @@
+#ifndef OPENMM_LTMD_BENCHMARK_H_
+#define OPENMM_LTMD_BENCHMARK_H_
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace LTMD {
+	namespace Benchmark {
+		/**
+		 * Timing loop of one benchmark at one problem size.
+		 *
+		 * The body is run while Running() returns true. The first pass is an untimed warm up,
+		 * each later pass is one sample. Work outside the loop is not timed.
+		 */
+		class State {
+			public:
+				State( const unsigned int size, const unsigned int iterations );
+
+				unsigned int Size() const {
+					return mSize;
+				}
+
+				bool Running();
+
+				/**
+				 * Attach a value to the result, such as force evaluations per step.
+				 */
+				void SetCounter( const std::string &name, const double value ) {
+					mCounters[name] = value;
+				}
+
+				const std::vector<double> &Samples() const {
+					return mSamples;
+				}
+
+				const std::map<std::string, double> &Counters() const {
+					return mCounters;
+				}
+			private:
+				unsigned int mSize, mIterations, mPass;
+				uint64_t mStart;
+				std::vector<double> mSamples;
+				std::map<std::string, double> mCounters;
+		};
+
+		typedef void ( *Function )( State &state );
+
+		struct Result {
+			std::string Name;
+			unsigned int Size, Iterations;
+			double Mean, Median, Minimum, Maximum, Deviation; // ms
+			std::map<std::string, double> Counters;
+		};
+
+		/**
+		 * Registry of benchmarks, each run once per problem size.
+		 */
+		class Suite {
+			public:
+				static Suite &Instance();
+
+				void Add( const std::string &name, const std::vector<unsigned int> &sizes, const Function function );
+
+				/**
+				 * Run every benchmark whose name contains filter.
+				 */
+				std::vector<Result> Run( const std::string &filter, const unsigned int iterations ) const;
+
+				static std::string ToJSON( const std::vector<Result> &results );
+			private:
+				struct Entry {
+					std::string Name;
+					std::vector<unsigned int> Sizes;
+					Function Call;
+				};
+			private:
+				std::vector<Entry> mEntries;
+		};
+
+		struct Registration {
+			Registration( const std::string &name, const std::vector<unsigned int> &sizes, const Function function ) {
+				Suite::Instance().Add( name, sizes, function );
+			}
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_BENCHMARK_H_
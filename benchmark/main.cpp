@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Benchmark.h"
+
+// Usage: LTMDBenchmark [--filter name] [--iterations count] [--output results.json]
+int main( int argc, char *argv[] ) {
+	std::string filter = "", output = "benchmark.json";
+	unsigned int iterations = 10;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( std::strcmp( argv[i], "--filter" ) == 0 && i + 1 < argc ) {
+			filter = argv[++i];
+		} else if( std::strcmp( argv[i], "--iterations" ) == 0 && i + 1 < argc ) {
+			iterations = std::atoi( argv[++i] );
+		} else if( std::strcmp( argv[i], "--output" ) == 0 && i + 1 < argc ) {
+			output = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--filter name] [--iterations count] [--output results.json]" << std::endl;
+			return 1;
+		}
+	}
+
+	const std::vector<LTMD::Benchmark::Result> results = LTMD::Benchmark::Suite::Instance().Run( filter, iterations );
+
+	std::ofstream file( output.c_str() );
+	if( !file ) {
+		std::cerr << "Unable to open " << output << std::endl;
+		return 1;
+	}
+	file << LTMD::Benchmark::Suite::ToJSON( results );
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+
+#include <cmath>
+#include <fstream>
+
+#include "LTMD/Analysis.h"
+
+using OpenMM::LTMD::Analysis;
+using OpenMM::LTMD::Block;
+using OpenMM::Vec3;
+
+namespace LTMD {
+	namespace Benchmark {
+		// Synthetic block of size / 3 carbon atoms along a helix with a diagonally dominant Hessian
+		static void SyntheticBlock( const unsigned int size, Block &block, std::vector<Vec3> &positions, std::vector<double> &masses ) {
+			const unsigned int atoms = size / 3;
+
+			positions.resize( atoms );
+			masses.assign( atoms, 12.011 );
+			for( unsigned int i = 0; i < atoms; i++ ) {
+				positions[i] = Vec3( 0.23 * std::cos( 1.745 * i ), 0.23 * std::sin( 1.745 * i ), 0.15 * i );
+			}
+
+			block = Block( 0, size - 1 );
+			for( unsigned int i = 0; i < size; i++ ) {
+				for( unsigned int j = 0; j <= i; j++ ) {
+					const double value = ( i == j ) ? 1000.0 + i : 100.0 * std::sin( 1.0 + i * 7.0 + j * 3.0 );
+					block.Data( i, j ) = value;
+					block.Data( j, i ) = value;
+				}
+			}
+		}
+
+		// test/data/block.txt and the matching positions and masses, as used by AnalysisTest
+		static bool ReadBlock( Block &block, std::vector<Vec3> &positions, std::vector<double> &masses ) {
+			std::ifstream sBlock( "data/block.txt" );
+			std::ifstream sPos( "data/block_positions.txt" );
+			std::ifstream sMass( "data/block_masses.txt" );
+			if( !sBlock.good() || !sPos.good() || !sMass.good() ) {
+				return false;
+			}
+
+			unsigned int width = 0, height = 0;
+			sBlock >> width >> height;
+
+			block = Block( 0, width - 1 );
+			for( unsigned int i = 0; i < width; i++ ) {
+				for( unsigned int j = 0; j < height; j++ ) {
+					sBlock >> block.Data( i, j );
+				}
+			}
+
+			unsigned int atoms = 0;
+			sPos >> atoms;
+			positions.resize( atoms );
+			for( unsigned int i = 0; i < atoms; i++ ) {
+				sPos >> positions[i][0] >> positions[i][1] >> positions[i][2];
+			}
+
+			unsigned int count = 0;
+			sMass >> count;
+			masses.resize( count );
+			for( unsigned int i = 0; i < count; i++ ) {
+				sMass >> masses[i];
+			}
+
+			return true;
+		}
+
+		static void Diagonalize( State &state, const Block &block, const std::vector<Vec3> &positions, const std::vector<double> &masses ) {
+			const unsigned int size = block.Data.Rows;
+
+			std::vector<double> eval( size );
+			Matrix evec( size, size );
+
+			while( state.Running() ) {
+				Analysis::DiagonalizeBlock( block, positions, masses, eval, evec );
+			}
+		}
+
+		static void DiagonalizeBlockBenchmark( State &state ) {
+			Block block;
+			std::vector<Vec3> positions;
+			std::vector<double> masses;
+			SyntheticBlock( state.Size(), block, positions, masses );
+
+			Diagonalize( state, block, positions, masses );
+		}
+
+		static void DiagonalizeBlockDataBenchmark( State &state ) {
+			Block block;
+			std::vector<Vec3> positions;
+			std::vector<double> masses;
+			if( !ReadBlock( block, positions, masses ) ) {
+				return;
+			}
+
+			Diagonalize( state, block, positions, masses );
+		}
+
+		// GeometricDOF overwrites its input, each pass restores the block eigensystem first
+		static void GeometricDOFBenchmark( State &state ) {
+			Block block;
+			std::vector<Vec3> positions;
+			std::vector<double> masses;
+			SyntheticBlock( state.Size(), block, positions, masses );
+
+			const unsigned int size = block.Data.Rows;
+			std::vector<double> values( size );
+			Matrix vectors( size, size );
+			Analysis::DiagonalizeBlock( block, positions, masses, values, vectors );
+
+			std::vector<double> eval( size );
+			Matrix evec( size, size );
+
+			while( state.Running() ) {
+				eval = values;
+				evec = vectors;
+				Analysis::GeometricDOF( size, 0, size, positions, masses, eval, evec );
+			}
+		}
+
+		static Registration sDiagonalizeBlock( "Analysis::DiagonalizeBlock", { 96, 192, 384 }, DiagonalizeBlockBenchmark );
+		static Registration sDiagonalizeBlockData( "Analysis::DiagonalizeBlock/data", { 72 }, DiagonalizeBlockDataBenchmark );
+		static Registration sGeometricDOF( "Analysis::GeometricDOF", { 96, 192, 384 }, GeometricDOFBenchmark );
+	}
+}
@@ -0,0 +1,135 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace LTMD {
+	namespace Benchmark {
+		static uint64_t Now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+		}
+
+		State::State( const unsigned int size, const unsigned int iterations ) : mSize( size ), mIterations( std::max( iterations, 1u ) ), mPass( 0 ), mStart( 0 ) {
+
+		}
+
+		bool State::Running() {
+			const uint64_t now = Now();
+
+			// The body run after pass 0 is the warm up, each later body is one sample
+			if( mPass > 1 ) {
+				mSamples.push_back( ( now - mStart ) * 1e-6 );
+			}
+
+			if( mPass++ == mIterations + 1 ) {
+				return false;
+			}
+
+			mStart = Now();
+			return true;
+		}
+
+		Suite &Suite::Instance() {
+			static Suite instance;
+			return instance;
+		}
+
+		void Suite::Add( const std::string &name, const std::vector<unsigned int> &sizes, const Function function ) {
+			const Entry entry = { name, sizes, function };
+			mEntries.push_back( entry );
+		}
+
+		static Result Summarize( const std::string &name, const State &state ) {
+			std::vector<double> samples = state.Samples();
+			std::sort( samples.begin(), samples.end() );
+
+			Result retVal;
+			retVal.Name = name;
+			retVal.Size = state.Size();
+			retVal.Iterations = samples.size();
+			retVal.Mean = retVal.Median = retVal.Minimum = retVal.Maximum = retVal.Deviation = 0.0;
+			retVal.Counters = state.Counters();
+
+			if( samples.empty() ) {
+				return retVal;
+			}
+
+			double sum = 0.0;
+			for( size_t i = 0; i < samples.size(); i++ ) {
+				sum += samples[i];
+			}
+			retVal.Mean = sum / samples.size();
+
+			double variance = 0.0;
+			for( size_t i = 0; i < samples.size(); i++ ) {
+				variance += ( samples[i] - retVal.Mean ) * ( samples[i] - retVal.Mean );
+			}
+			retVal.Deviation = std::sqrt( variance / samples.size() );
+
+			const size_t middle = samples.size() / 2;
+			retVal.Median = ( samples.size() % 2 == 1 ) ? samples[middle] : 0.5 * ( samples[middle - 1] + samples[middle] );
+			retVal.Minimum = samples.front();
+			retVal.Maximum = samples.back();
+
+			return retVal;
+		}
+
+		std::vector<Result> Suite::Run( const std::string &filter, const unsigned int iterations ) const {
+			std::vector<Result> retVal;
+
+			for( size_t i = 0; i < mEntries.size(); i++ ) {
+				const Entry &entry = mEntries[i];
+				if( entry.Name.find( filter ) == std::string::npos ) {
+					continue;
+				}
+
+				for( size_t j = 0; j < entry.Sizes.size(); j++ ) {
+					State state( entry.Sizes[j], iterations );
+					entry.Call( state );
+
+					const Result result = Summarize( entry.Name, state );
+					std::cout << entry.Name << "/" << result.Size << ": " << result.Median << "ms median, " << result.Minimum << "ms min" << std::endl;
+
+					retVal.push_back( result );
+				}
+			}
+
+			return retVal;
+		}
+
+		std::string Suite::ToJSON( const std::vector<Result> &results ) {
+			std::ostringstream stream;
+			stream.precision( 15 );
+
+			unsigned int threads = 1;
+#ifdef _OPENMP
+			threads = omp_get_max_threads();
+#endif
+
+			stream << "{\n\t\"context\": { \"threads\": " << threads << " },\n\t\"benchmarks\": [";
+			for( size_t i = 0; i < results.size(); i++ ) {
+				const Result &result = results[i];
+
+				stream << ( i == 0 ? "\n" : ",\n" );
+				stream << "\t\t{ \"name\": \"" << result.Name << "\", \"size\": " << result.Size << ", \"iterations\": " << result.Iterations
+					   << ", \"mean_ms\": " << result.Mean << ", \"median_ms\": " << result.Median << ", \"min_ms\": " << result.Minimum
+					   << ", \"max_ms\": " << result.Maximum << ", \"stddev_ms\": " << result.Deviation << ", \"counters\": {";
+
+				for( std::map<std::string, double>::const_iterator it = result.Counters.begin(); it != result.Counters.end(); ++it ) {
+					stream << ( it == result.Counters.begin() ? " " : ", " ) << "\"" << it->first << "\": " << it->second;
+				}
+				stream << ( result.Counters.empty() ? "} }" : " } }" );
+			}
+			stream << "\n\t]\n}\n";
+
+			return stream.str();
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+
+#include <memory>
+
+#include "OpenMM.h"
+#include "LTMD/Integrator.h"
+#include "LTMD/Parameters.h"
+#include "LTMD/SyntheticSystem.h"
+
+using namespace OpenMM;
+using OpenMM::LTMD::SyntheticSystem;
+
+// Provided by the LTMDReference plugin, which the benchmark links directly
+extern "C" void registerKernelFactories();
+
+namespace LTMD {
+	namespace Benchmark {
+		static void Register() {
+			static bool registered = false;
+			if( !registered ) {
+				registerKernelFactories();
+				registered = true;
+			}
+		}
+
+		// Chain of pseudo-residues with one residue per block
+		static void Configure( const SyntheticSystem &synthetic, OpenMM::LTMD::Parameters &params ) {
+			synthetic.Configure( params, 1, 12, 10 );
+			params.rediagFreq = 1000000;
+		}
+
+		// One LTMD step on the Reference platform, the warm up pass diagonalizes
+		static void StepBenchmark( State &state ) {
+			Register();
+
+			const SyntheticSystem synthetic( state.Size() );
+			std::unique_ptr<System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Parameters params;
+			Configure( synthetic, params );
+
+			OpenMM::LTMD::Integrator integrator( 300.0, 91.0, 0.004, params );
+			Context context( *system, integrator, Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+			context.setVelocitiesToTemperature( 300.0, 1 );
+
+			unsigned int steps = 0, evaluations = 0, energyEvaluations = 0;
+			while( state.Running() ) {
+				integrator.step( 1 );
+
+				if( steps++ == 0 ) {
+					evaluations = integrator.getForceEvaluations();
+					energyEvaluations = integrator.getEnergyEvaluations();
+				}
+			}
+
+			if( steps > 1 ) {
+				state.SetCounter( "force_evaluations_per_step", ( double )( integrator.getForceEvaluations() - evaluations ) / ( steps - 1 ) );
+				state.SetCounter( "energy_evaluations_per_step", ( double )( integrator.getEnergyEvaluations() - energyEvaluations ) / ( steps - 1 ) );
+			}
+		}
+
+		// Block Hessian, block diagonalization and the S, Q and U stages
+		static void Rediagonalize( State &state, const OpenMM::LTMD::Preference::ERediagonalization method ) {
+			Register();
+
+			const SyntheticSystem synthetic( state.Size() );
+			std::unique_ptr<System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Parameters params;
+			Configure( synthetic, params );
+			params.Rediagonalization = method;
+
+			OpenMM::LTMD::Integrator integrator( 300.0, 91.0, 0.004, params );
+			Context context( *system, integrator, Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+
+			state.SetCounter( "estimated_bytes", ( double )( method == OpenMM::LTMD::Preference::Lean ? integrator.getResourceEstimate().LeanBytes : integrator.getResourceEstimate().FullBytes ) );
+
+			while( state.Running() ) {
+				integrator.Rediagonalize();
+			}
+		}
+
+		static void RediagonalizeBenchmark( State &state ) {
+			Rediagonalize( state, OpenMM::LTMD::Preference::Full );
+		}
+
+		static void RediagonalizeLeanBenchmark( State &state ) {
+			Rediagonalize( state, OpenMM::LTMD::Preference::Lean );
+		}
+
+		static Registration sStep( "Integrator::step", { 200, 1000, 5000 }, StepBenchmark );
+		static Registration sRediagonalize( "Analysis::computeEigenvectorsFull", { 200, 500, 1500 }, RediagonalizeBenchmark );
+		static Registration sRediagonalizeLean( "Analysis::computeEigenvectorsLean", { 200, 500, 1500, 5000 }, RediagonalizeLeanBenchmark );
+	}
+}
@@ -0,0 +1,47 @@
+#include "Benchmark.h"
+
+#include <cmath>
+
+#include "LTMD/Math.h"
+
+namespace LTMD {
+	namespace Benchmark {
+		// Deterministic symmetric matrix with a dominant diagonal
+		static Matrix Symmetric( const unsigned int size ) {
+			Matrix retVal( size, size );
+			for( unsigned int i = 0; i < size; i++ ) {
+				for( unsigned int j = 0; j <= i; j++ ) {
+					const double value = ( i == j ) ? size + i : std::sin( 1.0 + i * 7.0 + j * 3.0 );
+					retVal( i, j ) = value;
+					retVal( j, i ) = value;
+				}
+			}
+			return retVal;
+		}
+
+		static void MatrixMultiplyBenchmark( State &state ) {
+			const unsigned int size = state.Size();
+			const Matrix a = Symmetric( size ), b = Symmetric( size );
+			Matrix c( size, size );
+
+			while( state.Running() ) {
+				MatrixMultiply( a, true, b, false, c );
+			}
+		}
+
+		static void FindEigenvaluesBenchmark( State &state ) {
+			const unsigned int size = state.Size();
+			const Matrix matrix = Symmetric( size );
+
+			std::vector<double> values( size );
+			Matrix vectors( size, size );
+
+			while( state.Running() ) {
+				FindEigenvalues( matrix, values, vectors );
+			}
+		}
+
+		static Registration sMatrixMultiply( "Math::MatrixMultiply", { 64, 256, 1024 }, MatrixMultiplyBenchmark );
+		static Registration sFindEigenvalues( "Math::FindEigenvalues", { 64, 256, 1024 }, FindEigenvaluesBenchmark );
+	}
+}
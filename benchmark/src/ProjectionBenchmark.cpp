@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+
+#include <cmath>
+
+#include "LTMD/Projection.h"
+
+using OpenMM::LTMD::ModeBasis;
+using OpenMM::LTMD::Projection;
+
+namespace LTMD {
+	namespace Benchmark {
+		const unsigned int Modes = 10;
+
+		// The projection the Reference kernel applies to velocities and forces every step,
+		// for size particles and Modes modes
+		static void Project( State &state, const bool singlePrecision ) {
+			const unsigned int particles = state.Size();
+
+			ModeBasis basis( Modes, particles );
+			for( unsigned int i = 0; i < Modes; i++ ) {
+				double *mode = basis.Mode( i );
+				for( size_t j = 0; j < basis.Degrees(); j++ ) {
+					mode[j] = std::sin( 1.0 + i * 0.37 + j * 0.011 );
+				}
+			}
+
+			Projection projection;
+			projection.SetSinglePrecision( singlePrecision );
+			projection.SetMasses( std::vector<double>( particles, 12.011 ) );
+			projection.SetBasis( basis );
+
+			std::vector<double> in( 3 * particles ), out( 3 * particles );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				in[i] = std::cos( 0.5 + i * 0.013 );
+			}
+
+			while( state.Running() ) {
+				projection.Project( &in[0], &out[0], Projection::Mass, true );
+			}
+		}
+
+		static void ProjectBenchmark( State &state ) {
+			Project( state, false );
+		}
+
+		static void ProjectSingleBenchmark( State &state ) {
+			Project( state, true );
+		}
+
+		static Registration sProject( "Projection::Project", { 1000, 10000, 100000 }, ProjectBenchmark );
+		static Registration sProjectSingle( "Projection::Project/single", { 1000, 10000, 100000 }, ProjectSingleBenchmark );
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef OPENMM_LTMD_ALIGNED_H_
+#define OPENMM_LTMD_ALIGNED_H_
+
+#include <stddef.h>
+
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		// Alignment of matrix and mode storage, one cache line and one AVX-512 register
+		const size_t AlignmentBytes = 64;
+
+		/**
+		 * Allocate bytes starting on an AlignmentBytes boundary, release with AlignedFree.
+		 * Inside an Arena::Scope large requests are served by the arena. Throws
+		 * std::bad_alloc on failure.
+		 */
+		OPENMM_EXPORT void *AlignedAllocate( const size_t bytes );
+		OPENMM_EXPORT void AlignedFree( void *memory );
+
+		/**
+		 * Standard allocator handing out AlignedAllocate storage, for std::vector.
+		 */
+		template<typename T>
+		struct AlignedAllocator {
+			typedef T value_type;
+
+			AlignedAllocator() {}
+
+			template<typename U>
+			AlignedAllocator( const AlignedAllocator<U> & ) {}
+
+			T *allocate( const size_t count ) {
+				return static_cast<T *>( AlignedAllocate( count * sizeof( T ) ) );
+			}
+
+			void deallocate( T *memory, const size_t ) {
+				AlignedFree( memory );
+			}
+		};
+
+		template<typename T, typename U>
+		bool operator==( const AlignedAllocator<T> &, const AlignedAllocator<U> & ) {
+			return true;
+		}
+
+		template<typename T, typename U>
+		bool operator!=( const AlignedAllocator<T> &, const AlignedAllocator<U> & ) {
+			return false;
+		}
+	}
+}
+
+#endif // OPENMM_LTMD_ALIGNED_H_
@@ -7,16 +7,20 @@
 
 #include "OpenMM.h"
 #include "LTMD/Parameters.h"
+#include "LTMD/Arena.h"
+#include "LTMD/BlockPreconditioner.h"
 #include "LTMD/Matrix.h"
+#include "LTMD/ModeBasis.h"
+#include "LTMD/Profiler.h"
 
 namespace OpenMM {
 	namespace LTMD {
 		struct Block {
 			unsigned int StartAtom, EndAtom;
-			Matrix Data;
+			SymmetricMatrix Data;
 
 			Block() : StartAtom( 0 ), EndAtom( 0 ), Data() {}
-			Block( size_t start, size_t end ) : StartAtom( start ), EndAtom( end ), Data( end - start + 1, end - start + 1 ) {}
+			Block( size_t start, size_t end ) : StartAtom( start ), EndAtom( end ), Data( end - start + 1 ) {}
 		};
 
 		typedef std::vector<double> EigenvalueArray;
@@ -24,7 +28,7 @@ namespace OpenMM {
 
 		class OPENMM_EXPORT Analysis {
 			public:
-				Analysis() : mParticleCount( 0 ), mLargestBlockSize( -1 ) {
+				Analysis() : mParticleCount( 0 ), mLargestBlockSize( -1 ), mMethod( Preference::Full ), mProfiler( NULL ), mArena( NULL ) {
 					mInitialized = false;
 					blockContext = NULL;
 				}
@@ -33,9 +37,29 @@ namespace OpenMM {
 						delete blockContext;
 					}
 				}
+				void SetProfiler( Profiler *profiler ) {
+					mProfiler = profiler;
+				}
+				/**
+				 * Storage used by computeEigenvectors, see ResourceEstimate.
+				 */
+				void SetMethod( const Preference::ERediagonalization method ) {
+					mMethod = method;
+				}
+				/**
+				 * Serve the large buffers of computeEigenvectors from arena, NULL for the system.
+				 */
+				void SetArena( Arena *arena ) {
+					mArena = arena;
+				}
+				void computeEigenvectors( Context &context, const Parameters &params );
 				void computeEigenvectorsFull( Context &contextImpl, const Parameters &params );
-				const std::vector<std::vector<Vec3> > &getEigenvectors() const {
-					return eigenvectors;
+				void computeEigenvectorsLean( Context &context, const Parameters &params );
+				ModeBasisPtr getModeBasis() const {
+					return mModeBasis;
+				}
+				BlockPreconditionerPtr getBlockPreconditioner() const {
+					return mBlockPreconditioner;
 				}
 				unsigned int blockNumber( int );
 				bool inSameBlock( int, int, int, int );
@@ -44,9 +68,24 @@ namespace OpenMM {
 				static std::vector<EigenvalueColumn> SortEigenvalues( const EigenvalueArray &values );
 
 				void Initialize( Context &context, const Parameters &ltmd );
-				void DiagonalizeBlocks( const Matrix &hessian, const std::vector<Vec3> &positions, std::vector<double> &eval, Matrix &evec );
+				void DiagonalizeBlocks( const Matrix &hessian, const std::vector<Vec3> &positions, std::vector<double> &eval, Matrix &evec, BlockPreconditioner *preconditioner = NULL );
 				static void DiagonalizeBlock( const Block &block, const std::vector<Vec3> &positions, const std::vector<double> &Mass, std::vector<double> &eval, Matrix &evec );
 				static void GeometricDOF( const int size, const int start, const int end, const std::vector<Vec3> &positions, const std::vector<double> &Mass, std::vector<double> &eval, Matrix &evec );
+
+				/**
+				 * Split blocks of the given degrees of freedom into at most workers contiguous
+				 * shards of similar cost. Returns the first block of each shard followed by the
+				 * block count.
+				 */
+				static std::vector<size_t> Shards( const std::vector<size_t> &sizes, const size_t workers );
+			private:
+				System *CreateBlockSystem( const System &system, const Parameters &params, const size_t first, const size_t last );
+				void ComputeBlockHessian( Context &blockSystem, const std::vector<Vec3> &positions, const Parameters &params, const size_t first, const size_t last, std::vector<Block> &hessian );
+				void DiagonalizeLocalBlock( Block &block, const std::vector<Vec3> &positions, std::vector<double> &values, Matrix &vectors, std::vector<double> *rawValues, Matrix *rawVectors ) const;
+				void DiagonalizeShard( const System &system, const std::vector<Vec3> &positions, const Parameters &params, const size_t first, const size_t last,
+									   const std::vector<size_t> &offset, const bool precondition, double *region );
+				void DiagonalizeShards( const System &system, const std::vector<Vec3> &positions, const Parameters &params, std::vector<size_t> &start,
+										std::vector<double> &eval, std::vector<Matrix> &evec, BlockPreconditioner *preconditioner );
 			private:
 				unsigned int mParticleCount;
 				std::vector<double> mParticleMass;
@@ -56,9 +95,13 @@ namespace OpenMM {
 				std::vector<std::pair<int, int> > bonds;
 				std::vector<std::vector<int> > particleBonds;
 				std::vector<std::vector<double> > projection;
-				std::vector<std::vector<Vec3> > eigenvectors;
+				ModeBasisPtr mModeBasis;
+				BlockPreconditionerPtr mBlockPreconditioner;
 				Context *blockContext;
 				std::vector<int> blocks;
+				Preference::ERediagonalization mMethod;
+				Profiler *mProfiler;
+				Arena *mArena;
 		};
 	}
 }
@@ -0,0 +1,90 @@
+#ifndef OPENMM_LTMD_ARENA_H_
+#define OPENMM_LTMD_ARENA_H_
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Cache of large aligned blocks kept between rediagonalizations.
+		 *
+		 * While an Arena::Scope is active on a thread, AlignedAllocate requests of at least
+		 * MinimumBytes made on that thread, which covers every Matrix and SymmetricMatrix,
+		 * are served by the arena. Freed blocks return to it rather than to the system and
+		 * the next request of a similar size reuses one, so repeated rediagonalizations of
+		 * the same system stop page faulting fresh memory. Trim returns the blocks that
+		 * were not reused since the previous Trim.
+		 *
+		 * Blocks may be freed on any thread and after their scope has ended. Blocks still
+		 * in use when the arena is destroyed are handed back to the system when freed.
+		 */
+		class OPENMM_EXPORT Arena {
+			public:
+				// Smaller requests are not worth caching
+				static const size_t MinimumBytes = 64 * 1024;
+
+				// Blocks at least this large are transparent huge page aligned when enabled
+				static const size_t HugePageBytes = 2 * 1024 * 1024;
+
+				struct Statistics {
+					size_t InUseBytes, PeakBytes, ReservedBytes;
+					uint64_t Allocations, Reused;
+				};
+
+				/**
+				 * Makes the arena current on this thread for its lifetime, NULL disables any
+				 * arena. Scopes nest.
+				 */
+				class OPENMM_EXPORT Scope {
+					public:
+						Scope( Arena *arena );
+						~Scope();
+					private:
+						Scope( const Scope & );
+						Scope &operator=( const Scope & );
+					private:
+						Arena *mPrevious;
+				};
+
+				Arena( const bool hugePages = false );
+				~Arena();
+
+				static Arena *Current();
+
+				/**
+				 * Release cached blocks not handed out since the previous Trim.
+				 */
+				void Trim();
+
+				Statistics GetStatistics() const;
+				std::string Report() const;
+			private:
+				Arena( const Arena & );
+				Arena &operator=( const Arena & );
+
+				friend void *AlignedAllocate( const size_t bytes );
+				friend void AlignedFree( void *memory );
+
+				struct Header;
+
+				void *Allocate( const size_t bytes );
+				void Release( Header *header );
+			private:
+				const bool mHugePages;
+				uint64_t mGeneration;
+				Statistics mStatistics;
+				std::multimap<size_t, Header *> mFree;
+				std::set<Header *> mUsed;
+				mutable std::mutex mMutex;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_ARENA_H_
@@ -0,0 +1,67 @@
+#ifndef OPENMM_LTMD_BLOCKPRECONDITIONER_H_
+#define OPENMM_LTMD_BLOCKPRECONDITIONER_H_
+
+#include <memory>
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/Matrix.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Inverse of the block diagonal mass weighted Hessian, kept from the block
+		 * diagonalization of the last rediagonalization.
+		 *
+		 * Each block's eigenvalues are replaced by 1/max( |lambda|, floor ) so soft directions,
+		 * which the mode space mostly covers, cannot produce huge steps. Degrees of freedom
+		 * outside every block are scaled by 1/floor.
+		 */
+		class OPENMM_EXPORT BlockPreconditioner {
+			public:
+				BlockPreconditioner( const size_t degrees = 0, const size_t blocks = 0 );
+
+				size_t Degrees() const {
+					return mDegrees;
+				}
+
+				size_t Blocks() const {
+					return mBlocks.size();
+				}
+
+				/**
+				 * Store block index covering degrees [start, start + values.size()). Distinct
+				 * blocks may be set concurrently.
+				 */
+				void SetBlock( const size_t index, const size_t start, const std::vector<double> &values, const Matrix &vectors );
+
+				/**
+				 * Curvature below which eigenvalues are clamped, applies to every block.
+				 */
+				void SetFloor( const double floor );
+
+				double Floor() const {
+					return mFloor;
+				}
+
+				/**
+				 * out = H^-1 in, may be the same array as in.
+				 */
+				void Apply( const double *in, double *out ) const;
+			private:
+				struct Eigensystem {
+					size_t Start, Size;
+					std::vector<double> Values, Vectors;
+				};
+			private:
+				size_t mDegrees;
+				double mFloor;
+				std::vector<Eigensystem> mBlocks;
+				std::vector<char> mCovered;
+		};
+
+		typedef std::shared_ptr<const BlockPreconditioner> BlockPreconditionerPtr;
+	}
+}
+
+#endif // OPENMM_LTMD_BLOCKPRECONDITIONER_H_
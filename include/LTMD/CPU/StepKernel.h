@@ -0,0 +1,88 @@
+#ifndef OPENMM_LTMD_CPU_STEPKERNEL_H_
+#define OPENMM_LTMD_CPU_STEPKERNEL_H_
+
+#include "LTMD/Aligned.h"
+#include "LTMD/StepKernel.h"
+#include "LTMD/Random.h"
+#include "LTMD/Projection.h"
+
+#include "ReferencePlatform.h"
+#include "RealVec.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		namespace CPU {
+			typedef std::vector<double, AlignedAllocator<double> > DoubleArray;
+
+			/**
+			 * Step kernel for OpenMM's CPU platform. The CPU platform keeps positions, velocities
+			 * and forces in the Reference platform's arrays, which this kernel updates in place.
+			 * Every per atom loop runs over the 3N flattened coordinates with per coordinate
+			 * mass factors, so it vectorizes, and is split with OpenMP across as many threads as
+			 * the platform uses, so the plugin requires BUILD_OPENMP. Positions are double
+			 * buffered so accepting or rejecting a minimizer step does not copy them.
+			 *
+			 * Noise comes from the same counter based generator as the Reference kernel, so both
+			 * kernels take the same trajectory from the same seed.
+			 */
+			class StepKernel : public LTMD::StepKernel {
+				public:
+					StepKernel( std::string name, const OpenMM::Platform &platform, OpenMM::ReferencePlatform::PlatformData &data, const int threads );
+					~StepKernel();
+
+					/**
+					 * Initialize the kernel, setting up the particle masses.
+					 *
+					 * @param system     the System this kernel will be applied to
+					 * @param integrator the NMLIntegrator this kernel will be used for
+					 */
+					void initialize( const OpenMM::System &system, const Integrator &integrator );
+
+					void Integrate( OpenMM::ContextImpl &context, const Integrator &integrator );
+					void UpdateTime( const Integrator &integrator );
+
+					void AcceptStep( OpenMM::ContextImpl &context );
+					void RejectStep( OpenMM::ContextImpl &context );
+
+					void LinearMinimize( OpenMM::ContextImpl &context, const Integrator &integrator, const double energy );
+					double QuadraticMinimize( OpenMM::ContextImpl &context, const Integrator &integrator, const double energy );
+					void updateState( OpenMM::ContextImpl &context ) {}
+
+					// The CPU platform restores its forces after an energy only evaluation
+					bool SupportsEnergyOnlyTrials() const {
+						return true;
+					}
+					double computeKineticEnergy( OpenMM::ContextImpl &context, const Integrator &integrator );
+				private:
+					void Project( const Integrator &integrator, const double *in, double *out, const Projection::EWeight weight, const bool compliment );
+
+					double *Positions();
+
+					// Buffer a move of the positions is written to, and its completion
+					double *MoveTarget();
+					void CommitMove();
+					double *Velocities();
+					double *Forces();
+				private:
+					unsigned int mParticles;
+					long long mDegrees;
+					int mThreads;
+					bool mShouldPrefillNoise, mHasPreviousPositions;
+					double mPreviousEnergy, mMinimizerScale;
+
+					// Per coordinate 1/m and 1/sqrt(m), x0 y0 z0 x1 ...
+					DoubleArray mInverseMasses, mInverseRootMasses;
+					DoubleArray mXPrime;
+
+					// Spare position buffer, swapped with the context's by the minimizer
+					std::vector<OpenMM::RealVec> mPreviousPositions;
+					std::vector<double> mMasses;
+					Random mRandom;
+					Projection mProjection;
+					OpenMM::ReferencePlatform::PlatformData &data;
+			};
+		}
+	}
+}
+
+#endif // OPENMM_LTMD_CPU_STEPKERNEL_H_
@@ -31,6 +31,9 @@ namespace OpenMM {
 
 					void Integrate( OpenMM::ContextImpl &context, const Integrator &integrator );
 					void UpdateTime( const Integrator &integrator );
+					bool ReordersAtoms() const {
+						return true;
+					}
 					void setOldPositions( );
 					void AcceptStep( OpenMM::ContextImpl &context );
 					void RejectStep( OpenMM::ContextImpl &context );
@@ -45,6 +48,7 @@ namespace OpenMM {
 					void ProjectionVectors( const Integrator &integrator );
 				private:
 					unsigned int mParticles;
+					uint64_t mModeVersion;
 					OpenMM::CudaPlatform::PlatformData &data;
 					CudaArray *modes, *NoiseValues;
 					CudaArray *modeWeights;
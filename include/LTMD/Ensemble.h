@@ -0,0 +1,96 @@
+#ifndef OPENMM_LTMD_ENSEMBLE_H_
+#define OPENMM_LTMD_ENSEMBLE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "openmm/Context.h"
+#include "openmm/Platform.h"
+#include "openmm/System.h"
+#include "openmm/Vec3.h"
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/Integrator.h"
+#include "LTMD/Parameters.h"
+#include "LTMD/ProjectionBatch.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Independent replicas of one system advanced in lockstep with a shared mode basis.
+		 *
+		 * Replica 0 rediagonalizes every rediagFreq steps and its basis and preconditioner are
+		 * handed to the others, which never diagonalize on their own unless a minimization
+		 * fails. Between rediagonalizations each replica steps on its own standard thread and
+		 * the projections inside the Reference and CPU kernels are gathered by a
+		 * ProjectionBatch, so each phase projects the velocities or forces of all K replicas
+		 * with one pass over the 3N x modes basis rather than K. A replica that falls back to
+		 * its own modes leaves the batch until the next share. Without sharing each replica
+		 * keeps and refreshes its own basis and the replicas run at most one per core.
+		 *
+		 * OpenMM evaluates forces per Context and has no batched evaluation across Contexts,
+		 * so the force evaluations of the replicas are batched only in time: they run
+		 * concurrently, one Context per thread. The CUDA kernel projects on the device and
+		 * does not batch.
+		 */
+		class OPENMM_EXPORT Ensemble {
+			public:
+				Ensemble( const System &system, const Parameters &params, const unsigned int replicas, const double temperature, const double frictionCoeff, const double stepSize, Platform &platform, const bool shouldShareBasis = true );
+				~Ensemble();
+
+				unsigned int Replicas() const {
+					return mIntegrators.size();
+				}
+
+				Integrator &GetIntegrator( const unsigned int replica ) {
+					return *mIntegrators[replica];
+				}
+
+				Context &GetContext( const unsigned int replica ) {
+					return *mContexts[replica];
+				}
+
+				/**
+				 * Set the positions of every replica.
+				 */
+				void SetPositions( const std::vector<Vec3> &positions );
+
+				/**
+				 * Advance every replica by steps time steps.
+				 */
+				void Step( const unsigned int steps );
+
+				/**
+				 * Rediagonalize replica 0 at its current positions and share the result.
+				 */
+				void ShareBasis();
+
+				/**
+				 * Number of batched projections and of replica projections they held since
+				 * construction, equal when nothing was batched.
+				 */
+				uint64_t Batches() const {
+					return mBatches;
+				}
+
+				uint64_t BatchedProjections() const {
+					return mBatchedProjections;
+				}
+			private:
+				Ensemble( const Ensemble & );
+				Ensemble &operator=( const Ensemble & );
+
+				void StepReplicas( const unsigned int steps );
+				void StepReplica( const unsigned int replica, const unsigned int steps, ProjectionBatch *batch );
+			private:
+				Parameters mParameters;
+				bool mShouldShareBasis;
+				unsigned int mStepsSinceShare;
+				std::vector<Integrator *> mIntegrators;
+				std::vector<Context *> mContexts;
+				std::vector<double> mMasses;
+				uint64_t mBatches, mBatchedProjections;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_ENSEMBLE_H_
@@ -7,12 +7,29 @@
 
 #include <iostream>
 #include <vector>
+#include "LTMD/Arena.h"
+#include "LTMD/LBFGS.h"
+#include "LTMD/ModeBasis.h"
 #include "LTMD/Parameters.h"
+#include "LTMD/Profiler.h"
+#include "LTMD/Projection.h"
+#include "LTMD/Random.h"
+#include "LTMD/ResourceEstimate.h"
+#include "LTMD/StepLengthController.h"
 #include "LTMD/StepKernel.h"
 
+#if defined( __GNUC__ )
+#define LTMD_DEPRECATED __attribute__(( deprecated ))
+#elif defined( _MSC_VER )
+#define LTMD_DEPRECATED __declspec( deprecated )
+#else
+#define LTMD_DEPRECATED
+#endif
+
 namespace OpenMM {
 	namespace LTMD {
 		class Analysis;
+		class ProjectionBatch;
 
 		class OPENMM_EXPORT Integrator : public OpenMM::Integrator {
 			public:
@@ -55,7 +72,7 @@ namespace OpenMM {
 				}
 
 				unsigned int getNumProjectionVectors() const {
-					return eigenvectors.size();
+					return mModeBasis ? mModeBasis->Modes() : 0;
 				}
 
 				double getMinimumLimit() const {
@@ -70,22 +87,84 @@ namespace OpenMM {
 					return eigVecChanged;
 				}
 
-				const std::vector<std::vector<OpenMM::Vec3> > &getProjectionVectors() const {
-					return eigenvectors;
+				/**
+				 * Current modes, shared with the kernels. Compare ModeBasis::Version to detect a
+				 * new basis.
+				 */
+				ModeBasisPtr getModeBasis() const {
+					return mModeBasis;
+				}
+
+				/**
+				 * Copy of the current modes, empty before the first diagonalization.
+				 *
+				 * @deprecated Use getModeBasis, which shares the modes instead of copying them on
+				 * every call. Kept for hosts written against the vector interface.
+				 */
+				LTMD_DEPRECATED std::vector<std::vector<OpenMM::Vec3> > getProjectionVectors() const {
+					return mModeBasis ? mModeBasis->Vectors() : std::vector<std::vector<OpenMM::Vec3> >();
 				}
 
 				void SetProjectionChanged( bool value );
 
-				void setProjectionVectors( const std::vector<std::vector<OpenMM::Vec3> > &vectors ) {
-					eigenvectors = vectors;
+				void setModeBasis( const ModeBasisPtr &basis ) {
+					mModeBasis = basis;
 					SetProjectionChanged( true );
 					stepsSinceDiagonalize = 0;
 				}
 
+				void setProjectionVectors( const std::vector<std::vector<OpenMM::Vec3> > &vectors ) {
+					setModeBasis( ModeBasis::Create( vectors ) );
+				}
+
+				/**
+				 * Batch the kernel projections with other integrators sharing the same basis, or
+				 * NULL to project alone. Set by Ensemble, the batch is not owned.
+				 */
+				ProjectionBatch *getProjectionBatch() const {
+					return mProjectionBatch;
+				}
+
+				void setProjectionBatch( ProjectionBatch *batch ) {
+					mProjectionBatch = batch;
+				}
+
+				BlockPreconditionerPtr getBlockPreconditioner() const {
+					return mPreconditioner;
+				}
+
+				void setBlockPreconditioner( const BlockPreconditionerPtr &preconditioner ) {
+					mPreconditioner = preconditioner;
+				}
+
+				/**
+				 * Recompute the modes at the current positions.
+				 */
+				void Rediagonalize();
+
+				/**
+				 * Take the step the last call to step() stopped at after its minimization failed,
+				 * as the integrator does itself without Parameters::ShouldProtoMolDiagonalize. The
+				 * modes are recomputed at the reached positions and the step is counted.
+				 */
+				void RediagonalizeFailedStep();
+
 				double getMaxEigenvalue() const {
 					return maxEigenvalue;
 				}
 
+				/**
+				 * Effective curvature the linear minimizer steps with when
+				 * Parameters::ShouldAdaptStepLength is set.
+				 */
+				const StepLengthController &getStepLength() const {
+					return mStepLength;
+				}
+
+				const Parameters &getParameters() const {
+					return mParameters;
+				}
+
 				double computeKineticEnergy();
 				//double computeKineticEnergy() {
 //dynamic_cast<StepKernel &>( kernel.getImpl() ).UpdateTime( *this );
@@ -119,6 +198,81 @@ namespace OpenMM {
 
 				unsigned int CompletedSteps() const;
 
+				/**
+				 * Evaluations of every force group that computed forces since initialization, those
+				 * that only computed the energy of a trial point, and the evaluations served from
+				 * the cache because the positions had not moved since the last evaluation.
+				 */
+				unsigned int getForceEvaluations() const {
+					return mForceEvaluations;
+				}
+
+				unsigned int getEnergyEvaluations() const {
+					return mEnergyEvaluations;
+				}
+
+				unsigned int getForceEvaluationsSaved() const {
+					return mForceEvaluationsSaved;
+				}
+
+				/**
+				 * Evaluations of Parameters::InnerMinimizationGroups alone, which
+				 * getForceEvaluations does not include.
+				 */
+				unsigned int getPartialForceEvaluations() const {
+					return mPartialForceEvaluations;
+				}
+
+				/**
+				 * With Parameters::ShouldUseEnergyOnlyTrials, the trial points left without ever
+				 * computing their forces, and those whose forces were computed after their energy
+				 * because they were accepted or needed by the quadratic fit.
+				 */
+				unsigned int getForceEvaluationsAvoided() const {
+					return mForceEvaluationsAvoided;
+				}
+
+				unsigned int getForceEvaluationsDeferred() const {
+					return mForceEvaluationsDeferred;
+				}
+
+				/**
+				 * Timers and counters of every integrator phase, kernel call and
+				 * rediagonalization stage. Enabled by Parameters::ShouldProfile or at any time
+				 * through Profiler::SetEnabled.
+				 */
+				Profiler &getProfiler() {
+					return mProfiler;
+				}
+
+				const Profiler &getProfiler() const {
+					return mProfiler;
+				}
+
+				/**
+				 * Predicted memory and force evaluations of a rediagonalization, with the method
+				 * chosen for it. Set by initialize, empty before.
+				 */
+				const ResourceEstimate &getResourceEstimate() const {
+					return mResourceEstimate;
+				}
+
+				/**
+				 * Buffers kept between rediagonalizations, NULL unless
+				 * ShouldReuseRediagonalizationMemory is set.
+				 */
+				const Arena *getArena() const {
+					return mArena;
+				}
+
+				/**
+				 * Minimizer force evaluations of each step taken by the last call to step().
+				 */
+
+				const std::vector<unsigned int> &getMinimizationHistory() const {
+					return mMinimizationHistory;
+				}
+
 				bool minimize( const unsigned int upperbound );
 				bool minimize( const unsigned int upperbound, const unsigned int lowerbound );
 			protected:
@@ -129,6 +283,9 @@ namespace OpenMM {
 				void DiagonalizeMinimize();
 
 				void Minimize( const unsigned int max, unsigned int &simpleSteps, unsigned int &quadraticSteps );
+				void MinimizeLBFGS( const unsigned int max, double energy, unsigned int &iterations, unsigned int &searches );
+				bool MinimizeSplit( const unsigned int max, double &energy, unsigned int &outer );
+				void ComplementGradient( std::vector<double> &gradient );
 
 				// Kernel Functions
 				void IntegrateStep();
@@ -139,13 +296,22 @@ namespace OpenMM {
 
 				void SaveStep();
 				void RevertStep();
+
+				// Force Cache
+				double CalculateForcesAndEnergy( const bool forces, const bool energy );
+				double TrialEnergy();
+				void RequireForces();
+				void PositionsChanged();
+				void LeavePositions();
 			private:
 				//std::vector<Vec3> oldPos; // TMC this won't work in CPU memory with GPU kernels...
 				unsigned int mSimpleMinimizations, mQuadraticMinimizations;
 				unsigned int mLastCompleted;
+				bool mStepFailed;
 				void computeProjectionVectors();
 				double maxEigenvalue;
-				std::vector<std::vector<OpenMM::Vec3> > eigenvectors;
+				ModeBasisPtr mModeBasis;
+				ProjectionBatch *mProjectionBatch;
 				bool eigVecChanged;
 				double minimumLimit;
 				double temperature, friction;
@@ -155,6 +321,25 @@ namespace OpenMM {
 				OpenMM::Kernel kernel;
 				const Parameters &mParameters;
 				Analysis *mAnalysis;
+				Arena *mArena;
+				Random mRandom;
+				uint64_t mMetropolisDraws;
+				// Positions are identified by version, the forces and energy held by the context
+				// by the version and force groups they were evaluated at, version 0 for none
+				uint64_t mPositionVersion, mVersionCounter, mSavedVersion;
+				uint64_t mForcesVersion, mEnergyVersion, mEnergyOnlyVersion;
+				int mEvaluationGroups, mForcesGroups, mEnergyGroups;
+				bool mEnergyOnlyTrials;
+				double mCachedPE;
+				unsigned int mForceEvaluations, mEnergyEvaluations, mPartialForceEvaluations, mForceEvaluationsSaved, mForceEvaluationsAvoided, mForceEvaluationsDeferred;
+				std::vector<unsigned int> mMinimizationHistory;
+				std::vector<double> mInverseRootMass;
+				Projection mComplement;
+				LBFGS mLBFGS;
+				StepLengthController mStepLength;
+				BlockPreconditionerPtr mPreconditioner;
+				Profiler mProfiler;
+				ResourceEstimate mResourceEstimate;
 		};
 	}
 }
@@ -0,0 +1,72 @@
+#ifndef OPENMM_LTMD_LBFGS_H_
+#define OPENMM_LTMD_LBFGS_H_
+
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/BlockPreconditioner.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Limited memory BFGS approximation of the inverse Hessian.
+		 *
+		 * Holds the last Memory() step and gradient change pairs and applies the two loop
+		 * recursion to a gradient. The initial inverse Hessian is a scalar, taken from the newest
+		 * pair once one exists and from SetInitialScale before that, unless a preconditioner
+		 * is set.
+		 */
+		class OPENMM_EXPORT LBFGS {
+			public:
+				LBFGS( const unsigned int memory = 5 );
+
+				unsigned int Memory() const {
+					return mMemory;
+				}
+
+				/**
+				 * Change the number of pairs kept, discarding the history.
+				 */
+				void SetMemory( const unsigned int memory );
+
+				/**
+				 * Scale of the initial inverse Hessian while the history is empty.
+				 */
+				void SetInitialScale( const double scale );
+
+				/**
+				 * Use preconditioner as the initial inverse Hessian, NULL for the scalar.
+				 * The preconditioner is not owned and must outlive its use.
+				 */
+				void SetPreconditioner( const BlockPreconditioner *preconditioner );
+
+				unsigned int Size() const {
+					return mCount;
+				}
+
+				void Clear();
+
+				/**
+				 * Record the step s = x' - x and gradient change y = g' - g. Pairs without
+				 * positive curvature are skipped, returning false.
+				 */
+				bool Update( const std::vector<double> &s, const std::vector<double> &y );
+
+				/**
+				 * direction = -H gradient, may be the same array as gradient.
+				 */
+				void Direction( const std::vector<double> &gradient, std::vector<double> &direction ) const;
+
+				static double Dot( const std::vector<double> &a, const std::vector<double> &b );
+			private:
+				unsigned int mMemory, mCount, mNewest;
+				double mInitialScale;
+				const BlockPreconditioner *mPreconditioner;
+				std::vector<std::vector<double> > mS, mY;
+				std::vector<double> mRho;
+				mutable std::vector<double> mAlpha;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_LBFGS_H_
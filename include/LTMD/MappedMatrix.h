@@ -0,0 +1,91 @@
+#ifndef OPENMM_LTMD_MAPPEDMATRIX_H_
+#define OPENMM_LTMD_MAPPEDMATRIX_H_
+
+#include <stddef.h>
+#include <string>
+
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Column major matrix stored in a memory mapped scratch file, so it may be larger than
+		 * physical memory.
+		 *
+		 * The file is unlinked as soon as it is created and disappears with the matrix. Columns
+		 * are contiguous, so work should move through it in panels of whole columns, hinting
+		 * the panel about to be used with Prefetch and finished ones with Release. Without
+		 * mmap (Windows) the matrix is held in memory.
+		 */
+		class OPENMM_EXPORT MappedMatrix {
+			public:
+				// Default panel size the out of core stages keep resident at a time
+				static const size_t PanelBytes = 64 * 1024 * 1024;
+
+				MappedMatrix( const size_t rows, const size_t columns, const std::string &directory = "" );
+				~MappedMatrix();
+
+				size_t Rows() const {
+					return mRows;
+				}
+
+				size_t Columns() const {
+					return mColumns;
+				}
+
+				double &operator()( const size_t row, const size_t column ) {
+					return mData[column * mRows + row];
+				}
+
+				double operator()( const size_t row, const size_t column ) const {
+					return mData[column * mRows + row];
+				}
+
+				double *Column( const size_t column ) {
+					return mData + column * mRows;
+				}
+
+				const double *Column( const size_t column ) const {
+					return mData + column * mRows;
+				}
+
+				/**
+				 * Columns of rows doubles that fit in bytes, at least one. 0 bytes for
+				 * PanelBytes.
+				 */
+				static size_t PanelColumns( const size_t rows, const size_t bytes = 0 );
+
+				/**
+				 * Directory used when none is given: TMPDIR, then /tmp.
+				 */
+				static std::string ScratchDirectory( const std::string &directory );
+
+				/**
+				 * Bytes free in the scratch directory, 0 when unknown.
+				 */
+				static size_t ScratchAvailable( const std::string &directory );
+
+				/**
+				 * Start reading columns [first, last) ahead of use.
+				 */
+				void Prefetch( const size_t first, const size_t last ) const;
+
+				/**
+				 * Columns [first, last) will not be used for a while, their pages may be written
+				 * back and dropped.
+				 */
+				void Release( const size_t first, const size_t last ) const;
+			private:
+				MappedMatrix( const MappedMatrix & );
+				MappedMatrix &operator=( const MappedMatrix & );
+
+				void Advise( const size_t first, const size_t last, const int advice ) const;
+			private:
+				size_t mRows, mColumns, mBytes;
+				int mFile;
+				double *mData;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_MAPPEDMATRIX_H_
@@ -5,6 +5,14 @@
 #include "LTMD/Matrix.h"
 
 void MatrixMultiply( const Matrix &a, const bool transposeA, const Matrix &b, const bool transposeB, Matrix &c );
+void MatrixMultiply( const ConstMatrixView &a, const bool transposeA, const ConstMatrixView &b, const bool transposeB, const MatrixView &c );
 bool FindEigenvalues( const Matrix &matrix, std::vector<double> &values, Matrix &vectors );
 
+// Eigensystem of the square view, which is overwritten, without a working copy
+bool FindEigenvalues( const MatrixView &matrix, std::vector<double> &values, const MatrixView &vectors );
+
+// Eigensystem of the packed matrix, which is overwritten. Needs no n x n workspace besides
+// the eigenvectors, so the peak is half that of the square version.
+bool FindEigenvalues( SymmetricMatrix &matrix, std::vector<double> &values, const MatrixView &vectors );
+
 #endif // OPENMM_LTMD_MATH_H_
@@ -6,19 +6,146 @@
 #include <iostream>
 #include <algorithm>
 
+#include "LTMD/Aligned.h"
+
+/**
+ * Non-owning column major window onto matrix storage. Column c starts LeadingDimension
+ * values after column c - 1, so Data and LeadingDimension can be passed straight to BLAS
+ * and LAPACK. MatrixView writes through to the matrix, ConstMatrixView only reads.
+ */
+template<typename T>
+struct MatrixViewOf {
+	T *Data;
+	size_t Rows, Columns, LeadingDimension;
+
+	MatrixViewOf( T *data = NULL, const size_t rows = 0, const size_t columns = 0, const size_t leading = 0 )
+		: Data( data ), Rows( rows ), Columns( columns ), LeadingDimension( leading != 0 ? leading : rows ) {}
+
+	// Any view can be read through a const view
+	template<typename U>
+	MatrixViewOf( const MatrixViewOf<U> &other )
+		: Data( other.Data ), Rows( other.Rows ), Columns( other.Columns ), LeadingDimension( other.LeadingDimension ) {}
+
+	T &operator()( const size_t row, const size_t col ) const {
+		assert( row < Rows && col < Columns );
+		return Data[col * LeadingDimension + row];
+	}
+
+	T *Column( const size_t col ) const {
+		return Data + col * LeadingDimension;
+	}
+
+	MatrixViewOf Block( const size_t row, const size_t col, const size_t rows, const size_t columns ) const {
+		assert( row + rows <= Rows && col + columns <= Columns );
+		return MatrixViewOf( Data + col * LeadingDimension + row, rows, columns, LeadingDimension );
+	}
+};
+
+typedef MatrixViewOf<double> MatrixView;
+typedef MatrixViewOf<const double> ConstMatrixView;
+
 struct Matrix {
+	typedef std::vector<double, OpenMM::LTMD::AlignedAllocator<double> > Storage;
+
 	size_t Rows, Columns;
-	std::vector<double> Data;
+	Storage Data;
 
 	Matrix( const size_t rows = 0, const size_t Columns = 0 );
+	explicit Matrix( const ConstMatrixView &view );
+	Matrix( const Matrix &other );
+	Matrix( Matrix &&other );
 	~Matrix();
 
 	Matrix &operator=( const Matrix &other );
+	Matrix &operator=( Matrix &&other );
 
 	void Print() const;
 
-	double &operator()( const size_t row, const size_t col );
-	double operator()( const size_t row, const size_t col ) const;
+	// Bounds are only checked in debug builds
+	double &operator()( const size_t row, const size_t col ) {
+		assert( row < Rows && col < Columns );
+		return Data[col * Rows + row];
+	}
+
+	double operator()( const size_t row, const size_t col ) const {
+		assert( row < Rows && col < Columns );
+		return Data[col * Rows + row];
+	}
+
+	double *Column( const size_t col ) {
+		return Data.data() + col * Rows;
+	}
+
+	const double *Column( const size_t col ) const {
+		return Data.data() + col * Rows;
+	}
+
+	MatrixView View() {
+		return MatrixView( Data.data(), Rows, Columns, std::max<size_t>( Rows, 1 ) );
+	}
+
+	ConstMatrixView View() const {
+		return ConstMatrixView( Data.data(), Rows, Columns, std::max<size_t>( Rows, 1 ) );
+	}
+
+	MatrixView View( const size_t row, const size_t col, const size_t rows, const size_t columns ) {
+		return View().Block( row, col, rows, columns );
+	}
+
+	ConstMatrixView View( const size_t row, const size_t col, const size_t rows, const size_t columns ) const {
+		return View().Block( row, col, rows, columns );
+	}
 };
 
+/**
+ * Symmetric matrix storing only its upper triangle, packed column by column in the LAPACK
+ * 'U' layout: element ( i, j ) with i <= j is at i + j ( j + 1 ) / 2. Either ( i, j ) or
+ * ( j, i ) addresses the same value.
+ */
+struct SymmetricMatrix {
+	size_t Rows, Columns;
+	Matrix::Storage Data;
+
+	SymmetricMatrix( const size_t size = 0 ) : Rows( size ), Columns( size ), Data( size * ( size + 1 ) / 2 ) {}
+
+	// Packs the average of the square view and its transpose
+	explicit SymmetricMatrix( const ConstMatrixView &view );
+
+	double &operator()( const size_t row, const size_t col ) {
+		assert( row < Rows && col < Columns );
+		return Data[Index( row, col )];
+	}
+
+	double operator()( const size_t row, const size_t col ) const {
+		assert( row < Rows && col < Columns );
+		return Data[Index( row, col )];
+	}
+
+	/**
+	 * Add element ( row, col ) of a nearly symmetric matrix, starting from zero. Once every
+	 * element has been added exactly once this holds the average of the matrix and its
+	 * transpose, so no separate symmetrization pass is needed.
+	 */
+	void Assemble( const size_t row, const size_t col, const double value ) {
+		Data[Index( row, col )] += ( row == col ) ? value : 0.5 * value;
+	}
+
+	static size_t Index( const size_t row, const size_t col ) {
+		const size_t i = std::min( row, col ), j = std::max( row, col );
+		return i + j * ( j + 1 ) / 2;
+	}
+};
+
+// Square tiles of the routines below, 64 x 64 doubles keep a source and destination tile in L2
+const size_t MatrixTile = 64;
+
+// Replace the square matrix by ( A + A^T ) / 2
+void Symmetrize( const MatrixView &matrix );
+
+// out = in^T, out must be in.Columns x in.Rows and not overlap in
+void Transpose( const ConstMatrixView &in, const MatrixView &out );
+
+// Column i of out is column columns[i] of in
+void GatherColumns( const ConstMatrixView &in, const std::vector<size_t> &columns, const MatrixView &out );
+
 #endif //LTMD_MATRIX_H_
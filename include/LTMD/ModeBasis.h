@@ -0,0 +1,79 @@
+#ifndef OPENMM_LTMD_MODEBASIS_H_
+#define OPENMM_LTMD_MODEBASIS_H_
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Set of modes held in one contiguous, 64 byte aligned allocation.
+		 *
+		 * Mode i occupies 3N values x0 y0 z0 x1 ... starting at Mode( i ), each mode beginning
+		 * on an aligned boundary. A basis is filled once after construction and then shared as
+		 * ModeBasisPtr, so holders never see it change. Every basis receives a new version so
+		 * consumers only repack or upload when they are handed a different one.
+		 */
+		class OPENMM_EXPORT ModeBasis {
+			public:
+				ModeBasis( const unsigned int modes, const unsigned int particles );
+				~ModeBasis();
+
+				static std::shared_ptr<const ModeBasis> Create( const std::vector<std::vector<Vec3> > &vectors );
+
+				unsigned int Modes() const {
+					return mModes;
+				}
+
+				unsigned int Particles() const {
+					return mParticles;
+				}
+
+				size_t Degrees() const {
+					return 3 * ( size_t ) mParticles;
+				}
+
+				/**
+				 * Distance in values between the start of consecutive modes.
+				 */
+				size_t Stride() const {
+					return mStride;
+				}
+
+				uint64_t Version() const {
+					return mVersion;
+				}
+
+				const double *Mode( const unsigned int mode ) const {
+					return mData + mode * mStride;
+				}
+
+				double *Mode( const unsigned int mode ) {
+					return mData + mode * mStride;
+				}
+
+				Vec3 Vector( const unsigned int mode, const unsigned int particle ) const {
+					const double *value = Mode( mode ) + 3 * particle;
+					return Vec3( value[0], value[1], value[2] );
+				}
+
+				std::vector<std::vector<Vec3> > Vectors() const;
+			private:
+				ModeBasis( const ModeBasis & );
+				ModeBasis &operator=( const ModeBasis & );
+			private:
+				unsigned int mModes, mParticles;
+				size_t mStride;
+				uint64_t mVersion;
+				double *mData;
+		};
+
+		typedef std::shared_ptr<const ModeBasis> ModeBasisPtr;
+	}
+}
+
+#endif // OPENMM_LTMD_MODEBASIS_H_
@@ -1,6 +1,7 @@
 #ifndef OPENMM_LTMD_PARAMETER_H_
 #define OPENMM_LTMD_PARAMETER_H_
 
+#include <stddef.h>
 #include <vector>
 #include <string>
 
@@ -8,6 +9,8 @@ namespace OpenMM {
 	namespace LTMD {
 		namespace Preference {
 			enum EPlatform { Reference, OpenCL, CUDA };
+			enum EMinimizer { Quadratic, LBFGS };
+			enum ERediagonalization { Automatic, Full, Lean, OutOfCore };
 		}
 
 		struct Force {
@@ -38,11 +41,71 @@ namespace OpenMM {
 			unsigned int MaximumMinimizationCutoff;
 			unsigned int MaximumMinimizationIterations;
 
+			// Quadratic alternates fixed steps with a line fit, LBFGS runs projected L-BFGS
+			// in mass weighted coordinates. Both are bounded by MaximumMinimizationIterations
+			// force evaluations.
+			Preference::EMinimizer Minimizer;
+			unsigned int LBFGSMemory;
+
+			// Use the block Hessian eigensystems as the initial inverse Hessian of LBFGS,
+			// with LBFGSMemory 0 this is preconditioned steepest descent
+			bool ShouldPreconditionMinimizer;
+
+			// Evaluate only the energy at minimizer trial points, computing forces once a point
+			// is accepted or the quadratic fit needs its slope. Rejected trials then cost an
+			// energy evaluation and no force evaluation.
+			bool ShouldUseEnergyOnlyTrials;
+
+			// Step the linear minimizer by a running estimate of the curvature, learned from the
+			// quadratic fits and accepted steps, instead of 1/maxEigenvalue
+			bool ShouldAdaptStepLength;
+
+			// OpenMM force group mask, typically the bonded terms, that is cheap enough to relax
+			// for up to InnerMinimizationIterations linear steps between evaluations of every
+			// group. The full energy then only accepts or rejects the relaxed positions. 0 for
+			// every minimizer step to evaluate every group.
+			int InnerMinimizationGroups;
+			unsigned int InnerMinimizationIterations;
+
 			double MinimumLambdaValue;
 
 			int DeviceID;
 			bool ShouldProtoMolDiagonalize;
 
+			// Generate the next step's Langevin noise on a background thread
+			bool ShouldPrefillNoise;
+
+			// Store the CPU projection basis in float, coefficients stay double
+			bool ShouldUseSinglePrecisionModes;
+
+			// Storage used by the rediagonalization. Automatic takes the first of Full, Lean and
+			// OutOfCore whose estimated peak fits in MemoryLimit, initialize fails if the method
+			// does not fit.
+			Preference::ERediagonalization Rediagonalization;
+
+			// Bytes the rediagonalization may use, 0 for the memory available at initialize
+			size_t MemoryLimit;
+
+			// Directory for the OutOfCore scratch files, empty for TMPDIR or /tmp
+			std::string ScratchDirectory;
+
+			// Bytes of each scratch matrix OutOfCore keeps resident at a time, 0 for
+			// MappedMatrix::PanelBytes
+			size_t ScratchPanelBytes;
+
+			// Worker threads that compute and diagonalize the block Hessian, each for its own
+			// shard of blocks in its own Reference context. 0 or 1 uses the single block
+			// context of this thread.
+			unsigned int RediagonalizationWorkers;
+
+			// Keep the large rediagonalization buffers in an arena between rediagonalizations
+			// instead of returning them to the system, optionally backed by huge pages
+			bool ShouldReuseRediagonalizationMemory;
+			bool ShouldUseHugePages;
+
+			// Start the integrator with its profiler enabled
+			bool ShouldProfile;
+
 			Parameters();
 		};
 	}
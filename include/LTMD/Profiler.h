@@ -0,0 +1,118 @@
+#ifndef OPENMM_LTMD_PROFILER_H_
+#define OPENMM_LTMD_PROFILER_H_
+
+#include <chrono>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Registry of named timers and counters.
+		 *
+		 * Disabled by default, a disabled profiler costs one branch per timer or counter.
+		 * When enabled every interval is accumulated per name and kept as an event for
+		 * the Chrome trace timeline, up to MaximumEvents. Names must be string literals,
+		 * events keep the pointer. Not thread safe, each integrator owns its own.
+		 */
+		class OPENMM_EXPORT Profiler {
+			public:
+				static const size_t MaximumEvents = 1 << 20;
+
+				struct Timer {
+					uint64_t Calls;
+					double Total, Minimum, Maximum; // ms
+				};
+
+				/**
+				 * Times the enclosing scope, or until Stop.
+				 */
+				class Scope {
+					public:
+						Scope( Profiler *profiler, const char *name ) : mProfiler( profiler && profiler->IsEnabled() ? profiler : NULL ), mName( name ), mStart( 0 ) {
+							if( mProfiler ) {
+								mStart = mProfiler->Now();
+							}
+						}
+
+						~Scope() {
+							Stop();
+						}
+
+						void Stop() {
+							if( mProfiler ) {
+								mProfiler->Record( mName, mStart, mProfiler->Now() );
+								mProfiler = NULL;
+							}
+						}
+					private:
+						Profiler *mProfiler;
+						const char *mName;
+						uint64_t mStart;
+				};
+
+				Profiler();
+
+				bool IsEnabled() const {
+					return mEnabled;
+				}
+
+				void SetEnabled( const bool value ) {
+					mEnabled = value;
+				}
+
+				void Clear();
+
+				/**
+				 * Nanoseconds since the profiler was created.
+				 */
+				uint64_t Now() const;
+
+				void Record( const char *name, const uint64_t start, const uint64_t end );
+
+				void Count( const char *name, const uint64_t amount = 1 ) {
+					if( mEnabled ) {
+						mCounters[name] += amount;
+					}
+				}
+
+				const std::map<std::string, Timer> &Timers() const {
+					return mTimers;
+				}
+
+				const std::map<std::string, uint64_t> &Counters() const {
+					return mCounters;
+				}
+
+				/**
+				 * Timers and counters as a JSON object.
+				 */
+				std::string ToJSON() const;
+
+				/**
+				 * Recorded intervals in the Chrome trace event format, for chrome://tracing.
+				 */
+				std::string ToChromeTrace() const;
+
+				void WriteJSON( const std::string &filename ) const;
+				void WriteChromeTrace( const std::string &filename ) const;
+			private:
+				struct Event {
+					const char *Name;
+					uint64_t Start, Duration;
+				};
+			private:
+				bool mEnabled;
+				std::chrono::steady_clock::time_point mEpoch;
+				std::map<std::string, Timer> mTimers;
+				std::map<std::string, uint64_t> mCounters;
+				std::vector<Event> mEvents;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_PROFILER_H_
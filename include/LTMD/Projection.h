@@ -0,0 +1,104 @@
+#ifndef OPENMM_LTMD_PROJECTION_H_
+#define OPENMM_LTMD_PROJECTION_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/ModeBasis.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Projects vectors onto, or out of, the span of the mode basis Q in mass weighted space.
+		 *
+		 * The basis is stored twice, pre-multiplied by sqrt(m) and 1/sqrt(m), with the modes of
+		 * each degree of freedom contiguous. A projection is then two streaming passes over the
+		 * basis, c = A^T x followed by x' = B c, with no scaling passes or allocation per call.
+		 * Common mode counts use kernels specialized at compile time.
+		 */
+		class OPENMM_EXPORT Projection {
+			public:
+				/**
+				 * Weighting applied to the input before projecting. Mass projects velocities
+				 * (W = sqrt(m)), InverseMass projects forces (W = 1/sqrt(m)). The result is
+				 * scaled back by W^-1.
+				 */
+				enum EWeight { Mass, InverseMass };
+
+				Projection();
+
+				void SetMasses( const std::vector<double> &masses );
+				void SetBasis( const ModeBasis &basis );
+
+				/**
+				 * Store the basis as float, halving the memory streamed per projection. The
+				 * coefficients are still accumulated in double. Applies from the next SetBasis.
+				 */
+				void SetSinglePrecision( const bool value );
+
+				bool IsSinglePrecision() const {
+					return mSinglePrecision;
+				}
+
+				unsigned int Modes() const {
+					return mModes;
+				}
+
+				/**
+				 * Version of the basis last packed, zero before the first SetBasis.
+				 */
+				uint64_t Version() const {
+					return mVersion;
+				}
+
+				/**
+				 * out = W^-1 Q Q^T W in, or in - W^-1 Q Q^T W in for the compliment.
+				 *
+				 * @param in  3N values, x0 y0 z0 x1 ...
+				 * @param out 3N values, may be the same array as in
+				 */
+				void Project( const double *in, double *out, const EWeight weight, const bool compliment );
+
+				/**
+				 * Project count vectors with one pass over the basis for the coefficients
+				 * C = A^T [x_0 ... x_count-1] and one for the expansion B C, the basis being
+				 * streamed once for all of them rather than once per vector.
+				 *
+				 * @param in  count arrays of 3N values
+				 * @param out count arrays of 3N values, each may be the same array as its input
+				 */
+				void ProjectBatch( const double *const *in, double *const *out, const size_t count, const EWeight weight, const bool compliment );
+			private:
+				typedef void ( *CoefficientKernel )( const void *basis, const double *in, const long long first, const long long last, const unsigned int modes, double *partial );
+				typedef void ( *ExpandKernel )( const void *basis, const double *coefficients, const double *in, double *out, const long long first, const long long last, const unsigned int modes, const bool compliment );
+
+				template<typename Real>
+				void Pack( const ModeBasis &basis, std::vector<Real> &massWeighted, std::vector<Real> &inverseMassWeighted ) const;
+
+				template<typename Real>
+				void Select();
+
+				template<typename Real>
+				void BatchPasses( const Real *forward, const Real *backward, const double *const *in, double *const *out, const size_t count, const bool compliment );
+
+				void Dispatch();
+				void Coefficients( const void *basis, const double *in );
+				void Expand( const void *basis, const double *in, double *out, const bool compliment ) const;
+			private:
+				size_t mDegrees;
+				unsigned int mModes, mThreads;
+				uint64_t mVersion;
+				bool mSinglePrecision;
+				CoefficientKernel mCoefficientKernel;
+				ExpandKernel mExpandKernel;
+				std::vector<double> mMasses;
+				std::vector<double> mMassWeighted, mInverseMassWeighted;
+				std::vector<float> mSingleMassWeighted, mSingleInverseMassWeighted;
+				std::vector<double> mCoefficients, mPartial;
+				std::vector<double> mBatchCoefficients, mBatchPartial;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_PROJECTION_H_
@@ -0,0 +1,79 @@
+#ifndef OPENMM_LTMD_PROJECTIONBATCH_H_
+#define OPENMM_LTMD_PROJECTIONBATCH_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/ModeBasis.h"
+#include "LTMD/Projection.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Projections of several replicas sharing one mode basis, gathered into one pass over
+		 * the basis.
+		 *
+		 * Each participant calls Project from its own thread and blocks until every remaining
+		 * participant has submitted its next projection or left. The last to arrive projects
+		 * the whole set with Projection::ProjectBatch, one batch per weight and direction, and
+		 * releases the others. A participant that stops projecting with the shared basis, for
+		 * example after falling back to its own modes, must call Leave or the others wait on it.
+		 */
+		class OPENMM_EXPORT ProjectionBatch {
+			public:
+				ProjectionBatch( const std::vector<double> &masses, const ModeBasisPtr &basis, const unsigned int participants, const bool singlePrecision );
+
+				const ModeBasisPtr &Basis() const {
+					return mBasis;
+				}
+
+				/**
+				 * Threads used by the batched passes, independent of those of the calling thread.
+				 */
+				void SetThreads( const int threads ) {
+					mThreads = threads;
+				}
+
+				/**
+				 * As Projection::Project, batched with the other participants.
+				 */
+				void Project( const double *in, double *out, const Projection::EWeight weight, const bool compliment );
+
+				void Leave();
+
+				/**
+				 * Number of batches projected and of vectors they held.
+				 */
+				uint64_t Batches() const;
+				uint64_t Vectors() const;
+			private:
+				ProjectionBatch( const ProjectionBatch & );
+				ProjectionBatch &operator=( const ProjectionBatch & );
+
+				struct Request {
+					const double *in;
+					double *out;
+					Projection::EWeight weight;
+					bool compliment;
+				};
+
+				void Flush();
+			private:
+				ModeBasisPtr mBasis;
+				Projection mProjection;
+				unsigned int mParticipants;
+				int mThreads;
+				uint64_t mGeneration, mBatches, mVectors;
+				std::vector<Request> mPending;
+				std::vector<const double *> mIn;
+				std::vector<double *> mOut;
+				mutable std::mutex mMutex;
+				std::condition_variable mReleased;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_PROJECTIONBATCH_H_
@@ -0,0 +1,65 @@
+#ifndef OPENMM_LTMD_RANDOM_H_
+#define OPENMM_LTMD_RANDOM_H_
+
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Counter based random number generator built on Philox4x32-10.
+		 *
+		 * Every value is a pure function of ( seed, stream, step, index ) so buffers can be
+		 * filled in any order, split across threads and regenerated without carrying state.
+		 */
+		class OPENMM_EXPORT Random {
+			public:
+				enum EStream { Noise = 0, Metropolis = 1, Exchange = 2 };
+
+				Random( const uint32_t seed = 0 );
+				~Random();
+
+				uint32_t Seed() const {
+					return mSeed;
+				}
+
+				void SetSeed( const uint32_t seed );
+
+				/**
+				 * Fill values with normally distributed numbers for the given step.
+				 */
+				void FillNormal( const uint32_t stream, const uint64_t step, std::vector<double> &values ) const;
+
+				/**
+				 * Uniformly distributed number in (0, 1] for the given step and index.
+				 */
+				double Uniform( const uint32_t stream, const uint64_t step, const uint32_t index ) const;
+
+				/**
+				 * Return the noise buffer of the given step, using the prefilled buffer when one
+				 * was requested for that step.
+				 */
+				const std::vector<double> &Normal( const uint64_t step, const size_t count );
+
+				/**
+				 * Start filling the noise buffer for the given step on a background thread.
+				 */
+				void Prefill( const uint64_t step, const size_t count );
+
+				static void Philox( const uint32_t counter[4], const uint32_t key[2], uint32_t out[4] );
+			private:
+				void Wait();
+			private:
+				uint32_t mSeed;
+				std::vector<double> mCurrent, mNext;
+				uint64_t mNextStep;
+				bool mHasNext;
+				std::thread mWorker;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_RANDOM_H_
@@ -2,6 +2,8 @@
 #define OPENMM_LTMD_REFERENCE_STEPKERNEL_H_
 
 #include "LTMD/StepKernel.h"
+#include "LTMD/Random.h"
+#include "LTMD/Projection.h"
 
 #include "ReferencePlatform.h"
 #include "RealVec.h"
@@ -60,18 +62,33 @@ namespace OpenMM {
 					void LinearMinimize( OpenMM::ContextImpl &context, const Integrator &integrator, const double energy );
 					double QuadraticMinimize( OpenMM::ContextImpl &context, const Integrator &integrator, const double energy );
 					void updateState( OpenMM::ContextImpl &context ) {}
+
+					// The Reference platform restores its forces after an energy only evaluation
+					bool SupportsEnergyOnlyTrials() const {
+						return true;
+					}
 					virtual double computeKineticEnergy( OpenMM::ContextImpl &context, const Integrator &integrator ) {
 						return computeShiftedKineticEnergy( context, mMasses, 0.5 * integrator.getStepSize() );
 					}
 
 
 				private:
-					void Project( const Integrator &integrator, const VectorArray &in, VectorArray &out, const DoubleArray &scale, const DoubleArray &inverseScale, const bool compliment );
+					void Project( const Integrator &integrator, const VectorArray &in, VectorArray &out, const Projection::EWeight weight, const bool compliment );
+
+					// Buffer a move of the positions is written to, and its completion
+					VectorArray &MoveTarget( OpenMM::ContextImpl &context );
+					void CommitMove( OpenMM::ContextImpl &context );
 				private:
 					unsigned int mParticles;
+					bool mShouldPrefillNoise, mHasPreviousPositions;
 					double mPreviousEnergy, mMinimizerScale;
-					DoubleArray mMasses, mInverseMasses, mProjectionVectors;
+					DoubleArray mMasses, mInverseMasses;
 					VectorArray mPreviousPositions, mXPrime;
+					Random mRandom;
+					Projection mProjection;
+#ifdef KERNEL_VALIDATION
+					Projection mValidationProjection;
+#endif
 					OpenMM::ReferencePlatform::PlatformData &data;
 			};
 		}
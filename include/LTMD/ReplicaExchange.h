@@ -0,0 +1,93 @@
+#ifndef OPENMM_LTMD_REPLICAEXCHANGE_H_
+#define OPENMM_LTMD_REPLICAEXCHANGE_H_
+
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/Ensemble.h"
+#include "LTMD/Random.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Temperature replica exchange over LTMD integrators.
+		 *
+		 * Each replica keeps its own mode basis. Exchanges only move temperatures between
+		 * replicas and rescale velocities, so the bases carry over unchanged. Neighbouring
+		 * temperatures are tried for exchange after every cycle, alternating between even
+		 * and odd pairs. Replicas step concurrently through Ensemble, on standard threads
+		 * whether or not the library is built with OpenMP.
+		 */
+		class OPENMM_EXPORT ReplicaExchange {
+			public:
+				/**
+				 * @param temperatures one replica per temperature (in Kelvin), in increasing order
+				 */
+				ReplicaExchange( const System &system, const Parameters &params, const std::vector<double> &temperatures, const double frictionCoeff, const double stepSize, Platform &platform );
+
+				unsigned int Replicas() const {
+					return mTemperatures.size();
+				}
+
+				Integrator &GetIntegrator( const unsigned int replica ) {
+					return mEnsemble.GetIntegrator( replica );
+				}
+
+				Context &GetContext( const unsigned int replica ) {
+					return mEnsemble.GetContext( replica );
+				}
+
+				void SetPositions( const std::vector<Vec3> &positions ) {
+					mEnsemble.SetPositions( positions );
+				}
+
+				/**
+				 * Replica currently running at temperature index.
+				 */
+				unsigned int ReplicaAt( const unsigned int temperature ) const {
+					return mReplica[temperature];
+				}
+
+				/**
+				 * Exchanges attempted and accepted between temperatures index and index + 1.
+				 */
+				unsigned int Attempts( const unsigned int index ) const {
+					return mAttempts[index];
+				}
+
+				unsigned int Acceptances( const unsigned int index ) const {
+					return mAcceptances[index];
+				}
+
+				/**
+				 * Run cycles of stepsPerExchange steps on every replica, each followed by an
+				 * exchange attempt.
+				 */
+				void Run( const unsigned int cycles, const unsigned int stepsPerExchange );
+
+				/**
+				 * Metropolis probability of exchanging replicas with potential energies
+				 * energyI and energyJ (kJ/mol) at temperatures I and J.
+				 */
+				static double Probability( const double temperatureI, const double energyI, const double temperatureJ, const double energyJ );
+
+				/**
+				 * Exchange the temperatures at index and index + 1 unconditionally, scaling each
+				 * replica's velocities to its new temperature. The mode bases stay with their
+				 * replicas.
+				 */
+				void Swap( const unsigned int index );
+			private:
+				void Exchange();
+			private:
+				Ensemble mEnsemble;
+				std::vector<double> mTemperatures;
+				std::vector<unsigned int> mReplica;
+				std::vector<unsigned int> mAttempts, mAcceptances;
+				Random mRandom;
+				uint64_t mCycle;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_REPLICAEXCHANGE_H_
@@ -0,0 +1,69 @@
+#ifndef OPENMM_LTMD_RESOURCEESTIMATE_H_
+#define OPENMM_LTMD_RESOURCEESTIMATE_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/Parameters.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Predicted cost of one rediagonalization, from the particle count, the block layout,
+		 * bdof and modes.
+		 *
+		 * Full keeps the n x n block Hessian and block eigenvectors plus dense E, HE and U.
+		 * Lean keeps each block on its own, assembles S one column at a time from the
+		 * perturbed forces and only forms the requested modes of U. Both hold S and its
+		 * eigenvectors, which dominate Lean for large systems. OutOfCore is Lean with S and
+		 * its eigenvectors in scratch files, trading memory for I/O.
+		 */
+		struct OPENMM_EXPORT ResourceEstimate {
+			size_t Particles, Degrees, Blocks, LargestBlock, Vectors, Modes;
+
+			// Bytes at the peak of each method and the bytes they are checked against,
+			// zero when the available memory is unknown
+			size_t FullBytes, LeanBytes, OutOfCoreBytes, AvailableBytes;
+
+			// Scratch file bytes of OutOfCore and the space free for them, zero when unknown
+			size_t ScratchBytes, ScratchAvailableBytes;
+
+			// Force evaluations of the block system and the full system
+			size_t BlockForceEvaluations, ForceEvaluations;
+
+			// Method chosen by Select, Automatic when nothing fits
+			Preference::ERediagonalization Method;
+
+			ResourceEstimate();
+
+			/**
+			 * Estimate for the given system, Vectors assumes every block keeps bdof vectors.
+			 *
+			 * @param limit bytes to check against, 0 uses AvailableMemory()
+			 */
+			static ResourceEstimate Calculate( const size_t particles, const Parameters &params, const size_t limit = 0 );
+
+			/**
+			 * Memory currently available to the process, 0 when it cannot be determined.
+			 */
+			static size_t AvailableMemory();
+
+			/**
+			 * Degrees of freedom of each block, as Analysis builds them from residue_sizes.
+			 */
+			static std::vector<size_t> BlockSizes( const size_t particles, const Parameters &params );
+
+			/**
+			 * Pick the method for the requested preference. Automatic prefers Full, then Lean,
+			 * then OutOfCore. Returns false if the chosen method does not fit.
+			 */
+			bool Select( const Preference::ERediagonalization preference );
+
+			std::string Report() const;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_RESOURCEESTIMATE_H_
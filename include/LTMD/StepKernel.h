@@ -29,9 +29,33 @@ namespace OpenMM {
 				virtual void Integrate( OpenMM::ContextImpl &context, const Integrator &integrator ) = 0;
 				virtual void UpdateTime( const Integrator &integrator ) = 0;
 
+				/**
+				 * Whether UpdateTime may reorder the atoms, leaving the context's forces out of
+				 * step with the integrator's cached evaluation.
+				 */
+				virtual bool ReordersAtoms() const {
+					return false;
+				}
+
+				/**
+				 * Whether an energy only evaluation leaves the context's forces from the previous
+				 * force evaluation in place, so they are still valid after rejecting a trial
+				 * point that was evaluated without forces.
+				 */
+				virtual bool SupportsEnergyOnlyTrials() const {
+					return false;
+				}
+
 				virtual double computeKineticEnergy( OpenMM::ContextImpl &context, const Integrator &integrator ) = 0;
 
 				virtual void setOldPositions( ) { }
+				/**
+				 * AcceptStep marks the current positions as accepted. RejectStep returns to them
+				 * after any sequence of Integrate, LinearMinimize and QuadraticMinimize calls, as
+				 * if they had been copied, so kernels may keep them in a spare buffer instead.
+				 * Positions set on the context directly in between are not tracked, AcceptStep
+				 * should follow them.
+				 */
 				virtual void AcceptStep( OpenMM::ContextImpl &context ) = 0;
 				virtual void RejectStep( OpenMM::ContextImpl &context ) = 0;
 
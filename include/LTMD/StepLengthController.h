@@ -0,0 +1,50 @@
+#ifndef OPENMM_LTMD_STEPLENGTHCONTROLLER_H_
+#define OPENMM_LTMD_STEPLENGTHCONTROLLER_H_
+
+#include "openmm/internal/windowsExport.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Running estimate of the effective curvature along the minimizer's search direction,
+		 * whose inverse is the length of the next linear trial step.
+		 *
+		 * The line minimum found by a quadratic fit is the step that should have been taken,
+		 * so the estimate moves halfway towards its inverse in log space. A linear step
+		 * accepted without a fit may have been short, so the estimate relaxes slightly, and a
+		 * rejected step doubles it. The estimate stays within the limits.
+		 */
+		class OPENMM_EXPORT StepLengthController {
+			public:
+				StepLengthController();
+
+				/**
+				 * Restart from curvature, within [minimum, maximum].
+				 */
+				void Reset( const double curvature, const double minimum, const double maximum );
+
+				double Curvature() const {
+					return mCurvature;
+				}
+
+				double Step() const {
+					return 1.0 / mCurvature;
+				}
+
+				// The quadratic fit chose lambda for the last trial
+				void Observe( const double lambda );
+
+				// The last linear trial lowered the energy without a fit
+				void Accept();
+
+				// The last trial raised the energy and was reverted
+				void Reject();
+			private:
+				void Clamp();
+			private:
+				double mCurvature, mMinimum, mMaximum;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_STEPLENGTHCONTROLLER_H_
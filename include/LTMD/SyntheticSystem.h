@@ -0,0 +1,68 @@
+#ifndef OPENMM_LTMD_SYNTHETICSYSTEM_H_
+#define OPENMM_LTMD_SYNTHETICSYSTEM_H_
+
+#include <vector>
+
+#include "OpenMM.h"
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/Parameters.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Protein like test system of any size, for scaling studies without ProtoMol input.
+		 *
+		 * A single chain of united atoms wound into a helix and split into pseudo-residues of
+		 * 7 to 24 atoms in a fixed sequence, with harmonic bonds and angles, periodic torsions
+		 * and a Lennard-Jones plus Coulomb nonbonded force. Bonds and angles are at their
+		 * minimum in the generated geometry and every residue is neutral. The same atom count
+		 * always gives the same system.
+		 */
+		class OPENMM_EXPORT SyntheticSystem {
+			public:
+				// Force indices within the created System
+				enum EForce { Bond = 0, Angle = 1, Dihedral = 2, Nonbonded = 3 };
+
+				// Force groups, the bonds, angles and torsions apart from the nonbonded force so
+				// they can be relaxed alone with Parameters::InnerMinimizationGroups
+				enum EGroup { BondedGroup = 0, NonbondedGroup = 1 };
+
+				SyntheticSystem( const unsigned int atoms );
+
+				unsigned int Atoms() const {
+					return mPositions.size();
+				}
+
+				const std::vector<Vec3> &Positions() const {
+					return mPositions;
+				}
+
+				const std::vector<int> &ResidueSizes() const {
+					return mResidueSizes;
+				}
+
+				/**
+				 * Build the System, owned by the caller.
+				 */
+				System *CreateSystem() const;
+
+				/**
+				 * Set the residue sizes and the force list Analysis::Initialize uses to build the
+				 * block system.
+				 */
+				void Configure( Parameters &params ) const;
+
+				/**
+				 * As above, also setting the block sizes and mode count, with the block Hessian
+				 * evaluated on the Reference platform.
+				 */
+				void Configure( Parameters &params, const int residuesPerBlock, const int blockDegrees, const int modes ) const;
+			private:
+				std::vector<Vec3> mPositions;
+				std::vector<double> mMasses, mCharges;
+				std::vector<int> mResidueSizes;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_SYNTHETICSYSTEM_H_
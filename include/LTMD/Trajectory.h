@@ -0,0 +1,94 @@
+#ifndef OPENMM_LTMD_TRAJECTORY_H_
+#define OPENMM_LTMD_TRAJECTORY_H_
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "openmm/Vec3.h"
+#include "openmm/internal/windowsExport.h"
+#include "LTMD/ModeBasis.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		/**
+		 * Trajectory stored in mode space.
+		 *
+		 * The file is a header followed by tagged records with varint lengths. The mode basis
+		 * is written once each time it changes. Each frame stores the mass weighted amplitudes
+		 * of its displacement from the previous reconstructed frame, followed by the residual
+		 * of that prediction quantized to the precision. The residuals are Rice coded with a
+		 * parameter chosen per frame, so the mostly zero residuals of motion along the modes
+		 * cost little more than a bit per coordinate. Keyframes store the quantized coordinates
+		 * directly as zigzag varints, once every keyframe interval and after each basis change.
+		 * Every coordinate read back is within precision / 2 of the one written.
+		 */
+		class OPENMM_EXPORT TrajectoryWriter {
+			public:
+				/**
+				 * @param precision        largest reconstruction error is half this (in nm)
+				 * @param keyframeInterval frames between full keyframes
+				 */
+				TrajectoryWriter( const std::string &filename, const std::vector<double> &masses, const double precision = 1e-4, const unsigned int keyframeInterval = 100 );
+				~TrajectoryWriter();
+
+				void WriteFrame( const double time, const std::vector<Vec3> &positions, const ModeBasisPtr &basis );
+				void Close();
+
+				unsigned int Frames() const {
+					return mFrames;
+				}
+
+				uint64_t BytesWritten() const {
+					return mBytes;
+				}
+			private:
+				void WriteRecord( const char tag, const std::vector<unsigned char> &payload );
+				void WriteBasis( const ModeBasisPtr &basis );
+				void WriteKeyframe( const double time, const std::vector<Vec3> &positions );
+				void WriteDelta( const double time, const std::vector<Vec3> &positions );
+			private:
+				std::ofstream mFile;
+				double mPrecision;
+				unsigned int mKeyframeInterval, mFrames, mSinceKeyframe;
+				uint64_t mBytes, mVersion;
+				unsigned int mModes;
+				std::vector<double> mInverseRootMass;
+				std::vector<float> mBasis;
+				std::vector<double> mPrevious;
+		};
+
+		class OPENMM_EXPORT TrajectoryReader {
+			public:
+				TrajectoryReader( const std::string &filename );
+
+				unsigned int Particles() const {
+					return mInverseRootMass.size();
+				}
+
+				double Precision() const {
+					return mPrecision;
+				}
+
+				unsigned int Modes() const {
+					return mModes;
+				}
+
+				/**
+				 * Read the next frame, returning false at the end of the file.
+				 */
+				bool ReadFrame( double &time, std::vector<Vec3> &positions );
+			private:
+				std::ifstream mFile;
+				double mPrecision;
+				unsigned int mModes;
+				std::vector<double> mInverseRootMass;
+				std::vector<float> mBasis;
+				std::vector<double> mPrevious;
+				bool mHasFrame;
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_TRAJECTORY_H_
@@ -1,7 +1,6 @@
 #include "openmm/OpenMMException.h"
 #include "openmm/State.h"
 #include "openmm/Vec3.h"
-#include <sys/time.h>
 #include "openmm/internal/ContextImpl.h"
 #include "openmm/internal/ForceImpl.h"
 #include <algorithm>
@@ -9,10 +8,18 @@
 #include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "OpenMM.h"
 #include "LTMD/Math.h"
 #include "LTMD/Analysis.h"
+#include "LTMD/MappedMatrix.h"
 #include "LTMD/Integrator.h"
 
 namespace OpenMM {
@@ -74,173 +81,114 @@ namespace OpenMM {
 		}
 
 		const Matrix Analysis::CalculateU( const Matrix &E, const Matrix &Q ) const {
-#ifdef PROFILE_ANALYSIS
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( mProfiler, "Analysis::CalculateU" );
+
 			Matrix retVal( E.Rows, Q.Columns );
 			MatrixMultiply( E, false, Q, false, retVal );
 
-#ifdef PROFILE_ANALYSIS
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[Analysis] Calculate U: " << elapsed << "ms" << std::endl;
-#endif
 			return retVal;
 		}
 
-		void Analysis::computeEigenvectorsFull( Context &context, const Parameters &params ) {
-			timeval start, end;
-			gettimeofday( &start, 0 );
-
-			timeval tp_begin, tp_hess, tp_diag, tp_e, tp_s, tp_s_matrix, tp_q, tp_u;
-
-			gettimeofday( &tp_begin, NULL );
-
-			std::vector<Vec3> positions = context.getState( State::Positions ).getPositions();
-
-			/*********************************************************************/
-			/*                                                                   */
-			/* Block Hessian Code (Cickovski/Sweet)                              */
-			/*                                                                   */
-			/*********************************************************************/
-
-			// Initial residue data (where in OpenMM?)
-
-			// For now, since OpenMM input files do not contain residue information
-			// I am assuming that they will always start with the N-terminus, just for testing.
-			// This is true for the villin.xml but may not be true in the future.
-			// need it to parallelize.
-
-			if( !mInitialized ) {
-				Initialize( context, params );
-			}
-
-			int n = 3 * mParticleCount;
-
-			// Copy the positions.
-			std::vector<Vec3> blockPositions;
-			for( unsigned int i = 0; i < mParticleCount; i++ ) {
-				Vec3 atom( positions[i][0], positions[i][1], positions[i][2] );
-				blockPositions.push_back( atom );
+		// Finite difference Hessian of blocks [first, last) of a block system, perturbing the
+		// same degree of freedom of every block at once so each block only sees its own
+		// perturbation. Packed assembly makes each block exactly symmetric.
+		void Analysis::ComputeBlockHessian( Context &blockSystem, const std::vector<Vec3> &positions, const Parameters &params, const size_t first, const size_t last, std::vector<Block> &hessian ) {
+			// Degrees of freedom of each block, indexed from first
+			std::vector<size_t> start( last - first ), end( last - first );
+			size_t largest = 0;
+
+			hessian.resize( last - first );
+			for( size_t j = 0; j < hessian.size(); j++ ) {
+				start[j] = 3 * blocks[first + j];
+				end[j] = ( first + j == blocks.size() - 1 ) ? 3 * mParticleCount : 3 * blocks[first + j + 1];
+				largest = std::max( largest, end[j] - start[j] );
+
+				hessian[j].StartAtom = start[j];
+				hessian[j].EndAtom = end[j] - 1;
+				hessian[j].Data = SymmetricMatrix( end[j] - start[j] );
 			}
 
-			blockContext->setPositions( blockPositions );
-			/*********************************************************************/
+			std::vector<Vec3> blockPositions( positions );
+			blockSystem.setPositions( blockPositions );
 
 #ifdef FIRST_ORDER
-			const std::vector<Vec3> block_start_forces = blockContext->getState( State::Forces ).getForces();
+			const std::vector<Vec3> block_start_forces = blockSystem.getState( State::Forces ).getForces();
 #endif
 
-			Matrix h( n, n );
-			std::vector<Vec3> initialBlockPositions( blockPositions );
-			for( unsigned int i = 0; i < mLargestBlockSize; i++ ) {
+			for( size_t i = 0; i < largest; i++ ) {
 				// Perturb the ith degree of freedom in EACH block
 				// Note: not all blocks will have i degrees, we have to check for this
-				for( unsigned int j = 0; j < blocks.size(); j++ ) {
-					unsigned int dof_to_perturb = 3 * blocks[j] + i;
-					unsigned int atom_to_perturb = dof_to_perturb / 3;  // integer trunc
-
-					// Cases to not perturb, in this case just skip the block
-					if( j == blocks.size() - 1 && atom_to_perturb >= mParticleCount ) {
-						continue;
-					}
-					if( j != blocks.size() - 1 && atom_to_perturb >= blocks[j + 1] ) {
-						continue;
+				for( size_t j = 0; j < hessian.size(); j++ ) {
+					const size_t dof = start[j] + i;
+					if( dof < end[j] ) {
+						blockPositions[dof / 3][dof % 3] = positions[dof / 3][dof % 3] - params.blockDelta;
 					}
-
-					blockPositions[atom_to_perturb][dof_to_perturb % 3] = initialBlockPositions[atom_to_perturb][dof_to_perturb % 3] - params.blockDelta;
 				}
 
-				blockContext->setPositions( blockPositions );
-				const std::vector<Vec3> forces1 = blockContext->getState( State::Forces ).getForces();
+				blockSystem.setPositions( blockPositions );
+				const std::vector<Vec3> forces1 = blockSystem.getState( State::Forces ).getForces();
 
 #ifndef FIRST_ORDER
 				// Now, do it again...
-				for( int j = 0; j < blocks.size(); j++ ) {
-					int dof_to_perturb = 3 * blocks[j] + i;
-					int atom_to_perturb = dof_to_perturb / 3;  // integer trunc
-
-					// Cases to not perturb, in this case just skip the block
-					if( j == blocks.size() - 1 && atom_to_perturb >= mParticleCount ) {
-						continue;
-					}
-					if( j != blocks.size() - 1 && atom_to_perturb >= blocks[j + 1] ) {
-						continue;
+				for( size_t j = 0; j < hessian.size(); j++ ) {
+					const size_t dof = start[j] + i;
+					if( dof < end[j] ) {
+						blockPositions[dof / 3][dof % 3] = positions[dof / 3][dof % 3] + params.blockDelta;
 					}
-
-					blockPositions[atom_to_perturb][dof_to_perturb % 3] = initialBlockPositions[atom_to_perturb][dof_to_perturb % 3] + params.blockDelta;
 				}
 
-				blockContext->setPositions( blockPositions );
-				const std::vector<Vec3> forces2 = blockContext->getState( State::Forces ).getForces();
+				blockSystem.setPositions( blockPositions );
+				const std::vector<Vec3> forces2 = blockSystem.getState( State::Forces ).getForces();
 #endif
 
-				// revert block positions
-				for( int j = 0; j < blocks.size(); j++ ) {
-					int dof_to_perturb = 3 * blocks[j] + i;
-					int atom_to_perturb = dof_to_perturb / 3;  // integer trunc
-
-					// Cases to not perturb, in this case just skip the block
-					if( j == blocks.size() - 1 && atom_to_perturb >= mParticleCount ) {
-						continue;
-					}
-					if( j != blocks.size() - 1 && atom_to_perturb >= blocks[j + 1] ) {
-						continue;
-					}
-
-					blockPositions[atom_to_perturb][dof_to_perturb % 3] = initialBlockPositions[atom_to_perturb][dof_to_perturb % 3];
-
-				}
-
-				for( int j = 0; j < blocks.size(); j++ ) {
-					int dof_to_perturb = 3 * blocks[j] + i;
-					int atom_to_perturb = dof_to_perturb / 3;  // integer trunc
-
-					// Cases to not perturb, in this case just skip the block
-					if( j == blocks.size() - 1 && atom_to_perturb >= mParticleCount ) {
-						continue;
-					}
-					if( j != blocks.size() - 1 && atom_to_perturb >= blocks[j + 1] ) {
+				for( size_t j = 0; j < hessian.size(); j++ ) {
+					const size_t dof = start[j] + i;
+					if( dof >= end[j] ) {
 						continue;
 					}
 
-					int col = dof_to_perturb;
-
-					int start_dof = 3 * blocks[j];
-					int end_dof;
-					if( j == blocks.size() - 1 ) {
-						end_dof = 3 * mParticleCount;
-					} else {
-						end_dof = 3 * blocks[j + 1];
-					}
+					// revert block positions
+					blockPositions[dof / 3][dof % 3] = positions[dof / 3][dof % 3];
 
-					for( int k = start_dof; k < end_dof; k++ ) {
+					const size_t atom = dof / 3;
+					for( size_t k = start[j]; k < end[j]; k++ ) {
 #ifdef FIRST_ORDER
-						double blockscale = 1.0 / ( params.blockDelta * sqrt( mParticleMass[atom_to_perturb] * mParticleMass[k / 3] ) );
-						h( k, col ) = ( forces1[k / 3][k % 3] - block_start_forces[k / 3][k % 3] ) * blockscale;
+						double blockscale = 1.0 / ( params.blockDelta * sqrt( mParticleMass[atom] * mParticleMass[k / 3] ) );
+						hessian[j].Data.Assemble( k - start[j], i, ( forces1[k / 3][k % 3] - block_start_forces[k / 3][k % 3] ) * blockscale );
 #else
-						double blockscale = 1.0 / ( 2 * params.blockDelta * sqrt( mParticleMass[atom_to_perturb] * mParticleMass[k / 3] ) );
-						h( k, col ) = ( forces1[k / 3][k % 3] - forces2[k / 3][k % 3] ) * blockscale;
+						double blockscale = 1.0 / ( 2 * params.blockDelta * sqrt( mParticleMass[atom] * mParticleMass[k / 3] ) );
+						hessian[j].Data.Assemble( k - start[j], i, ( forces1[k / 3][k % 3] - forces2[k / 3][k % 3] ) * blockscale );
 #endif
 					}
 				}
 			}
+		}
 
-			gettimeofday( &tp_hess, NULL );
+		void Analysis::computeEigenvectorsFull( Context &context, const Parameters &params ) {
+			Profiler::Scope timer( mProfiler, "Analysis::ComputeEigenvectors" );
+			Profiler::Scope hessianTimer( mProfiler, "Analysis::Hessian" );
 
-			const double hessElapsed = ( tp_hess.tv_sec - tp_begin.tv_sec ) * 1000.0 + ( tp_hess.tv_usec - tp_begin.tv_usec ) / 1000.0;
-			std::cout << "Time to compute hessian: " << hessElapsed << "ms" << std::endl;
+			std::vector<Vec3> positions = context.getState( State::Positions ).getPositions();
 
-			// Make sure it is exactly symmetric.
-			for( int i = 0; i < n; i++ ) {
-				for( int j = 0; j < i; j++ ) {
-					double avg = 0.5f * ( h( i, j ) + h( j, i ) );
-					h( i, j ) = avg;
-					h( j, i ) = avg;
-				}
+			/*********************************************************************/
+			/*                                                                   */
+			/* Block Hessian Code (Cickovski/Sweet)                              */
+			/*                                                                   */
+			/*********************************************************************/
+
+			// Initial residue data (where in OpenMM?)
+
+			// For now, since OpenMM input files do not contain residue information
+			// I am assuming that they will always start with the N-terminus, just for testing.
+			// This is true for the villin.xml but may not be true in the future.
+			// need it to parallelize.
+
+			if( !mInitialized ) {
+				Initialize( context, params );
 			}
 
+			int n = 3 * mParticleCount;
+
 			// Diagonalize each block Hessian, get Eigenvectors
 			// Note: The eigenvalues will be placed in one large array, because
 			//       we must sort them to get k
@@ -248,12 +196,48 @@ namespace OpenMM {
 			std::vector<double> block_eigval( n );
 			Matrix block_eigvec( n, n );
 
-			DiagonalizeBlocks( h, positions, block_eigval, block_eigvec );
+			// Keep the block eigensystems for preconditioning the minimizer
+			std::shared_ptr<BlockPreconditioner> preconditioner;
+			if( params.ShouldPreconditionMinimizer ) {
+				preconditioner.reset( new BlockPreconditioner( n, blocks.size() ) );
+			}
+
+			if( params.RediagonalizationWorkers > 1 ) {
+				hessianTimer.Stop();
+				Profiler::Scope shardTimer( mProfiler, "Analysis::Shards" );
+
+				std::vector<size_t> start;
+				std::vector<Matrix> vectors;
+				DiagonalizeShards( context.getSystem(), positions, params, start, block_eigval, vectors, preconditioner.get() );
 
-			gettimeofday( &tp_diag, NULL );
+				for( size_t i = 0; i < vectors.size(); i++ ) {
+					for( size_t j = 0; j < vectors[i].Columns; j++ ) {
+						for( size_t k = 0; k < vectors[i].Rows; k++ ) {
+							block_eigvec( start[i] + k, start[i] + j ) = vectors[i]( k, j );
+						}
+					}
+				}
+			} else {
+				std::vector<Block> blockHessian;
+				ComputeBlockHessian( *blockContext, positions, params, 0, blocks.size(), blockHessian );
+
+				Matrix h( n, n );
+				for( size_t i = 0; i < blockHessian.size(); i++ ) {
+					const Block &block = blockHessian[i];
+					for( size_t j = 0; j < block.Data.Columns; j++ ) {
+						for( size_t k = 0; k < block.Data.Rows; k++ ) {
+							h( block.StartAtom + k, block.StartAtom + j ) = block.Data( k, j );
+						}
+					}
+				}
+				std::vector<Block>().swap( blockHessian );
+
+				hessianTimer.Stop();
+				Profiler::Scope diagonalizeTimer( mProfiler, "Analysis::DiagonalizeBlocks" );
 
-			const double diagElapsed = ( tp_diag.tv_sec - tp_hess.tv_sec ) * 1000.0 + ( tp_diag.tv_usec - tp_hess.tv_usec ) / 1000.0;
-			std::cout << "Time to diagonalize block hessian: " << diagElapsed << "ms" << std::endl;
+				DiagonalizeBlocks( h, positions, block_eigval, block_eigvec, preconditioner.get() );
+			}
+			Profiler::Scope eTimer( mProfiler, "Analysis::E" );
 
 			//***********************************************************
 			// This section here is only to find the cuttoff eigenvalue.
@@ -265,8 +249,13 @@ namespace OpenMM {
 			int max_eigs = params.bdof * blocks.size();
 			double cutEigen = sortedEvalues[max_eigs].first;  // This is the cutoff eigenvalue
 
+			if( preconditioner ) {
+				preconditioner->SetFloor( cutEigen );
+			}
+			mBlockPreconditioner = preconditioner;
+
 			// get cols of all eigenvalues under cutoff
-			std::vector<int> selectedEigsCols;
+			std::vector<size_t> selectedEigsCols;
 			for( int i = 0; i < n; i++ ) {
 				if( fabs( block_eigval[i] ) < cutEigen ) {
 					selectedEigsCols.push_back( i );
@@ -276,29 +265,17 @@ namespace OpenMM {
 			// we may select fewer eigs if there are duplicate eigenvalues
 			const int m = selectedEigsCols.size();
 
-			// Inefficient, needs to improve.
-			// Basically, just setting up E and E^T by
-			// copying values from bigE.
-			// Again, right now I'm only worried about
-			// correctness plus this time will be marginal compared to
-			// diagonalization.
 			Matrix E( n, m );
-			for( int i = 0; i < m; i++ ) {
-				int eig_col = selectedEigsCols[i];
-				for( int j = 0; j < n; j++ ) {
-					E( j, i ) = block_eigvec( j, eig_col );
-				}
-			}
-
-			gettimeofday( &tp_e, NULL );
+			GatherColumns( block_eigvec.View(), selectedEigsCols, E.View() );
+			block_eigvec = Matrix();
 
-			const double eElapsed = ( tp_e.tv_sec - tp_diag.tv_sec ) * 1000.0 + ( tp_e.tv_usec - tp_diag.tv_usec ) / 1000.0;
-			std::cout << "Time to compute E: " << eElapsed << "ms" << std::endl;
+			eTimer.Stop();
 
 			//WriteBlockEigs( E );
 
 			//*****************************************************************
 			// Compute S, which is equal to E^T * H * E.
+			Profiler::Scope heTimer( mProfiler, "Analysis::HE" );
 			Matrix S( m, m );
 			Matrix HE( n, m );
 			// Compute eps.
@@ -362,111 +339,330 @@ namespace OpenMM {
 			// restore unperturbed positions
 			context.setPositions( positions );
 
-			gettimeofday( &tp_s, NULL );
-
-			const double sElapsed = ( tp_s.tv_sec - tp_e.tv_sec ) * 1000.0 + ( tp_s.tv_usec - tp_e.tv_usec ) / 1000.0;
-			std::cout << "Time to compute S: " << sElapsed << "ms" << std::endl;
+			heTimer.Stop();
+			Profiler::Scope sTimer( mProfiler, "Analysis::S" );
 
 			MatrixMultiply( E, true, HE, false, S );
+			HE = Matrix();
 
-			// make S symmetric
-			for( unsigned int i = 0; i < S.Rows; i++ ) {
-				for( unsigned int j = 0; j < S.Columns; j++ ) {
-					double avg = 0.5f * ( S( i, j ) + S( j, i ) );
-					S( i, j ) = avg;
-					S( j, i ) = avg;
-				}
-			}
-
-			gettimeofday( &tp_s_matrix, NULL );
+			// make S symmetric, packing it frees the square copy before the solver runs
+			SymmetricMatrix packedS( S.View() );
+			S = Matrix();
 
-			const double sMatrixElapsed = ( tp_s_matrix.tv_sec - tp_s.tv_sec ) * 1000.0 + ( tp_s_matrix.tv_usec - tp_s.tv_usec ) / 1000.0;
-			std::cout << "Time to compute matrix S: " << sMatrixElapsed << "ms" << std::endl;
+			sTimer.Stop();
+			Profiler::Scope qTimer( mProfiler, "Analysis::Q" );
 
 			// Diagonalizing S by finding eigenvalues and eigenvectors...
 			std::vector<double> dS( m );
 			Matrix q( m, m );
-			FindEigenvalues( S, dS, q );
+			FindEigenvalues( packedS, dS, q.View() );
+			packedS = SymmetricMatrix();
 
 			// Sort by ABSOLUTE VALUE of eigenvalues.
 			sortedEvalues = SortEigenvalues( dS );
 
-			Matrix Q( q.Columns, q.Rows );
-			for( int i = 0; i < sortedEvalues.size(); i++ ) {
-				for( int j = 0; j < q.Columns; j++ ) {
-					Q( j, i ) = q( j, sortedEvalues[i].second );
-				}
+			std::vector<size_t> sortedColumns( sortedEvalues.size() );
+			for( size_t i = 0; i < sortedEvalues.size(); i++ ) {
+				sortedColumns[i] = sortedEvalues[i].second;
 			}
 
-			gettimeofday( &tp_q, NULL );
+			Matrix Q( q.Columns, q.Rows );
+			GatherColumns( q.View(), sortedColumns, Q.View() );
 
-			const double qElapsed = ( tp_q.tv_sec - tp_s.tv_sec ) * 1000.0 + ( tp_q.tv_usec - tp_s.tv_usec ) / 1000.0;
-			std::cout << "Time to compute Q: " << qElapsed << "ms" << std::endl;
+			qTimer.Stop();
 
 			Matrix U = CalculateU( E, Q );
 
-			gettimeofday( &tp_u, NULL );
-
-			const double uElapsed = ( tp_u.tv_sec - tp_q.tv_sec ) * 1000.0 + ( tp_u.tv_usec - tp_q.tv_usec ) / 1000.0;
-			std::cout << "Time to compute U: " << uElapsed << "ms" << std::endl;
 
+			// Published as a new basis, holders of the previous one keep it until they refresh
 			const unsigned int modes = params.modes;
-			eigenvectors.resize( modes, std::vector<Vec3>( mParticleCount ) );
+			std::shared_ptr<ModeBasis> basis( new ModeBasis( modes, mParticleCount ) );
 			for( unsigned int i = 0; i < modes; i++ ) {
-				for( unsigned int j = 0; j < mParticleCount; j++ ) {
-					eigenvectors[i][j] = Vec3( U( 3 * j, i ), U( 3 * j + 1, i ), U( 3 * j + 2, i ) );
+				double *mode = basis->Mode( i );
+				for( size_t j = 0; j < basis->Degrees(); j++ ) {
+					mode[j] = U( j, i );
 				}
 			}
-
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[Analysis] Compute Eigenvectors: " << elapsed << "ms" << std::endl;
+			mModeBasis = basis;
 		}
 
-		void Analysis::Initialize( Context &context, const Parameters &params ) {
-#ifdef PROFILE_ANALYSIS
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+		void Analysis::computeEigenvectors( Context &context, const Parameters &params ) {
+			Arena::Scope scope( mArena );
+			if( mMethod == Preference::Lean || mMethod == Preference::OutOfCore ) {
+				computeEigenvectorsLean( context, params );
+			} else {
+				computeEigenvectorsFull( context, params );
+			}
 
-			// Get Current System
-			const System &system = context.getSystem();
+			if( mArena ) {
+				mArena->Trim();
+			}
+		}
+
+		// Same result as computeEigenvectorsFull without any n x n or n x m storage. The block
+		// Hessians and E stay in block form, S is accumulated one column of HE at a time and
+		// only the requested modes of U are formed. Out of core, S and its eigenvectors live
+		// in scratch files and are written and read in column panels.
+		void Analysis::computeEigenvectorsLean( Context &context, const Parameters &params ) {
+			Profiler::Scope timer( mProfiler, "Analysis::ComputeEigenvectors" );
+			Profiler::Scope hessianTimer( mProfiler, "Analysis::Hessian" );
 
-			// Store Particle Information
 			std::vector<Vec3> positions = context.getState( State::Positions ).getPositions();
 
-			mParticleCount = positions.size();
+			if( !mInitialized ) {
+				Initialize( context, params );
+			}
 
-			mParticleMass.reserve( mParticleCount );
-			for( unsigned int i = 0; i < mParticleCount; i++ ) {
-				mParticleMass.push_back( system.getParticleMass( i ) );
+			const int n = 3 * mParticleCount;
+
+			std::shared_ptr<BlockPreconditioner> preconditioner;
+			if( params.ShouldPreconditionMinimizer ) {
+				preconditioner.reset( new BlockPreconditioner( n, blocks.size() ) );
 			}
 
-			// Create New System
-			System *blockSystem = new System();
-			std::cout << "res per block " << params.res_per_block << std::endl;
-			for( int i = 0; i < mParticleCount; i++ ) {
-				blockSystem->addParticle( mParticleMass[i] );
+			// Each block is diagonalized in its own frame, starting at degree of freedom zero
+			std::vector<size_t> start( blocks.size() );
+			std::vector<double> block_eigval( n );
+			std::vector<Matrix> block_eigvec( blocks.size() );
+
+			if( params.RediagonalizationWorkers > 1 ) {
+				hessianTimer.Stop();
+				Profiler::Scope shardTimer( mProfiler, "Analysis::Shards" );
+
+				DiagonalizeShards( context.getSystem(), positions, params, start, block_eigval, block_eigvec, preconditioner.get() );
+			} else {
+				std::vector<Block> hessian;
+				ComputeBlockHessian( *blockContext, positions, params, 0, blocks.size(), hessian );
+
+				hessianTimer.Stop();
+				Profiler::Scope diagonalizeTimer( mProfiler, "Analysis::DiagonalizeBlocks" );
+
+				#pragma omp parallel for
+				for( int i = 0; i < ( int ) hessian.size(); i++ ) {
+					start[i] = hessian[i].StartAtom;
+
+					std::vector<double> values, rawValues;
+					Matrix rawVectors;
+					DiagonalizeLocalBlock( hessian[i], positions, values, block_eigvec[i], preconditioner ? &rawValues : NULL, preconditioner ? &rawVectors : NULL );
+
+					if( preconditioner ) {
+						preconditioner->SetBlock( i, start[i], rawValues, rawVectors );
+					}
+
+					std::copy( values.begin(), values.end(), block_eigval.begin() + start[i] );
+				}
 			}
+			Profiler::Scope eTimer( mProfiler, "Analysis::E" );
 
-			int block_start = 0;
-			for( int i = 0; i < params.residue_sizes.size(); i++ ) {
-				if( i % params.res_per_block == 0 ) {
-					blocks.push_back( block_start );
+			std::vector<EigenvalueColumn> sortedEvalues = SortEigenvalues( block_eigval );
+
+			const int max_eigs = params.bdof * blocks.size();
+			const double cutEigen = sortedEvalues[max_eigs].first;
+
+			if( preconditioner ) {
+				preconditioner->SetFloor( cutEigen );
+			}
+			mBlockPreconditioner = preconditioner;
+
+			// Columns of E under the cutoff, kept per block. Block i owns columns
+			// [offset[i], offset[i + 1]) of E and S.
+			std::vector<Matrix> E( blocks.size() );
+			std::vector<size_t> offset( blocks.size() + 1, 0 );
+			for( size_t i = 0; i < blocks.size(); i++ ) {
+				const Matrix &vectors = block_eigvec[i];
+
+				std::vector<size_t> selected;
+				for( size_t j = 0; j < vectors.Columns; j++ ) {
+					if( fabs( block_eigval[start[i] + j] ) < cutEigen ) {
+						selected.push_back( j );
+					}
 				}
-				block_start += params.residue_sizes[i];
+
+				E[i] = Matrix( vectors.Rows, selected.size() );
+				GatherColumns( vectors.View(), selected, E[i].View() );
+				offset[i + 1] = offset[i] + selected.size();
+
+				block_eigvec[i] = Matrix();
 			}
 
-			for( int i = 1; i < blocks.size(); i++ ) {
-				int block_size = blocks[i] - blocks[i - 1];
-				if( block_size > mLargestBlockSize ) {
-					mLargestBlockSize = block_size;
+			const size_t m = offset.back();
+
+			eTimer.Stop();
+			Profiler::Scope heTimer( mProfiler, "Analysis::HE" );
+
+			// S and its eigenvectors, column major with leading dimension m
+			const bool outOfCore = ( mMethod == Preference::OutOfCore );
+			const size_t panel = MappedMatrix::PanelColumns( m, params.ScratchPanelBytes );
+
+			// In memory S is assembled packed and symmetric, out of core it is square so that
+			// every column is written in one place
+			SymmetricMatrix packedS;
+			Matrix::Storage memoryQ;
+			std::unique_ptr<MappedMatrix> mappedS, mappedQ;
+			double *S = NULL, *q = NULL;
+			if( outOfCore ) {
+				mappedS.reset( new MappedMatrix( m, m, params.ScratchDirectory ) );
+				mappedQ.reset( new MappedMatrix( m, m, params.ScratchDirectory ) );
+				S = mappedS->Column( 0 );
+				q = mappedQ->Column( 0 );
+			} else {
+				packedS = SymmetricMatrix( m );
+				memoryQ.resize( m * m );
+				q = &memoryQ[0];
+			}
+
+			std::vector<double> HE( n );
+			const double eps = params.sDelta;
+
+			std::vector<Vec3> tmppos( positions );
+
+#ifdef FIRST_ORDER
+			const std::vector<Vec3> forces_start = context.getState( State::Forces ).getForces();
+#endif
+
+			for( size_t b = 0; b < E.size(); b++ ) {
+				const size_t first = start[b] / 3, atoms = E[b].Rows / 3;
+
+				for( size_t c = 0; c < E[b].Columns; c++ ) {
+					const size_t k = offset[b] + c;
+
+					// Column k of E is zero outside block b
+					for( size_t i = 0; i < atoms; i++ ) {
+						for( unsigned int j = 0; j < 3; j++ ) {
+							tmppos[first + i][j] = positions[first + i][j] + eps * E[b]( 3 * i + j, c ) / sqrt( mParticleMass[first + i] );
+						}
+					}
+					context.setPositions( tmppos );
+					const std::vector<Vec3> forces_forward = context.getState( State::Forces ).getForces();
+
+#ifndef FIRST_ORDER
+					for( size_t i = 0; i < atoms; i++ ) {
+						for( unsigned int j = 0; j < 3; j++ ) {
+							tmppos[first + i][j] = positions[first + i][j] - eps * E[b]( 3 * i + j, c ) / sqrt( mParticleMass[first + i] );
+						}
+					}
+					context.setPositions( tmppos );
+					const std::vector<Vec3> forces_backward = context.getState( State::Forces ).getForces();
+#endif
+
+					for( int i = 0; i < n; i++ ) {
+#ifdef FIRST_ORDER
+						const double scaleFactor = sqrt( mParticleMass[i / 3] ) * 1.0 * eps;
+						HE[i] = ( forces_forward[i / 3][i % 3] - forces_start[i / 3][i % 3] ) / scaleFactor;
+#else
+						const double scaleFactor = sqrt( mParticleMass[i / 3] ) * 2.0 * eps;
+						HE[i] = ( forces_forward[i / 3][i % 3] - forces_backward[i / 3][i % 3] ) / scaleFactor;
+#endif
+					}
+
+					for( size_t i = 0; i < atoms; i++ ) {
+						tmppos[first + i] = positions[first + i];
+					}
+
+					// S( :, k ) = E^T HE( :, k ), one block of rows at a time
+					#pragma omp parallel for
+					for( int o = 0; o < ( int ) E.size(); o++ ) {
+						const Matrix &block = E[o];
+						for( size_t j = 0; j < block.Columns; j++ ) {
+							double sum = 0.0;
+							for( size_t r = 0; r < block.Rows; r++ ) {
+								sum += block( r, j ) * HE[start[o] + r];
+							}
+							if( outOfCore ) {
+								S[k * m + offset[o] + j] = sum;
+							} else {
+								packedS.Assemble( offset[o] + j, k, sum );
+							}
+						}
+					}
+
+					// Finished panels are written back rather than kept resident
+					if( outOfCore && ( k + 1 ) % panel == 0 ) {
+						mappedS->Release( k + 1 - panel, k + 1 );
+					}
 				}
 			}
 
-			mLargestBlockSize *= 3; // degrees of freedom in the largest block
-			std::cout << "blocks " << blocks.size() << std::endl;
-			std::cout << blocks[blocks.size() - 1] << std::endl;
+			context.setPositions( positions );
+
+			heTimer.Stop();
+			Profiler::Scope sTimer( mProfiler, "Analysis::S" );
+
+			// Tiles of whole panels so only two panels are touched at a time
+			for( size_t jStart = 0; outOfCore && jStart < m; jStart += panel ) {
+				const size_t jEnd = std::min( m, jStart + panel );
+				for( size_t iStart = 0; iStart <= jStart; iStart += panel ) {
+					const size_t iEnd = std::min( m, iStart + panel );
+					mappedS->Prefetch( iStart, iEnd );
+
+					#pragma omp parallel for
+					for( long long j = jStart; j < ( long long ) jEnd; j++ ) {
+						for( size_t i = iStart; i < std::min( iEnd, ( size_t ) j ); i++ ) {
+							const double avg = 0.5 * ( S[j * m + i] + S[i * m + j] );
+							S[j * m + i] = avg;
+							S[i * m + j] = avg;
+						}
+					}
+
+					if( iStart != jStart ) {
+						mappedS->Release( iStart, iEnd );
+					}
+				}
+				mappedS->Release( jStart, jEnd );
+			}
+
+			sTimer.Stop();
+			Profiler::Scope qTimer( mProfiler, "Analysis::Q" );
+
+			// S is only needed by the solver, which may overwrite it
+			std::vector<double> dS( m );
+			if( outOfCore ) {
+				FindEigenvalues( MatrixView( S, m, m ), dS, MatrixView( q, m, m ) );
+				mappedS.reset();
+			} else {
+				FindEigenvalues( packedS, dS, MatrixView( q, m, m ) );
+				packedS = SymmetricMatrix();
+			}
+
+			sortedEvalues = SortEigenvalues( dS );
+
+			qTimer.Stop();
+			Profiler::Scope uTimer( mProfiler, "Analysis::CalculateU" );
+
+			// U = E Q for the requested modes only
+			const unsigned int modes = params.modes;
+			std::shared_ptr<ModeBasis> basis( new ModeBasis( modes, mParticleCount ) );
+			for( unsigned int i = 0; i < modes; i++ ) {
+				const int col = sortedEvalues[i].second;
+				if( outOfCore ) {
+					mappedQ->Prefetch( col, col + 1 );
+				}
+
+				double *mode = basis->Mode( i );
+				for( size_t b = 0; b < E.size(); b++ ) {
+					const Matrix &block = E[b];
+					for( size_t r = 0; r < block.Rows; r++ ) {
+						double sum = 0.0;
+						for( size_t j = 0; j < block.Columns; j++ ) {
+							sum += block( r, j ) * q[col * m + offset[b] + j];
+						}
+						mode[start[b] + r] = sum;
+					}
+				}
+			}
+			mModeBasis = basis;
+		}
+
+		// Block system of blocks [first, last). It holds every particle but only the bonded
+		// terms and pairwise interactions inside those blocks.
+		System *Analysis::CreateBlockSystem( const System &system, const Parameters &params, const size_t first, const size_t last ) {
+			const int firstAtom = blocks[first];
+			const int lastAtom = ( last < blocks.size() ) ? blocks[last] : mParticleCount;
+
+			System *blockSystem = new System();
+			for( int i = 0; i < mParticleCount; i++ ) {
+				blockSystem->addParticle( mParticleMass[i] );
+			}
 
 			// Creating a whole new system called the blockSystem.
 			// This system will only contain bonds, angles, dihedrals, and impropers
@@ -478,10 +674,8 @@ namespace OpenMM {
 			// Copy all atoms into the block system.
 
 			// Copy the center of mass force.
-			std::cout << "adding forces..." << std::endl;
 			for( int i = 0; i < params.forces.size(); i++ ) {
 				std::string forcename = params.forces[i].name;
-				std::cout << "Adding force " << forcename << " at index " << params.forces[i].index << std::endl;
 				if( forcename == "RemoveCMMotion" ) {
 					const CMMotionRemover *cm = dynamic_cast<const CMMotionRemover *>(  &system.getForce( params.forces[i].index ) );
 					blockSystem->addForce( new CMMotionRemover( cm->getFrequency() ));
@@ -497,7 +691,7 @@ namespace OpenMM {
 						int particle1, particle2;
 						double length, k;
 						ohf->getBondParameters( i, particle1, particle2, length, k );
-						if( inSameBlock( particle1, particle2 ) ) {
+						if( inSameBlock( particle1, particle2 ) && ( particle1 >= firstAtom && particle1 < lastAtom ) ) {
 							hf->addBond( particle1, particle2, length, k );
 						}
 					}
@@ -511,7 +705,7 @@ namespace OpenMM {
 						int particle1, particle2, particle3;
 						double angle, k;
 						ahf->getAngleParameters( i, particle1, particle2, particle3, angle, k );
-						if( inSameBlock( particle1, particle2, particle3 ) ) {
+						if( inSameBlock( particle1, particle2, particle3 ) && ( particle1 >= firstAtom && particle1 < lastAtom ) ) {
 							af->addAngle( particle1, particle2, particle3, angle, k );
 						}
 					}
@@ -525,7 +719,7 @@ namespace OpenMM {
 						int particle1, particle2, particle3, particle4, periodicity;
 						double phase, k;
 						optf->getTorsionParameters( i, particle1, particle2, particle3, particle4, periodicity, phase, k );
-						if( inSameBlock( particle1, particle2, particle3, particle4 ) ) {
+						if( inSameBlock( particle1, particle2, particle3, particle4 ) && ( particle1 >= firstAtom && particle1 < lastAtom ) ) {
 							ptf->addTorsion( particle1, particle2, particle3, particle4, periodicity, phase, k );
 						}
 					}
@@ -539,7 +733,7 @@ namespace OpenMM {
 						int particle1, particle2, particle3, particle4;
 						double c0, c1, c2, c3, c4, c5;
 						orbtf->getTorsionParameters( i, particle1, particle2, particle3, particle4, c0, c1, c2, c3, c4, c5 );
-						if( inSameBlock( particle1, particle2, particle3, particle4 ) ) {
+						if( inSameBlock( particle1, particle2, particle3, particle4 ) && ( particle1 >= firstAtom && particle1 < lastAtom ) ) {
 							rbtf->addTorsion( particle1, particle2, particle3, particle4, c0, c1, c2, c3, c4, c5 );
 						}
 					}
@@ -564,7 +758,7 @@ namespace OpenMM {
 						int p1, p2;
 						double q, sig, eps;
 						nbf->getExceptionParameters( i, p1, p2, q, sig, eps );
-						if( inSameBlock( p1, p2 ) ) {
+						if( inSameBlock( p1, p2 ) && ( p1 >= firstAtom && p1 < lastAtom ) ) {
 							std::vector<double> params;
 							params.push_back( q );
 							params.push_back( sig );
@@ -581,8 +775,8 @@ namespace OpenMM {
 
 					// add particle params
 					// TODO: iterate over block dimensions to reduce to O(b^2 N_b)
-					for( int i = 0; i < nbf->getNumParticles() - 1; i++ ) {
-						for( int j = i + 1; j < nbf->getNumParticles(); j++ ) {
+					for( int i = firstAtom; i < lastAtom - 1; i++ ) {
+						for( int j = i + 1; j < lastAtom; j++ ) {
 							if( !inSameBlock( i, j ) ) {
 								continue;
 							}
@@ -617,6 +811,53 @@ namespace OpenMM {
 					std::cout << "Unknown Force: " << forcename << std::endl;
 				}
 			}
+
+			return blockSystem;
+		}
+
+		void Analysis::Initialize( Context &context, const Parameters &params ) {
+			Profiler::Scope timer( mProfiler, "Analysis::Initialize" );
+
+			// Get Current System
+			const System &system = context.getSystem();
+
+			// Store Particle Information
+			std::vector<Vec3> positions = context.getState( State::Positions ).getPositions();
+
+			mParticleCount = positions.size();
+
+			mParticleMass.reserve( mParticleCount );
+			for( unsigned int i = 0; i < mParticleCount; i++ ) {
+				mParticleMass.push_back( system.getParticleMass( i ) );
+			}
+
+			std::cout << "res per block " << params.res_per_block << std::endl;
+			int block_start = 0;
+			for( int i = 0; i < params.residue_sizes.size(); i++ ) {
+				if( i % params.res_per_block == 0 ) {
+					blocks.push_back( block_start );
+				}
+				block_start += params.residue_sizes[i];
+			}
+
+			// The last block runs to the end of the system and may be the largest
+			for( int i = 0; i < blocks.size(); i++ ) {
+				int block_size = ( ( i + 1 < blocks.size() ) ? blocks[i + 1] : mParticleCount ) - blocks[i];
+				if( block_size > mLargestBlockSize ) {
+					mLargestBlockSize = block_size;
+				}
+			}
+
+			mLargestBlockSize *= 3; // degrees of freedom in the largest block
+			std::cout << "blocks " << blocks.size() << std::endl;
+			std::cout << blocks[blocks.size() - 1] << std::endl;
+
+			std::cout << "adding forces..." << std::endl;
+			for( int i = 0; i < params.forces.size(); i++ ) {
+				std::cout << "Adding force " << params.forces[i].name << " at index " << params.forces[i].index << std::endl;
+			}
+
+			System *blockSystem = CreateBlockSystem( system, params, 0, blocks.size() );
 			std::cout << "done." << std::endl;
 
 			VerletIntegrator *integ = new VerletIntegrator( 0.000001 );
@@ -659,17 +900,11 @@ namespace OpenMM {
 
 			mInitialized = true;
 
-#ifdef PROFILE_ANALYSIS
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[Analysis] Initialize: " << elapsed << "ms" << std::endl;
-#endif
 		}
 
-		void Analysis::DiagonalizeBlocks( const Matrix &hessian, const std::vector<Vec3> &positions, std::vector<double> &eval, Matrix &evec ) {
-			std::vector<Block> HTilde( blocks.size() );
-
-			// Create Blocks
+		void Analysis::DiagonalizeBlocks( const Matrix &hessian, const std::vector<Vec3> &positions, std::vector<double> &eval, Matrix &evec, BlockPreconditioner *preconditioner ) {
+			// Diagonalize Blocks
+			#pragma omp parallel for
 			for( int i = 0; i < blocks.size(); i++ ) {
 				// Find block size
 				const int startatom = 3 * blocks[i];
@@ -679,24 +914,188 @@ namespace OpenMM {
 					endatom = 3 * blocks[i + 1] - 1;
 				}
 
-				HTilde[i].StartAtom = startatom;
-				HTilde[i].EndAtom = endatom;
-				HTilde[i].Data = Matrix( endatom - startatom + 1, endatom - startatom + 1 );
+				const unsigned int size = endatom - startatom + 1;
+
+				printf( "Diagonalizing Block: %d\n", i );
+
+				// Packed working copy of the diagonal block, the eigenvectors go straight into evec
+				SymmetricMatrix block( hessian.View( startatom, startatom, size, size ) );
+				std::vector<double> values( size );
+				FindEigenvalues( block, values, evec.View( startatom, startatom, size, size ) );
+				std::copy( values.begin(), values.end(), eval.begin() + startatom );
+
+				// GeometricDOF overwrites the block eigenvectors
+				if( preconditioner ) {
+					preconditioner->SetBlock( i, startatom, values, Matrix( evec.View( startatom, startatom, size, size ) ) );
+				}
+
+				GeometricDOF( size, startatom, endatom, positions, mParticleMass, eval, evec );
+			}
+		}
+
+		void Analysis::DiagonalizeLocalBlock( Block &block, const std::vector<Vec3> &positions, std::vector<double> &values, Matrix &vectors, std::vector<double> *rawValues, Matrix *rawVectors ) const {
+			const unsigned int size = block.Data.Rows, start = block.StartAtom;
+
+			block.StartAtom = 0;
+			block.EndAtom = size - 1;
+
+			values.assign( size, 0.0 );
+			vectors = Matrix( size, size );
+			DiagonalizeBlock( block, positions, mParticleMass, values, vectors );
+
+			block.Data = SymmetricMatrix();
+
+			if( rawValues && rawVectors ) {
+				*rawValues = values;
+				*rawVectors = vectors;
+			}
+
+			const std::vector<Vec3> blockPositions( positions.begin() + start / 3, positions.begin() + ( start + size ) / 3 );
+			const std::vector<double> blockMasses( mParticleMass.begin() + start / 3, mParticleMass.begin() + ( start + size ) / 3 );
+			GeometricDOF( size, 0, size - 1, blockPositions, blockMasses, values, vectors );
+		}
+
+		std::vector<size_t> Analysis::Shards( const std::vector<size_t> &sizes, const size_t workers ) {
+			const size_t count = std::max<size_t>( std::min( workers, sizes.size() ), 1 );
 
-				// Copy data from big hessian
-				for( int j = startatom; j <= endatom; j++ ) {
-					for( int k = startatom; k <= endatom; k++ ) {
-						HTilde[i].Data( k - startatom, j - startatom ) = hessian( k, j );
+			// Both the Hessian and the diagonalization of a block grow with its size cubed
+			double remaining = 0.0;
+			for( size_t i = 0; i < sizes.size(); i++ ) {
+				remaining += ( double ) sizes[i] * sizes[i] * sizes[i];
+			}
+
+			std::vector<size_t> retVal( 1, 0 );
+			size_t block = 0;
+			for( size_t shard = 0; shard + 1 < count; shard++ ) {
+				const double target = remaining / ( count - shard );
+
+				// Take blocks while that brings the shard closer to its share, leaving at
+				// least one block for each shard after it
+				double weight = 0.0;
+				while( block + ( count - shard - 1 ) < sizes.size() ) {
+					const double cost = ( double ) sizes[block] * sizes[block] * sizes[block];
+					if( weight > 0.0 && weight + 0.5 * cost > target ) {
+						break;
 					}
+					weight += cost;
+					block++;
 				}
+
+				remaining -= weight;
+				retVal.push_back( block );
 			}
+			retVal.push_back( sizes.size() );
 
-			// Diagonalize Blocks
-			#pragma omp parallel for
-			for( int i = 0; i < blocks.size(); i++ ) {
-				printf( "Diagonalizing Block: %d\n", i );
-				DiagonalizeBlock( HTilde[i], positions, mParticleMass, eval, evec );
-				GeometricDOF( HTilde[i].Data.Rows, HTilde[i].StartAtom, HTilde[i].EndAtom, positions, mParticleMass, eval, evec );
+			return retVal;
+		}
+
+		// Worker side of DiagonalizeShards, fills the region entries of blocks [first, last)
+		void Analysis::DiagonalizeShard( const System &system, const std::vector<Vec3> &positions, const Parameters &params, const size_t first, const size_t last,
+										 const std::vector<size_t> &offset, const bool precondition, double *region ) {
+			std::unique_ptr<System> shardSystem( CreateBlockSystem( system, params, first, last ) );
+			VerletIntegrator integrator( 0.000001 );
+			Context shardContext( *shardSystem, integrator, Platform::getPlatformByName( "Reference" ) );
+
+			std::vector<Block> hessian;
+			ComputeBlockHessian( shardContext, positions, params, first, last, hessian );
+
+			for( size_t i = first; i < last; i++ ) {
+				const size_t size = hessian[i - first].Data.Rows;
+
+				std::vector<double> values, rawValues;
+				Matrix vectors, rawVectors;
+				DiagonalizeLocalBlock( hessian[i - first], positions, values, vectors, precondition ? &rawValues : NULL, precondition ? &rawVectors : NULL );
+
+				double *entry = region + offset[i];
+				std::copy( values.begin(), values.end(), entry );
+				std::copy( vectors.Data.begin(), vectors.Data.end(), entry + size );
+				if( precondition ) {
+					std::copy( rawValues.begin(), rawValues.end(), entry + size + size * size );
+					std::copy( rawVectors.Data.begin(), rawVectors.Data.end(), entry + 2 * size + size * size );
+				}
+			}
+		}
+
+		// Each worker thread builds a block system and Reference context for its own shard of
+		// blocks, so the single block context no longer serializes them. Results are written
+		// to disjoint entries of one region holding, per block, the eigenvalues and
+		// eigenvectors after GeometricDOF and, when preconditioning, the raw ones. The OpenMP
+		// threads of this one are divided between the workers, and the first exception thrown
+		// by a worker is raised once all of them have finished.
+		void Analysis::DiagonalizeShards( const System &system, const std::vector<Vec3> &positions, const Parameters &params, std::vector<size_t> &start,
+										  std::vector<double> &eval, std::vector<Matrix> &evec, BlockPreconditioner *preconditioner ) {
+			const size_t count = blocks.size(), copies = preconditioner ? 2 : 1;
+
+			std::vector<size_t> sizes( count ), offset( count + 1, 0 );
+			start.resize( count );
+			evec.resize( count );
+			for( size_t i = 0; i < count; i++ ) {
+				start[i] = 3 * blocks[i];
+				sizes[i] = ( ( i + 1 < count ) ? 3 * blocks[i + 1] : 3 * mParticleCount ) - start[i];
+				offset[i + 1] = offset[i] + copies * ( sizes[i] + sizes[i] * sizes[i] );
+			}
+
+			const std::vector<size_t> shards = Shards( sizes, params.RediagonalizationWorkers );
+			const size_t workers = shards.size() - 1;
+
+			std::vector<double> memory( std::max<size_t>( offset.back(), 1 ) );
+			double *region = &memory[0];
+
+			int threads = 1;
+#ifdef _OPENMP
+			threads = std::max( omp_get_max_threads() / ( int ) workers, 1 );
+#endif
+
+			std::vector<std::exception_ptr> failures( workers );
+			auto worker = [&]( const size_t s ) {
+#ifdef _OPENMP
+				omp_set_num_threads( threads );
+#endif
+				try {
+					DiagonalizeShard( system, positions, params, shards[s], shards[s + 1], offset, preconditioner != NULL, region );
+				} catch( ... ) {
+					failures[s] = std::current_exception();
+				}
+			};
+
+			std::vector<std::thread> pool;
+			for( size_t s = 1; s < workers; s++ ) {
+				pool.push_back( std::thread( worker, s ) );
+			}
+
+			// The calling thread takes the first shard and keeps its own OpenMP setting
+#ifdef _OPENMP
+			const int previous = omp_get_max_threads();
+#endif
+			worker( 0 );
+#ifdef _OPENMP
+			omp_set_num_threads( previous );
+#endif
+
+			for( size_t i = 0; i < pool.size(); i++ ) {
+				pool[i].join();
+			}
+
+			for( size_t s = 0; s < workers; s++ ) {
+				if( failures[s] ) {
+					std::rethrow_exception( failures[s] );
+				}
+			}
+
+			for( size_t i = 0; i < count; i++ ) {
+				const size_t size = sizes[i];
+				const double *entry = region + offset[i];
+
+				std::copy( entry, entry + size, eval.begin() + start[i] );
+				evec[i] = Matrix( size, size );
+				std::copy( entry + size, entry + size + size * size, evec[i].Data.begin() );
+
+				if( preconditioner ) {
+					const std::vector<double> values( entry + size + size * size, entry + 2 * size + size * size );
+					Matrix vectors( size, size );
+					std::copy( entry + 2 * size + size * size, entry + 2 * size + 2 * size * size, vectors.Data.begin() );
+					preconditioner->SetBlock( i, start[i], values, vectors );
+				}
 			}
 		}
 
@@ -704,16 +1103,11 @@ namespace OpenMM {
 			const unsigned int size = block.Data.Rows;
 
 			// 3. Diagonalize the block Hessian only, and get eigenvectors
+			SymmetricMatrix temp( block.Data );
 			std::vector<double> di( size );
-			Matrix Qi( size, size );
-			FindEigenvalues( block.Data, di, Qi );
+			FindEigenvalues( temp, di, evec.View( block.StartAtom, block.StartAtom, size, size ) );
 
-			for( int j = 0; j < size; j++ ) {
-				eval[block.StartAtom + j] = di[j];
-				for( int k = 0; k < size; k++ ) {
-					evec( block.StartAtom + k, block.StartAtom + j ) = Qi( k, j );
-				}
-			}
+			std::copy( di.begin(), di.end(), eval.begin() + block.StartAtom );
 		}
 
 		void Analysis::GeometricDOF( const int size, const int start, const int end, const std::vector<Vec3> &positions, const std::vector<double> &Mass, std::vector<double> &eval, Matrix &evec ) {
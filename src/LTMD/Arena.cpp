@@ -0,0 +1,201 @@
+#include "LTMD/Arena.h"
+#include "LTMD/Aligned.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace OpenMM {
+	namespace LTMD {
+		// Every aligned block starts with this header, the caller's memory begins
+		// AlignmentBytes after it. Owner is NULL for blocks that go back to the system.
+		struct Arena::Header {
+			Arena *Owner;
+			size_t Capacity;
+			uint64_t Generation;
+		};
+
+		static thread_local Arena *sCurrent = NULL;
+
+		static void *SystemAllocate( const size_t bytes, const size_t alignment ) {
+			void *memory = NULL;
+#ifdef _WIN32
+			memory = _aligned_malloc( bytes, alignment );
+#else
+			if( posix_memalign( &memory, alignment, bytes ) != 0 ) {
+				memory = NULL;
+			}
+#endif
+			return memory;
+		}
+
+		static void SystemFree( void *memory ) {
+#ifdef _WIN32
+			_aligned_free( memory );
+#else
+			free( memory );
+#endif
+		}
+
+		void *AlignedAllocate( const size_t bytes ) {
+			Arena *arena = Arena::Current();
+			if( arena != NULL && bytes >= Arena::MinimumBytes ) {
+				return arena->Allocate( bytes );
+			}
+
+			Arena::Header *header = static_cast<Arena::Header *>( SystemAllocate( AlignmentBytes + bytes, AlignmentBytes ) );
+			if( header == NULL ) {
+				throw std::bad_alloc();
+			}
+
+			header->Owner = NULL;
+			header->Capacity = bytes;
+			header->Generation = 0;
+
+			return reinterpret_cast<char *>( header ) + AlignmentBytes;
+		}
+
+		void AlignedFree( void *memory ) {
+			if( memory == NULL ) {
+				return;
+			}
+
+			Arena::Header *header = reinterpret_cast<Arena::Header *>( static_cast<char *>( memory ) - AlignmentBytes );
+			if( header->Owner != NULL ) {
+				header->Owner->Release( header );
+			} else {
+				SystemFree( header );
+			}
+		}
+
+		Arena::Scope::Scope( Arena *arena ) : mPrevious( sCurrent ) {
+			sCurrent = arena;
+		}
+
+		Arena::Scope::~Scope() {
+			sCurrent = mPrevious;
+		}
+
+		Arena::Arena( const bool hugePages ) : mHugePages( hugePages ), mGeneration( 0 ) {
+			mStatistics.InUseBytes = mStatistics.PeakBytes = mStatistics.ReservedBytes = 0;
+			mStatistics.Allocations = mStatistics.Reused = 0;
+		}
+
+		Arena::~Arena() {
+			std::lock_guard<std::mutex> lock( mMutex );
+
+			for( std::multimap<size_t, Header *>::iterator it = mFree.begin(); it != mFree.end(); ++it ) {
+				SystemFree( it->second );
+			}
+
+			for( std::set<Header *>::iterator it = mUsed.begin(); it != mUsed.end(); ++it ) {
+				( *it )->Owner = NULL;
+			}
+		}
+
+		Arena *Arena::Current() {
+			return sCurrent;
+		}
+
+		void *Arena::Allocate( const size_t bytes ) {
+			std::lock_guard<std::mutex> lock( mMutex );
+
+			// Best fit among cached blocks, wasting at most a quarter of the block
+			Header *header = NULL;
+			std::multimap<size_t, Header *>::iterator it = mFree.lower_bound( bytes );
+			if( it != mFree.end() && it->first <= bytes + bytes / 4 ) {
+				header = it->second;
+				mFree.erase( it );
+				mStatistics.Reused++;
+			} else {
+				const bool huge = mHugePages && bytes >= HugePageBytes;
+				const size_t alignment = huge ? HugePageBytes : AlignmentBytes;
+				const size_t total = huge ? ( AlignmentBytes + bytes + HugePageBytes - 1 ) / HugePageBytes * HugePageBytes : AlignmentBytes + bytes;
+
+				header = static_cast<Header *>( SystemAllocate( total, alignment ) );
+				if( header == NULL && !mFree.empty() ) {
+					// Cached blocks that did not fit may be what is missing
+					for( it = mFree.begin(); it != mFree.end(); ++it ) {
+						mStatistics.ReservedBytes -= AlignmentBytes + it->first;
+						SystemFree( it->second );
+					}
+					mFree.clear();
+
+					header = static_cast<Header *>( SystemAllocate( total, alignment ) );
+				}
+				if( header == NULL ) {
+					throw std::bad_alloc();
+				}
+
+#if !defined( _WIN32 ) && defined( MADV_HUGEPAGE )
+				if( huge ) {
+					madvise( header, total, MADV_HUGEPAGE );
+				}
+#endif
+
+				header->Owner = this;
+				header->Capacity = total - AlignmentBytes;
+				mStatistics.ReservedBytes += total;
+			}
+
+			header->Generation = mGeneration;
+			mUsed.insert( header );
+
+			mStatistics.Allocations++;
+			mStatistics.InUseBytes += AlignmentBytes + header->Capacity;
+			mStatistics.PeakBytes = std::max( mStatistics.PeakBytes, mStatistics.InUseBytes );
+
+			return reinterpret_cast<char *>( header ) + AlignmentBytes;
+		}
+
+		void Arena::Release( Header *header ) {
+			std::lock_guard<std::mutex> lock( mMutex );
+
+			mUsed.erase( header );
+			mStatistics.InUseBytes -= AlignmentBytes + header->Capacity;
+
+			header->Generation = mGeneration;
+			mFree.insert( std::make_pair( header->Capacity, header ) );
+		}
+
+		void Arena::Trim() {
+			std::lock_guard<std::mutex> lock( mMutex );
+
+			for( std::multimap<size_t, Header *>::iterator it = mFree.begin(); it != mFree.end(); ) {
+				if( it->second->Generation != mGeneration ) {
+					mStatistics.ReservedBytes -= AlignmentBytes + it->first;
+					SystemFree( it->second );
+					mFree.erase( it++ );
+				} else {
+					++it;
+				}
+			}
+
+			mGeneration++;
+		}
+
+		Arena::Statistics Arena::GetStatistics() const {
+			std::lock_guard<std::mutex> lock( mMutex );
+			return mStatistics;
+		}
+
+		std::string Arena::Report() const {
+			const Statistics statistics = GetStatistics();
+
+			std::ostringstream stream;
+			stream.setf( std::ios::fixed );
+			stream.precision( 1 );
+			stream << "Arena: " << statistics.InUseBytes / ( 1024.0 * 1024.0 ) << " MiB in use, peak "
+				   << statistics.PeakBytes / ( 1024.0 * 1024.0 ) << " MiB, " << statistics.ReservedBytes / ( 1024.0 * 1024.0 ) << " MiB reserved, "
+				   << statistics.Allocations << " allocations (" << statistics.Reused << " reused)";
+			return stream.str();
+		}
+	}
+}
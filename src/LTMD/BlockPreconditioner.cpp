@@ -0,0 +1,76 @@
+#include "LTMD/BlockPreconditioner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace OpenMM {
+	namespace LTMD {
+		BlockPreconditioner::BlockPreconditioner( const size_t degrees, const size_t blocks ) : mDegrees( degrees ), mFloor( 1.0 ), mBlocks( blocks ), mCovered( degrees, 0 ) {
+			for( size_t i = 0; i < mBlocks.size(); i++ ) {
+				mBlocks[i].Start = 0;
+				mBlocks[i].Size = 0;
+			}
+		}
+
+		void BlockPreconditioner::SetBlock( const size_t index, const size_t start, const std::vector<double> &values, const Matrix &vectors ) {
+			Eigensystem &block = mBlocks[index];
+			block.Start = start;
+			block.Size = values.size();
+			block.Values = values;
+
+			for( size_t j = 0; j < block.Size; j++ ) {
+				mCovered[start + j] = 1;
+			}
+
+			// Column k holds eigenvector k
+			block.Vectors.resize( block.Size * block.Size );
+			for( size_t k = 0; k < block.Size; k++ ) {
+				for( size_t j = 0; j < block.Size; j++ ) {
+					block.Vectors[k * block.Size + j] = vectors( j, k );
+				}
+			}
+		}
+
+		void BlockPreconditioner::SetFloor( const double floor ) {
+			mFloor = floor;
+		}
+
+		void BlockPreconditioner::Apply( const double *in, double *out ) const {
+			const double inverseFloor = 1.0 / mFloor;
+			for( size_t i = 0; i < mDegrees; i++ ) {
+				if( !mCovered[i] ) {
+					out[i] = in[i] * inverseFloor;
+				}
+			}
+
+			#pragma omp parallel for schedule( dynamic )
+			for( long long i = 0; i < ( long long ) mBlocks.size(); i++ ) {
+				const Eigensystem &block = mBlocks[i];
+				const double *x = in + block.Start;
+				double *y = out + block.Start;
+
+				// Coefficients in the block eigenbasis, scaled by the inverse curvature
+				std::vector<double> coefficients( block.Size );
+				for( size_t k = 0; k < block.Size; k++ ) {
+					const double *vector = &block.Vectors[k * block.Size];
+
+					double sum = 0.0;
+					for( size_t j = 0; j < block.Size; j++ ) {
+						sum += vector[j] * x[j];
+					}
+					coefficients[k] = sum / std::max( std::fabs( block.Values[k] ), mFloor );
+				}
+
+				for( size_t j = 0; j < block.Size; j++ ) {
+					y[j] = 0.0;
+				}
+				for( size_t k = 0; k < block.Size; k++ ) {
+					const double *vector = &block.Vectors[k * block.Size];
+					for( size_t j = 0; j < block.Size; j++ ) {
+						y[j] += vector[j] * coefficients[k];
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#include <cstdio>
+#include "OpenMM.h"
+#include "LTMD/CPU/KernelFactory.h"
+#include "LTMD/StepKernel.h"
+#include "openmm/internal/windowsExport.h"
+
+using namespace OpenMM;
+
+extern "C" void registerPlatforms() {
+
+}
+
+extern "C" void registerKernelFactories() {
+	try {
+		Platform &platform = Platform::getPlatformByName( "CPU" );
+		platform.registerKernelFactory( LTMD::StepKernel::Name(), new LTMD::CPU::KernelFactory() );
+		printf( "Registered LTMD CPU plugin... \n" );
+	} catch( const std::exception &exc ) {
+		printf( "LTMD CPU platform not found. %s\n", exc.what() );
+	}
+}
@@ -0,0 +1,22 @@
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/ContextImpl.h"
+
+#include "LTMD/CPU/StepKernel.h"
+#include "LTMD/CPU/KernelFactory.h"
+
+#include "CpuPlatform.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		namespace CPU {
+			KernelImpl *KernelFactory::createKernelImpl( std::string name, const Platform &platform, ContextImpl &context ) const {
+				ReferencePlatform::PlatformData &data = *static_cast<ReferencePlatform::PlatformData *>( context.getPlatformData() );
+				if( name == StepKernel::Name() ) {
+					// Share the thread count the platform uses for its force kernels
+					return new CPU::StepKernel( name, platform, data, CpuPlatform::getPlatformData( context ).threads.getNumThreads() );
+				}
+				throw OpenMMException( ( std::string( "Tried to create kernel with illegal kernel name '" ) + name + "'" ).c_str() );
+			}
+		}
+	}
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LTMD/CPU/StepKernel.h"
+#include "LTMD/ProjectionBatch.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/ContextImpl.h"
+#include "RealVec.h"
+#include "SimTKOpenMMUtilities.h"
+
+// Without OpenMP every loop below would run on a single thread
+#ifndef _OPENMP
+#error "The LTMD CPU kernel requires OpenMP"
+#endif
+
+namespace OpenMM {
+	namespace LTMD {
+		namespace CPU {
+			static_assert( sizeof( RealVec ) == 3 * sizeof( double ), "CPU kernel requires contiguous double precision vectors" );
+
+			StepKernel::StepKernel( std::string name, const Platform &platform, ReferencePlatform::PlatformData &data, const int threads )
+				: LTMD::StepKernel( name, platform ), mParticles( 0 ), mDegrees( 0 ), mThreads( std::max( threads, 1 ) ), mShouldPrefillNoise( false ), mHasPreviousPositions( false ),
+				  mPreviousEnergy( 0.0 ), mMinimizerScale( 1.0 ), data( data ) {
+			}
+
+			StepKernel::~StepKernel() {
+
+			}
+
+			static std::vector<RealVec> &PositionArray( ReferencePlatform::PlatformData &data ) {
+				return *( ( std::vector<RealVec> * ) data.positions );
+			}
+
+			double *StepKernel::Positions() {
+				return &PositionArray( data )[0][0];
+			}
+
+			// The first move after accepting goes into the spare buffer, later ones in place
+			double *StepKernel::MoveTarget() {
+				return mHasPreviousPositions ? Positions() : &mPreviousPositions[0][0];
+			}
+
+			void StepKernel::CommitMove() {
+				if( !mHasPreviousPositions ) {
+					PositionArray( data ).swap( mPreviousPositions );
+					mHasPreviousPositions = true;
+				}
+			}
+
+			double *StepKernel::Velocities() {
+				return &( *( ( std::vector<RealVec> * ) data.velocities ) )[0][0];
+			}
+
+			double *StepKernel::Forces() {
+				return &( *( ( std::vector<RealVec> * ) data.forces ) )[0][0];
+			}
+
+			void StepKernel::initialize( const System &system, const Integrator &integrator ) {
+				mParticles = system.getNumParticles();
+				mDegrees = 3 * ( long long ) mParticles;
+
+				// The modes are mass weighted, a massless particle has no place in them
+				mMasses.resize( mParticles );
+				mInverseMasses.resize( mDegrees );
+				mInverseRootMasses.resize( mDegrees );
+				for( unsigned int i = 0; i < mParticles; ++i ) {
+					mMasses[i] = system.getParticleMass( i );
+					if( mMasses[i] <= 0.0 ) {
+						throw OpenMMException( "LTMD CPU kernel does not support massless particles" );
+					}
+
+					const double inverse = 1.0 / mMasses[i];
+					for( unsigned int j = 0; j < 3; j++ ) {
+						mInverseMasses[3 * i + j] = inverse;
+						mInverseRootMasses[3 * i + j] = std::sqrt( inverse );
+					}
+				}
+
+				mXPrime.resize( mDegrees );
+				mPreviousPositions.resize( mParticles );
+				mHasPreviousPositions = false;
+
+				mProjection.SetMasses( mMasses );
+				mProjection.SetSinglePrecision( integrator.getParameters().ShouldUseSinglePrecisionModes );
+
+				mRandom.SetSeed( ( uint32_t ) integrator.getRandomNumberSeed() );
+				mShouldPrefillNoise = integrator.getParameters().ShouldPrefillNoise;
+			}
+
+			void StepKernel::Integrate( ContextImpl &context, const Integrator &integrator ) {
+				// Calculate Constants
+				const double deltaT = integrator.getStepSize();
+				const double friction = integrator.getFriction();
+				const double tau = friction == 0.0 ? 0.0 : 1.0 / friction;
+
+				const double vscale = EXP( -deltaT / tau );
+				const double fscale = ( 1 - vscale ) * tau;
+				const double noisescale = std::sqrt( BOLTZ * integrator.getTemperature() * ( 1 - vscale * vscale ) );
+
+				const double *coordinates = Positions();
+				double *velocities = Velocities();
+				const double *forces = Forces();
+				const double *inverseMasses = &mInverseMasses[0], *inverseRootMasses = &mInverseRootMasses[0];
+
+				// Noise is keyed by seed and step so it is independent of thread count
+				const double *gaussian = &mRandom.Normal( data.stepCount, mDegrees )[0];
+
+				// Update the velocity.
+				#pragma omp parallel for simd num_threads( mThreads )
+				for( long long i = 0; i < mDegrees; i++ ) {
+					velocities[i] = vscale * velocities[i] + fscale * forces[i] * inverseMasses[i] + noisescale * gaussian[i] * inverseRootMasses[i];
+				}
+
+				// Overlap generating the next step's noise with projection and minimization
+				if( mShouldPrefillNoise ) {
+					mRandom.Prefill( data.stepCount + 1, mDegrees );
+				}
+
+				// Project resulting velocities onto subspace
+				Project( integrator, velocities, velocities, Projection::Mass, false );
+
+				// Update the positions.
+				double *target = MoveTarget();
+				#pragma omp parallel for simd num_threads( mThreads )
+				for( long long i = 0; i < mDegrees; i++ ) {
+					target[i] = coordinates[i] + deltaT * velocities[i];
+				}
+				CommitMove();
+			}
+
+			void StepKernel::UpdateTime( const Integrator &integrator ) {
+				data.time += integrator.getStepSize();
+				data.stepCount++;
+			}
+
+			// The first move after accepting, by Integrate or either minimizer, is swapped in from
+			// the spare buffer, leaving the accepted positions there for RejectStep
+			void StepKernel::AcceptStep( ContextImpl &context ) {
+				mHasPreviousPositions = false;
+				mMinimizerScale = 1.0;
+			}
+
+			void StepKernel::RejectStep( ContextImpl &context ) {
+				if( mHasPreviousPositions ) {
+					PositionArray( data ).swap( mPreviousPositions );
+					mHasPreviousPositions = false;
+				}
+				mMinimizerScale *= 0.25;
+			}
+
+			void StepKernel::LinearMinimize( ContextImpl &context, const Integrator &integrator, const double energy ) {
+				const double *coordinates = Positions();
+				double *target = MoveTarget();
+				double *xPrime = &mXPrime[0];
+				const double *inverseMasses = &mInverseMasses[0];
+
+				//save current PE in case quadratic required
+				mPreviousEnergy = energy;
+
+				//project forces into complement space, put in mXPrime
+				Project( integrator, Forces(), xPrime, Projection::InverseMass, true );
+
+				// Scale mXPrime and take the step of 1/maxEig, the solution if the system was
+				// quadratic, in one pass
+				const double scale = mMinimizerScale, step = 1.0 / integrator.getMaxEigenvalue();
+
+				#pragma omp parallel for simd num_threads( mThreads )
+				for( long long i = 0; i < mDegrees; i++ ) {
+					xPrime[i] *= scale;
+					target[i] = coordinates[i] + step * inverseMasses[i] * xPrime[i];
+				}
+				CommitMove();
+			}
+
+			double StepKernel::QuadraticMinimize( ContextImpl &context, const Integrator &integrator, const double energy ) {
+				const double *coordinates = Positions();
+				const double *forces = Forces();
+				const double *xPrime = &mXPrime[0], *inverseMasses = &mInverseMasses[0];
+
+				//Get quadratic 'line search' value
+				double lambda = 1.0 / integrator.getMaxEigenvalue();
+				const double oldLambda = lambda;
+
+				//get slope dPE/d\lambda for quadratic, just equal to minus dot product of 'proposed position move' and forces (=-\nabla PE)
+				double slope = 0.0;
+
+				#pragma omp parallel for simd num_threads( mThreads ) reduction( +: slope )
+				for( long long i = 0; i < mDegrees; i++ ) {
+					slope += xPrime[i] * forces[i] * inverseMasses[i];
+				}
+
+				const double newSlope = -slope;
+
+				//solve for minimum for quadratic fit using two PE vales and the slope with /lambda=0
+				//for 'newSlope' use PE=a(\lambda_e-\lambda)^2+b(\lambda_e-\lambda)+c, \lambda_e is 1/maxEig.
+				const double a = ( ( ( mPreviousEnergy - energy ) / oldLambda + newSlope ) / oldLambda );
+
+				//calculate \lambda at minimum of quadratic fit
+				if( a != 0.0 ) {
+					const double b = newSlope - 2.0 * a * oldLambda;
+					lambda = -b / ( 2.0 * a );
+				} else {
+					lambda = 0.5 * oldLambda;
+				}
+
+				//test if lambda negative, if so just use smaller lambda
+				if( lambda <= 0.0 ) {
+					lambda = 0.5 * oldLambda;
+				}
+
+				const double dlambda = lambda - oldLambda;
+
+				//Remove previous position update (-oldLambda) and add new move (lambda)
+				double *target = MoveTarget();
+				#pragma omp parallel for simd num_threads( mThreads )
+				for( long long i = 0; i < mDegrees; i++ ) {
+					target[i] = coordinates[i] + dlambda * inverseMasses[i] * xPrime[i];
+				}
+				CommitMove();
+
+				return lambda;
+			}
+
+			// Kinetic energy of the velocities half a step ahead
+			double StepKernel::computeKineticEnergy( ContextImpl &context, const Integrator &integrator ) {
+				const double *velocities = Velocities(), *forces = Forces();
+				const double *inverseMasses = &mInverseMasses[0];
+				const double shift = 0.5 * integrator.getStepSize();
+
+				double energy = 0.0;
+
+				#pragma omp parallel for simd num_threads( mThreads ) reduction( +: energy )
+				for( long long i = 0; i < mDegrees; i++ ) {
+					const double velocity = velocities[i] + forces[i] * shift * inverseMasses[i];
+					energy += velocity * velocity / inverseMasses[i];
+				}
+
+				return 0.5 * energy;
+			}
+
+			void StepKernel::Project( const Integrator &integrator, const double *in, double *out, const Projection::EWeight weight, const bool compliment ) {
+				// Replicas sharing a basis project together
+				ProjectionBatch *batch = integrator.getProjectionBatch();
+				if( batch ) {
+					batch->Project( in, out, weight, compliment );
+					return;
+				}
+
+				// Repack only when the integrator holds a different basis
+				const ModeBasisPtr basis = integrator.getModeBasis();
+				if( basis && basis->Version() != mProjection.Version() ) {
+					mProjection.SetBasis( *basis );
+				}
+
+				mProjection.Project( in, out, weight, compliment );
+			}
+		}
+	}
+}
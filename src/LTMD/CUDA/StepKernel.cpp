@@ -36,7 +36,7 @@ namespace OpenMM {
 	namespace LTMD {
 		namespace CUDA {
 			StepKernel::StepKernel( std::string name, const Platform &platform, CudaPlatform::PlatformData &data ) : LTMD::StepKernel( name, platform ),
-				data( data ), modes( NULL ), modeWeights( NULL ), MinimizeLambda( 0 ) {
+				mModeVersion( 0 ), data( data ), modes( NULL ), modeWeights( NULL ), MinimizeLambda( 0 ) {
 
 				//MinimizeLambda = new CUDAStream<float>( 1, 1, "MinimizeLambda" );
 				//MinimizeLambda = new CudaArray( *(data.contexts[0]), 1, sizeof(float), "MinimizeLambda" );
@@ -86,17 +86,18 @@ namespace OpenMM {
 
 			void StepKernel::ProjectionVectors( const Integrator &integrator ) {
 				//check if projection vectors changed
-				bool modesChanged = integrator.getProjVecChanged();
+				const ModeBasisPtr basis = integrator.getModeBasis();
+				bool modesChanged = !basis || basis->Version() != mModeVersion;
 
 				//projection vectors changed or never allocated
 				if( modesChanged || modes == NULL ) {
-					int numModes = integrator.getNumProjectionVectors();
-
 					//valid vectors?
-					if( numModes == 0 ) {
+					if( !basis || basis->Modes() == 0 ) {
 						throw OpenMMException( "Projection vector size is zero." );
 					}
 
+					int numModes = basis->Modes();
+
 					//if( modes != NULL && modes->_length != numModes * mParticles ) {
 					if( modes != NULL && modes->getSize() != numModes * mParticles ) {
 						delete modes;
@@ -116,14 +117,15 @@ namespace OpenMM {
 					}
 					if( modesChanged ) {
 						int index = 0;
-						const std::vector<std::vector<Vec3> > &modeVectors = integrator.getProjectionVectors();
-						std::vector<float4> tmp( numModes * mParticles );;
+						std::vector<float4> tmp( numModes * mParticles );
 						for( int i = 0; i < numModes; i++ ) {
+							const double *mode = basis->Mode( i );
 							for( int j = 0; j < mParticles; j++ ) {
-								tmp[index++] = make_float4( ( float ) modeVectors[i][j][0], ( float ) modeVectors[i][j][1], ( float ) modeVectors[i][j][2], 0.0f );
+								tmp[index++] = make_float4( ( float ) mode[3 * j], ( float ) mode[3 * j + 1], ( float ) mode[3 * j + 2], 0.0f );
 							}
 						}
 						modes->upload( tmp );
+						mModeVersion = basis->Version();
 					}
 				}
 			}
@@ -0,0 +1,193 @@
+#include "LTMD/Ensemble.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "openmm/OpenMMException.h"
+#include "LTMD/ProjectionBatch.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace OpenMM {
+	namespace LTMD {
+		Ensemble::Ensemble( const System &system, const Parameters &params, const unsigned int replicas, const double temperature, const double frictionCoeff, const double stepSize, Platform &platform, const bool shouldShareBasis )
+			: mParameters( params ), mShouldShareBasis( shouldShareBasis ), mStepsSinceShare( 0 ), mBatches( 0 ), mBatchedProjections( 0 ) {
+			if( replicas == 0 ) {
+				throw OpenMMException( "Ensemble requires at least one replica" );
+			}
+
+			for( int i = 0; i < system.getNumParticles(); i++ ) {
+				mMasses.push_back( system.getParticleMass( i ) );
+			}
+
+			// Rediagonalization is driven from here rather than by each integrator
+			if( mShouldShareBasis ) {
+				mParameters.ShouldProtoMolDiagonalize = true;
+			}
+
+			for( unsigned int i = 0; i < replicas; i++ ) {
+				Integrator *integrator = new Integrator( temperature, frictionCoeff, stepSize, mParameters );
+				if( i != 0 ) {
+					integrator->setRandomNumberSeed( mIntegrators[0]->getRandomNumberSeed() + i );
+				}
+
+				mIntegrators.push_back( integrator );
+				mContexts.push_back( new Context( system, *integrator, platform ) );
+			}
+		}
+
+		Ensemble::~Ensemble() {
+			for( size_t i = 0; i < mContexts.size(); i++ ) {
+				delete mContexts[i];
+				delete mIntegrators[i];
+			}
+		}
+
+		void Ensemble::SetPositions( const std::vector<Vec3> &positions ) {
+			for( size_t i = 0; i < mContexts.size(); i++ ) {
+				mContexts[i]->setPositions( positions );
+			}
+		}
+
+		void Ensemble::ShareBasis() {
+			mIntegrators[0]->Rediagonalize();
+
+			const ModeBasisPtr basis = mIntegrators[0]->getModeBasis();
+			const BlockPreconditionerPtr preconditioner = mIntegrators[0]->getBlockPreconditioner();
+			for( size_t i = 1; i < mIntegrators.size(); i++ ) {
+				mIntegrators[i]->setModeBasis( basis );
+				mIntegrators[i]->setBlockPreconditioner( preconditioner );
+			}
+
+			mStepsSinceShare = 0;
+		}
+
+		void Ensemble::Step( const unsigned int steps ) {
+			const unsigned int frequency = mShouldShareBasis ? std::max( mParameters.rediagFreq, 1 ) : steps;
+
+			unsigned int remaining = steps;
+			while( remaining > 0 ) {
+				if( mShouldShareBasis && mStepsSinceShare == 0 ) {
+					ShareBasis();
+				}
+
+				const unsigned int chunk = std::min( remaining, frequency - mStepsSinceShare );
+
+				StepReplicas( chunk );
+
+				remaining -= chunk;
+				if( mShouldShareBasis ) {
+					mStepsSinceShare = ( mStepsSinceShare + chunk ) % frequency;
+				}
+			}
+		}
+
+		// Replicas are handed out one at a time to at most one thread per core. With a shared
+		// basis the kernel projections are batched, which needs every replica on its own
+		// thread so that each batch holds all of them. An exception from any replica is raised
+		// once every thread has finished.
+		void Ensemble::StepReplicas( const unsigned int steps ) {
+			const unsigned int replicas = mIntegrators.size();
+
+			std::unique_ptr<ProjectionBatch> batch;
+			const ModeBasisPtr basis = mIntegrators[0]->getModeBasis();
+			if( mShouldShareBasis && basis && replicas > 1 ) {
+				batch.reset( new ProjectionBatch( mMasses, basis, replicas, mParameters.ShouldUseSinglePrecisionModes ) );
+			}
+
+			const unsigned int cores = std::max( std::thread::hardware_concurrency(), 1u );
+			const unsigned int workers = batch ? replicas : std::min( replicas, cores );
+
+			std::atomic<unsigned int> next( 0 );
+			std::exception_ptr failure;
+			std::mutex mutex;
+
+#ifdef _OPENMP
+			// The OpenMP loops inside each replica share the cores with the other replicas, the
+			// batched projections run while the others wait and use them all
+			const int previous = omp_get_max_threads();
+			const int threads = std::max( previous / ( int ) workers, 1 );
+			if( batch ) {
+				batch->SetThreads( previous );
+			}
+#endif
+
+			auto worker = [&]() {
+#ifdef _OPENMP
+				omp_set_num_threads( threads );
+#endif
+				for( unsigned int i = next++; i < replicas; i = next++ ) {
+					try {
+						StepReplica( i, steps, batch.get() );
+					} catch( ... ) {
+						std::lock_guard<std::mutex> lock( mutex );
+						if( !failure ) {
+							failure = std::current_exception();
+						}
+					}
+				}
+			};
+
+			std::vector<std::thread> pool;
+			for( unsigned int i = 1; i < workers; i++ ) {
+				pool.push_back( std::thread( worker ) );
+			}
+			worker();
+
+			for( size_t i = 0; i < pool.size(); i++ ) {
+				pool[i].join();
+			}
+
+#ifdef _OPENMP
+			omp_set_num_threads( previous );
+#endif
+
+			if( batch ) {
+				mBatches += batch->Batches();
+				mBatchedProjections += batch->Vectors();
+			}
+
+			if( failure ) {
+				std::rethrow_exception( failure );
+			}
+		}
+
+		// A failed minimization stops the integrator early, the replica takes that step with its
+		// own modes, kept until the next share, and finishes the chunk outside the batch. Every
+		// pass completes at least one step. The replica leaves the batch however it finishes.
+		void Ensemble::StepReplica( const unsigned int replica, const unsigned int steps, ProjectionBatch *batch ) {
+			Integrator &integrator = *mIntegrators[replica];
+
+			auto leave = [&]() {
+				if( integrator.getProjectionBatch() ) {
+					integrator.setProjectionBatch( NULL );
+					batch->Leave();
+				}
+			};
+
+			integrator.setProjectionBatch( batch );
+			try {
+				unsigned int completed = 0;
+				while( completed < steps ) {
+					integrator.step( steps - completed );
+					completed += integrator.CompletedSteps();
+					if( completed < steps ) {
+						leave();
+						integrator.RediagonalizeFailedStep();
+						completed++;
+					}
+				}
+			} catch( ... ) {
+				leave();
+				throw;
+			}
+			leave();
+		}
+	}
+}
@@ -1,11 +1,9 @@
+#include <algorithm>
+#include <cmath>
 #include <ctime>
 #include <string>
 #include <iostream>
 
-#include <sys/time.h>
-
-#include "SimTKOpenMMUtilities.h"
-
 #include "openmm/System.h"
 #include "openmm/Context.h"
 #include "openmm/kernels.h"
@@ -23,18 +21,34 @@
 
 namespace OpenMM {
 	namespace LTMD {
+		// OpenMM's group mask selecting every force
+		static const int AllForceGroups = -1;
+
 		Integrator::Integrator( double temperature, double frictionCoeff, double stepSize, const Parameters &params )
-			: maxEigenvalue( 4.34e5 ), stepsSinceDiagonalize( 0 ), mParameters( params ), mAnalysis( new Analysis ) {
+			: mStepFailed( false ), maxEigenvalue( 4.34e5 ), mProjectionBatch( NULL ), stepsSinceDiagonalize( 0 ), mParameters( params ), mAnalysis( new Analysis ), mArena( NULL ), mMetropolisDraws( 0 ),
+			  mPositionVersion( 1 ), mVersionCounter( 1 ), mSavedVersion( 1 ), mForcesVersion( 0 ), mEnergyVersion( 0 ), mEnergyOnlyVersion( 0 ),
+			  mEvaluationGroups( AllForceGroups ), mForcesGroups( AllForceGroups ), mEnergyGroups( AllForceGroups ), mEnergyOnlyTrials( false ),
+			  mCachedPE( 0.0 ), mForceEvaluations( 0 ), mEnergyEvaluations( 0 ), mPartialForceEvaluations( 0 ), mForceEvaluationsSaved( 0 ), mForceEvaluationsAvoided( 0 ), mForceEvaluationsDeferred( 0 ) {
 			setTemperature( temperature );
 			setFriction( frictionCoeff );
 			setStepSize( stepSize );
 			setConstraintTolerance( 1e-4 );
 			setMinimumLimit( mParameters.minLimit );
 			setRandomNumberSeed( ( int ) time( 0 ) );
+
+			mProfiler.SetEnabled( mParameters.ShouldProfile );
+			mAnalysis->SetProfiler( &mProfiler );
+
+			if( mParameters.ShouldReuseRediagonalizationMemory ) {
+				mArena = new Arena( mParameters.ShouldUseHugePages );
+				mAnalysis->SetArena( mArena );
+			}
 		}
 
+		// The mode basis may still hold arena blocks, they go back to the system once released
 		Integrator::~Integrator() {
 			delete mAnalysis;
+			delete mArena;
 		}
 
 		void Integrator::initialize( ContextImpl &contextRef ) {
@@ -42,8 +56,49 @@ namespace OpenMM {
 			if( context->getSystem().getNumConstraints() > 0 ) {
 				throw OpenMMException( "LTMD Integrator does not support constraints" );
 			}
+			mRandom.SetSeed( ( uint32_t ) getRandomNumberSeed() );
+			mMetropolisDraws = 0;
+
+			PositionsChanged();
+			mForceEvaluations = 0;
+			mEnergyEvaluations = 0;
+			mPartialForceEvaluations = 0;
+			mForceEvaluationsSaved = 0;
+			mForceEvaluationsAvoided = 0;
+			mForceEvaluationsDeferred = 0;
+
+			// The minimizer works in mass weighted coordinates where the modes are orthonormal
+			const System &system = context->getSystem();
+			mInverseRootMass.resize( system.getNumParticles() );
+			for( int i = 0; i < system.getNumParticles(); i++ ) {
+				mInverseRootMass[i] = 1.0 / std::sqrt( system.getParticleMass( i ) );
+			}
+			mComplement.SetMasses( std::vector<double>( system.getNumParticles(), 1.0 ) );
+			mLBFGS.SetMemory( mParameters.LBFGSMemory );
+
+			// The adapted step may grow to a hundred times 1/maxEigenvalue and shrink to
+			// MinimumLambdaValue
+			const double maximumCurvature = mParameters.MinimumLambdaValue > 0.0 ? 1.0 / mParameters.MinimumLambdaValue : HUGE_VAL;
+			mStepLength.Reset( maxEigenvalue, 0.01 * maxEigenvalue, std::max( maximumCurvature, maxEigenvalue ) );
+
+			// Choose how to store the rediagonalization, or fail now rather than at the first one
+			if( !mParameters.residue_sizes.empty() ) {
+				mResourceEstimate = ResourceEstimate::Calculate( system.getNumParticles(), mParameters, mParameters.MemoryLimit );
+				const bool fits = mResourceEstimate.Select( mParameters.Rediagonalization );
+				if( mParameters.ShouldProfile ) {
+					std::cout << mResourceEstimate.Report();
+				}
+
+				if( !fits ) {
+					throw OpenMMException( "LTMD rediagonalization does not fit in the available memory\n" + mResourceEstimate.Report() );
+				}
+				mAnalysis->SetMethod( mResourceEstimate.Method );
+			}
+
 			kernel = context->getPlatform().createKernel( StepKernel::Name(), contextRef );
 			( ( StepKernel & )( kernel.getImpl() ) ).initialize( contextRef.getSystem(), *this );
+
+			mEnergyOnlyTrials = mParameters.ShouldUseEnergyOnlyTrials;
 			//(dynamic_cast<StepKernel &>( kernel.getImpl() )).initialize( contextRef.getSystem(), *this );
 		}
 
@@ -58,20 +113,26 @@ namespace OpenMM {
 		}
 
 		void Integrator::step( int steps ) {
-			timeval start, end;
-			gettimeofday( &start, 0 );
+			Profiler::Scope timer( &mProfiler, "Integrator::Step" );
 
 			mSimpleMinimizations = 0;
 			mQuadraticMinimizations = 0;
+			mMinimizationHistory.clear();
 
+			// Positions may have been set on the context since the last call
+			PositionsChanged();
+
+			mStepFailed = false;
 			for( mLastCompleted = 0; mLastCompleted < steps; ++mLastCompleted ) {
 				if( DoStep() == false ) {
+					mStepFailed = true;
 					break;
 				}
 			}
 
 			// Update Time
 			context->setTime( context->getTime() + getStepSize() * mLastCompleted );
+			mProfiler.Count( "Steps", mLastCompleted );
 
 			// Print Minimizations
 			const unsigned int total = mSimpleMinimizations + mQuadraticMinimizations;
@@ -80,14 +141,18 @@ namespace OpenMM {
 			const double averageQuadratic = ( double )mQuadraticMinimizations / ( double )mLastCompleted;
 			const double averageTotal = ( double )total / ( double )mLastCompleted;
 
-			std::cout << "[OpenMM::Minimize] " << total << " total minimizations( "
-					  << mSimpleMinimizations << " simple, " << mQuadraticMinimizations << " quadratic ). "
-					  << averageTotal << " per-step minimizations( " << averageSimple << " simple, "
-					  << averageQuadratic << " quadratic ). Steps: " << mLastCompleted << std::endl;
+			if( mParameters.Minimizer == Preference::LBFGS ) {
+				std::cout << "[OpenMM::Minimize] " << total << " total evaluations( "
+						  << mSimpleMinimizations << " iterations, " << mQuadraticMinimizations << " line search ). "
+						  << averageTotal << " per-step evaluations( " << averageSimple << " iterations, "
+						  << averageQuadratic << " line search ). Steps: " << mLastCompleted << std::endl;
+			} else {
+				std::cout << "[OpenMM::Minimize] " << total << " total minimizations( "
+						  << mSimpleMinimizations << " simple, " << mQuadraticMinimizations << " quadratic ). "
+						  << averageTotal << " per-step minimizations( " << averageSimple << " simple, "
+						  << averageQuadratic << " quadratic ). Steps: " << mLastCompleted << std::endl;
+			}
 
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[Integrator] Total dynamics: " << elapsed << "ms" << std::endl;
 		}
 
 		double Integrator::computeKineticEnergy() {
@@ -101,15 +166,18 @@ namespace OpenMM {
 			sure its not done twice */
 		bool Integrator::DoStep() {
 			//context->updateContextState();
-			if( eigenvectors.size() == 0 || stepsSinceDiagonalize % mParameters.rediagFreq == 0 ) {
+			if( getNumProjectionVectors() == 0 || stepsSinceDiagonalize % mParameters.rediagFreq == 0 ) {
 				DiagonalizeMinimize();
 			}
 			stepsSinceDiagonalize++;
 
-			mMetropolisPE = context->calcForcesAndEnergy( true, true );
+			mMetropolisPE = CalculateForcesAndEnergy( true, true );
 			IntegrateStep();
 			SetProjectionChanged( false );
-			if( !minimize( mParameters.MaximumMinimizationIterations ) ) {
+
+			unsigned int simple = 0, quadratic = 0;
+			Minimize( mParameters.MaximumMinimizationIterations, simple, quadratic );
+			if( ( simple + quadratic ) >= mParameters.MaximumMinimizationIterations ) {
 				if( mParameters.ShouldForceRediagOnMinFail ) {
 					if( mParameters.ShouldProtoMolDiagonalize ) {
 						return false;
@@ -125,6 +193,9 @@ namespace OpenMM {
 		}
 
 		bool Integrator::minimize( const unsigned int upperbound ) {
+			// Positions may have been set on the context since the last call
+			PositionsChanged();
+
 			unsigned int simple = 0, quadratic = 0;
 			Minimize( upperbound, simple, quadratic );
 
@@ -132,6 +203,8 @@ namespace OpenMM {
 		}
 
 		bool Integrator::minimize( const unsigned int upperbound, const unsigned int lowerbound ) {
+			PositionsChanged();
+
 			unsigned int simple = 0, quadratic = 0;
 			Minimize( upperbound, simple, quadratic );
 
@@ -141,21 +214,41 @@ namespace OpenMM {
 		}
 
 		void Integrator::Minimize( const unsigned int max, unsigned int &simpleSteps, unsigned int &quadraticSteps ) {
+			Profiler::Scope timer( &mProfiler, "Integrator::Minimize" );
+
 			const double eigStore = maxEigenvalue;
-			if( !mParameters.ShouldProtoMolDiagonalize && eigenvectors.size() == 0 ) {
+			const bool adapt = mParameters.ShouldAdaptStepLength;
+			if( adapt ) {
+				maxEigenvalue = mStepLength.Curvature();
+			}
+
+			if( !mParameters.ShouldProtoMolDiagonalize && getNumProjectionVectors() == 0 ) {
 				computeProjectionVectors();
 			}
 
 			SaveStep();
 
-			double initialPE = context->calcForcesAndEnergy( true, true );
+			double initialPE = CalculateForcesAndEnergy( true, true );
 			( ( StepKernel & )( kernel.getImpl() ) ).setOldPositions();
 
 			//context->getPositions(oldPos); // I need to get old positions here
 			simpleSteps = 0;
 			quadraticSteps = 0;
 
-			for( unsigned int i = 0; i < max; i++ ) {
+			// Quadratic lambdas are only comparable while the kernel's step is unscaled, that is
+			// until the first rejection
+			unsigned int rejections = 0;
+
+			const bool lbfgs = ( mParameters.Minimizer == Preference::LBFGS && !mParameters.ShouldUseMetropolisMinimization );
+			bool finished = lbfgs;
+			if( lbfgs ) {
+				MinimizeLBFGS( max, initialPE, simpleSteps, quadraticSteps );
+			} else if( mParameters.InnerMinimizationGroups != 0 && !mParameters.ShouldUseMetropolisMinimization ) {
+				finished = MinimizeSplit( max, initialPE, simpleSteps );
+			}
+
+			// Full iterations, or what the split minimization left of them
+			for( unsigned int i = simpleSteps; i < max && !finished; i++ ) {
 				SetProjectionChanged( false );
 
 				if( mParameters.ShouldUseMetropolisMinimization ){
@@ -170,7 +263,7 @@ namespace OpenMM {
 					}
 
 		            const double prob = exp(-(1.0 / (0.001987191 * temperature)) * (currentPE - mMetropolisPE));
-		            if(SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber() < prob){
+		            if(mRandom.Uniform( Random::Metropolis, mMetropolisDraws++, 0 ) < prob){
 						break;
 					}
 
@@ -178,7 +271,8 @@ namespace OpenMM {
 				}else{
 					simpleSteps++;
 					double currentPE = LinearMinimize( initialPE );
-					if( mParameters.isAlwaysQuadratic || currentPE > initialPE ){
+					const bool fitted = mParameters.isAlwaysQuadratic || currentPE > initialPE;
+					if( fitted ){
 						quadraticSteps++;
 
 						double lambda = 0.0;
@@ -188,16 +282,30 @@ namespace OpenMM {
 							computeProjectionVectors();
 							break;
 						}else{
-							if( mParameters.ShouldForceRediagOnQuadraticLambda && lambda < 1.0 / maxEigenvalue){
-								std::cout << "Quadratic Minimization Failed Lambda Test [" << lambda << ", " << 1.0 / maxEigenvalue << "] - Forcing Rediagonalization" << std::endl;
+							// An adapted step is not the eigenvalue bound the test is against
+							const double bound = adapt ? eigStore : maxEigenvalue;
+							if( mParameters.ShouldForceRediagOnQuadraticLambda && lambda < 1.0 / bound){
+								std::cout << "Quadratic Minimization Failed Lambda Test [" << lambda << ", " << 1.0 / bound << "] - Forcing Rediagonalization" << std::endl;
 								computeProjectionVectors();
 								break;
 							}
+
+							if( adapt && rejections == 0 ) {
+								mStepLength.Observe( lambda );
+							}
 						}
 					}
 
-					//break if satisfies end condition
 					const double diff = initialPE - currentPE;
+					if( adapt ) {
+						if( diff < 0.0 ) {
+							mStepLength.Reject();
+						} else if( !fitted && rejections == 0 ) {
+							mStepLength.Accept();
+						}
+					}
+
+					//break if satisfies end condition
 					if( diff < getMinimumLimit() && diff >= 0.0 ) {
 						break;
 					}
@@ -205,21 +313,212 @@ namespace OpenMM {
 					if( diff > 0.0 ) {
 						SaveStep();
 						initialPE = currentPE;
+						rejections = 0;
 					} else {
 						RevertStep();
-						context->calcForcesAndEnergy( true, false );
+						CalculateForcesAndEnergy( true, false );
 
 						maxEigenvalue *= 2;
+						rejections++;
+					}
+
+					if( adapt && rejections == 0 ) {
+						maxEigenvalue = mStepLength.Curvature();
 					}
 				}
 			}
 
+			// Leave the forces of the final positions in the context, with the energy the next
+			// step starts from
+			if( mForcesVersion != mPositionVersion || mForcesGroups != mEvaluationGroups ) {
+				CalculateForcesAndEnergy( true, true );
+			}
+
 			mSimpleMinimizations += simpleSteps;
 			mQuadraticMinimizations += quadraticSteps;
+			mMinimizationHistory.push_back( simpleSteps + quadraticSteps );
+			mProfiler.Count( "MinimizationsSimple", simpleSteps );
+			mProfiler.Count( "MinimizationsQuadratic", quadraticSteps );
 
 			maxEigenvalue = eigStore;
 		}
 
+		// Projected L-BFGS in mass weighted coordinates y = sqrt(m) x. The gradient is projected
+		// out of the mode space so the minimizer only moves in the complement. Backtracking
+		// starts from the full L-BFGS step, which before any curvature is known is the
+		// 1/maxEigenvalue step of LinearMinimize.
+		void Integrator::MinimizeLBFGS( const unsigned int max, double energy, unsigned int &iterations, unsigned int &searches ) {
+			const double SufficientDecrease = 1e-4;
+
+			const ModeBasisPtr basis = getModeBasis();
+			if( basis && basis->Version() != mComplement.Version() ) {
+				mComplement.SetBasis( *basis );
+			}
+
+			const size_t particles = mInverseRootMass.size();
+			std::vector<Vec3> positions, trial( particles );
+			context->getPositions( positions );
+
+			std::vector<double> gradient( 3 * particles ), direction( 3 * particles ), change( 3 * particles );
+			ComplementGradient( gradient );
+
+			mLBFGS.Clear();
+			mLBFGS.SetInitialScale( 1.0 / maxEigenvalue );
+			mLBFGS.SetPreconditioner( mParameters.ShouldPreconditionMinimizer ? mPreconditioner.get() : NULL );
+
+			while( iterations + searches < max ) {
+				mLBFGS.Direction( gradient, direction );
+				mComplement.Project( &direction[0], &direction[0], Projection::Mass, true );
+
+				double slope = LBFGS::Dot( direction, gradient );
+				if( slope >= 0.0 ) {
+					// History no longer describes the surface, restart from steepest descent
+					mLBFGS.Clear();
+					mLBFGS.Direction( gradient, direction );
+					mComplement.Project( &direction[0], &direction[0], Projection::Mass, true );
+					slope = LBFGS::Dot( direction, gradient );
+					if( slope >= 0.0 ) {
+						break;
+					}
+				}
+
+				// Backtrack to the minimum of the quadratic through the energy, slope and trial energy
+				double alpha = 1.0, trialEnergy = energy;
+				bool accepted = false;
+				while( iterations + searches < max ) {
+					for( size_t i = 0; i < particles; i++ ) {
+						const double factor = alpha * mInverseRootMass[i];
+						trial[i] = positions[i] + Vec3( direction[3 * i], direction[3 * i + 1], direction[3 * i + 2] ) * factor;
+					}
+					context->setPositions( trial );
+					PositionsChanged();
+
+					trialEnergy = TrialEnergy();
+					if( trialEnergy <= energy + SufficientDecrease * alpha * slope ) {
+						accepted = true;
+						break;
+					}
+					searches++;
+
+					const double curvature = trialEnergy - energy - alpha * slope;
+					const double next = ( curvature > 0.0 ) ? -slope * alpha * alpha / ( 2.0 * curvature ) : 0.5 * alpha;
+					alpha = std::min( std::max( next, 0.1 * alpha ), 0.5 * alpha );
+				}
+
+				if( !accepted ) {
+					context->setPositions( positions );
+					PositionsChanged();
+					CalculateForcesAndEnergy( true, true );
+					break;
+				}
+				iterations++;
+
+				for( size_t i = 0; i < direction.size(); i++ ) {
+					direction[i] *= alpha;
+					change[i] = -gradient[i];
+				}
+				RequireForces();
+				ComplementGradient( gradient );
+				for( size_t i = 0; i < change.size(); i++ ) {
+					change[i] += gradient[i];
+				}
+				mLBFGS.Update( direction, change );
+
+				positions.swap( trial );
+
+				const double diff = energy - trialEnergy;
+				energy = trialEnergy;
+				if( diff < getMinimumLimit() ) {
+					break;
+				}
+			}
+		}
+
+		// Each outer iteration relaxes the cheap force groups with up to InnerMinimizationIterations
+		// linear steps, then evaluates every group once to accept the result or return to where
+		// it started. Only the outer evaluations count towards max. Returns false when the full
+		// energy did not decrease, leaving the rest to the full minimizer.
+		bool Integrator::MinimizeSplit( const unsigned int max, double &energy, unsigned int &outer ) {
+			// Where the current outer iteration started, and returns to if it is not accepted
+			std::vector<Vec3> start;
+			context->getPositions( start );
+
+			while( outer < max ) {
+				mEvaluationGroups = mParameters.InnerMinimizationGroups;
+				double innerEnergy = CalculateForcesAndEnergy( true, true );
+				unsigned int moved = 0;
+				for( unsigned int i = 0; i < mParameters.InnerMinimizationIterations; i++ ) {
+					const double trialEnergy = LinearMinimize( innerEnergy );
+					mProfiler.Count( "MinimizationsInner" );
+
+					const double diff = innerEnergy - trialEnergy;
+					if( !( diff > 0.0 ) ) {
+						RevertStep();
+						break;
+					}
+
+					SaveStep();
+					innerEnergy = trialEnergy;
+					moved++;
+					if( diff < getMinimumLimit() ) {
+						break;
+					}
+				}
+				mEvaluationGroups = AllForceGroups;
+
+				if( moved == 0 ) {
+					return false;
+				}
+
+				outer++;
+				const double trialEnergy = TrialEnergy();
+				const double diff = energy - trialEnergy;
+				if( !( diff > 0.0 ) ) {
+					context->setPositions( start );
+					PositionsChanged();
+					SaveStep();
+					return false;
+				}
+
+				energy = trialEnergy;
+				if( diff < getMinimumLimit() ) {
+					return true;
+				}
+				context->getPositions( start );
+			}
+
+			return true;
+		}
+
+		// Mass weighted gradient -F/sqrt(m) with the mode space removed
+		void Integrator::ComplementGradient( std::vector<double> &gradient ) {
+			std::vector<Vec3> forces;
+			context->getForces( forces );
+
+			for( size_t i = 0; i < mInverseRootMass.size(); i++ ) {
+				for( unsigned int j = 0; j < 3; j++ ) {
+					gradient[3 * i + j] = -forces[i][j] * mInverseRootMass[i];
+				}
+			}
+
+			mComplement.Project( &gradient[0], &gradient[0], Projection::Mass, true );
+		}
+
+		void Integrator::Rediagonalize() {
+			computeProjectionVectors();
+		}
+
+		void Integrator::RediagonalizeFailedStep() {
+			if( !mStepFailed ) {
+				throw OpenMMException( "LTMD integrator has no failed step to take" );
+			}
+			mStepFailed = false;
+
+			computeProjectionVectors();
+			TimeAndCounterStep();
+			context->setTime( context->getTime() + getStepSize() );
+		}
+
 		void Integrator::DiagonalizeMinimize() {
 			if( !mParameters.ShouldProtoMolDiagonalize ) {
 				computeProjectionVectors();
@@ -227,106 +526,139 @@ namespace OpenMM {
 		}
 
 		void Integrator::computeProjectionVectors() {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
-			mAnalysis->computeEigenvectorsFull( context->getOwner(), mParameters );
-			setProjectionVectors( mAnalysis->getEigenvectors() );
+			Profiler::Scope timer( &mProfiler, "Integrator::Rediagonalize" );
+			mAnalysis->computeEigenvectors( context->getOwner(), mParameters );
+			PositionsChanged();
+			setModeBasis( mAnalysis->getModeBasis() );
+			mPreconditioner = mAnalysis->getBlockPreconditioner();
 			stepsSinceDiagonalize = 0;
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] Compute Projection: " << elapsed << "ms" << std::endl;
-#endif
 		}
 
 		// Kernel Functions
 		void Integrator::IntegrateStep() {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( &mProfiler, "Integrator::Integrate" );
 			( ( StepKernel & )( kernel.getImpl() ) ).Integrate( *context, *this );
+			PositionsChanged();
 			//dynamic_cast<StepKernel &>( kernel.getImpl() ).Integrate( *context, *this );
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] Integrate Step: " << elapsed << "ms" << std::endl;
-#endif
 		}
 
 		void Integrator::TimeAndCounterStep() {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( &mProfiler, "Integrator::UpdateTime" );
 			( ( StepKernel & )( kernel.getImpl() ) ).UpdateTime( *this );
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] TimeAndCounter Step: " << elapsed << "ms" << std::endl;
-#endif
+			if( ( ( StepKernel & )( kernel.getImpl() ) ).ReordersAtoms() ) {
+				PositionsChanged();
+			}
 		}
 
 
 		double Integrator::LinearMinimize( const double energy ) {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( &mProfiler, "Integrator::LinearMinimize" );
+			RequireForces();
 			( ( StepKernel & )( kernel.getImpl() ) ).LinearMinimize( *context, *this, energy );
-			double retVal = context->calcForcesAndEnergy( true, true );
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] Linear Minimize: " << elapsed << "ms" << std::endl;
-#endif
-		return retVal;
-}
+			PositionsChanged();
+			return TrialEnergy();
+		}
 
 		double Integrator::QuadraticMinimize( const double energy, double &lambda ) {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( &mProfiler, "Integrator::QuadraticMinimize" );
+
+			// The fit needs the slope at the linear trial point
+			RequireForces();
 			lambda = ( ( StepKernel & )( kernel.getImpl() ) ).QuadraticMinimize( *context, *this, energy );
+			PositionsChanged();
 #ifdef KERNEL_VALIDATION
 			std::cout << "[OpenMM::Integrator::Minimize] Lambda: " << lambda << " Ratio: " << ( lambda / maxEigenvalue ) << std::endl;
 #endif
-			double retVal = context->calcForcesAndEnergy( true, true );
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] Quadratic Minimize: " << elapsed << "ms" << std::endl;
-#endif
-			return retVal;
+			return TrialEnergy();
 		}
 
 		void Integrator::SaveStep() {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( &mProfiler, "Integrator::SaveStep" );
 			( ( StepKernel & )( kernel.getImpl() ) ).AcceptStep( *context/*, oldPos*/ ); // must pass here
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] Save Step: " << elapsed << "ms" << std::endl;
-#endif
+			mSavedVersion = mPositionVersion;
 		}
 
+		// The kernel restores the saved positions exactly, so whatever the context still holds
+		// for them remains valid
 		void Integrator::RevertStep() {
-#ifdef PROFILE_INTEGRATOR
-			timeval start, end;
-			gettimeofday( &start, 0 );
-#endif
+			Profiler::Scope timer( &mProfiler, "Integrator::RevertStep" );
 			( ( StepKernel & )( kernel.getImpl() ) ).RejectStep( *context/*, oldPos*/ ); // must pass here
-#ifdef PROFILE_INTEGRATOR
-			gettimeofday( &end, 0 );
-			double elapsed = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
-			std::cout << "[OpenMM::Integrator] Revert Step: " << elapsed << "ms" << std::endl;
-#endif
+			LeavePositions();
+			mPositionVersion = mSavedVersion;
+		}
+
+		// Force Cache, of the groups selected by mEvaluationGroups
+		double Integrator::CalculateForcesAndEnergy( const bool forces, const bool energy ) {
+			const bool needForces = forces && ( mForcesVersion != mPositionVersion || mForcesGroups != mEvaluationGroups );
+			const bool needEnergy = energy && ( mEnergyVersion != mPositionVersion || mEnergyGroups != mEvaluationGroups );
+			if( !needForces && !needEnergy ) {
+				mForceEvaluationsSaved++;
+				mProfiler.Count( "ForceEvaluationsSaved" );
+				return mCachedPE;
+			}
+
+			Profiler::Scope timer( &mProfiler, "Integrator::Forces" );
+			const double energyValue = context->calcForcesAndEnergy( needForces, needEnergy, mEvaluationGroups );
+			if( needEnergy ) {
+				mCachedPE = energyValue;
+				mEnergyVersion = mPositionVersion;
+				mEnergyGroups = mEvaluationGroups;
+			}
+
+			if( needForces ) {
+				mForcesVersion = mPositionVersion;
+				mForcesGroups = mEvaluationGroups;
+				if( mEnergyOnlyVersion == mPositionVersion ) {
+					mForceEvaluationsDeferred++;
+					mProfiler.Count( "ForceEvaluationsDeferred" );
+				}
+			} else if( !( ( StepKernel & )( kernel.getImpl() ) ).SupportsEnergyOnlyTrials() ) {
+				mForcesVersion = 0;
+			}
+
+			if( mEvaluationGroups != AllForceGroups ) {
+				mPartialForceEvaluations++;
+				mProfiler.Count( "ForceEvaluationsPartial" );
+			} else if( needForces ) {
+				mForceEvaluations++;
+				mProfiler.Count( "ForceEvaluations" );
+			} else {
+				mEnergyEvaluations++;
+				mProfiler.Count( "EnergyEvaluations" );
+			}
+
+			return mCachedPE;
+		}
+
+		// Energy at a minimizer trial point, without forces when trials are energy only
+		double Integrator::TrialEnergy() {
+			if( !mEnergyOnlyTrials ) {
+				return CalculateForcesAndEnergy( true, true );
+			}
+
+			mEnergyOnlyVersion = mPositionVersion;
+			return CalculateForcesAndEnergy( false, true );
+		}
+
+		// Forces at the current positions, only missing after an energy only trial or a change
+		// of force groups
+		void Integrator::RequireForces() {
+			if( mForcesVersion != mPositionVersion || mForcesGroups != mEvaluationGroups ) {
+				CalculateForcesAndEnergy( true, false );
+			}
+		}
+
+		void Integrator::PositionsChanged() {
+			LeavePositions();
+			mPositionVersion = ++mVersionCounter;
+		}
+
+		// Counts the trial point being left if its forces were never needed
+		void Integrator::LeavePositions() {
+			if( mEnergyOnlyVersion == mPositionVersion && mForcesVersion != mPositionVersion ) {
+				mForceEvaluationsAvoided++;
+				mProfiler.Count( "ForceEvaluationsAvoided" );
+			}
 		}
 	}
 }
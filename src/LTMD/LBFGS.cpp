@@ -0,0 +1,118 @@
+#include "LTMD/LBFGS.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		LBFGS::LBFGS( const unsigned int memory ) : mMemory( 0 ), mCount( 0 ), mNewest( 0 ), mInitialScale( 1.0 ), mPreconditioner( NULL ) {
+			SetMemory( memory );
+		}
+
+		void LBFGS::SetMemory( const unsigned int memory ) {
+			mMemory = memory;
+			mS.assign( memory, std::vector<double>() );
+			mY.assign( memory, std::vector<double>() );
+			mRho.assign( memory, 0.0 );
+			mAlpha.assign( memory, 0.0 );
+			Clear();
+		}
+
+		void LBFGS::SetInitialScale( const double scale ) {
+			mInitialScale = scale;
+		}
+
+		void LBFGS::SetPreconditioner( const BlockPreconditioner *preconditioner ) {
+			mPreconditioner = preconditioner;
+		}
+
+		void LBFGS::Clear() {
+			mCount = 0;
+			mNewest = 0;
+		}
+
+		double LBFGS::Dot( const std::vector<double> &a, const std::vector<double> &b ) {
+			const long long size = a.size();
+
+			double sum = 0.0;
+			#pragma omp parallel for reduction( +:sum )
+			for( long long i = 0; i < size; i++ ) {
+				sum += a[i] * b[i];
+			}
+
+			return sum;
+		}
+
+		bool LBFGS::Update( const std::vector<double> &s, const std::vector<double> &y ) {
+			if( mMemory == 0 ) {
+				return false;
+			}
+
+			const double sy = Dot( s, y );
+			if( sy <= 0.0 ) {
+				return false;
+			}
+
+			const unsigned int slot = ( mCount == 0 ) ? 0 : ( mNewest + 1 ) % mMemory;
+			mS[slot] = s;
+			mY[slot] = y;
+			mRho[slot] = 1.0 / sy;
+
+			mNewest = slot;
+			if( mCount < mMemory ) {
+				mCount++;
+			}
+
+			return true;
+		}
+
+		// Two loop recursion, newest to oldest then back
+		void LBFGS::Direction( const std::vector<double> &gradient, std::vector<double> &direction ) const {
+			const long long size = gradient.size();
+
+			std::vector<double> &q = direction;
+			if( &q != &gradient ) {
+				q = gradient;
+			}
+
+			for( unsigned int i = 0; i < mCount; i++ ) {
+				const unsigned int k = ( mNewest + mMemory - i ) % mMemory;
+				const std::vector<double> &s = mS[k], &y = mY[k];
+
+				mAlpha[k] = mRho[k] * Dot( s, q );
+				#pragma omp parallel for
+				for( long long j = 0; j < size; j++ ) {
+					q[j] -= mAlpha[k] * y[j];
+				}
+			}
+
+			if( mPreconditioner ) {
+				mPreconditioner->Apply( &q[0], &q[0] );
+			} else {
+				double scale = mInitialScale;
+				if( mCount != 0 ) {
+					const std::vector<double> &y = mY[mNewest];
+					scale = 1.0 / ( mRho[mNewest] * Dot( y, y ) );
+				}
+
+				#pragma omp parallel for
+				for( long long j = 0; j < size; j++ ) {
+					q[j] *= scale;
+				}
+			}
+
+			for( unsigned int i = mCount; i > 0; i-- ) {
+				const unsigned int k = ( mNewest + mMemory - ( i - 1 ) ) % mMemory;
+				const std::vector<double> &s = mS[k], &y = mY[k];
+
+				const double beta = mRho[k] * Dot( y, q );
+				#pragma omp parallel for
+				for( long long j = 0; j < size; j++ ) {
+					q[j] += ( mAlpha[k] - beta ) * s[j];
+				}
+			}
+
+			#pragma omp parallel for
+			for( long long j = 0; j < size; j++ ) {
+				q[j] = -q[j];
+			}
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include "LTMD/MappedMatrix.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+#include "openmm/OpenMMException.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		const size_t MappedMatrix::PanelBytes;
+
+		MappedMatrix::MappedMatrix( const size_t rows, const size_t columns, const std::string &directory )
+			: mRows( rows ), mColumns( columns ), mBytes( std::max<size_t>( rows * columns, 1 ) * sizeof( double ) ), mFile( -1 ), mData( NULL ) {
+#ifdef _WIN32
+			mData = static_cast<double *>( calloc( mBytes, 1 ) );
+			if( mData == NULL ) {
+				throw OpenMMException( "Unable to allocate matrix storage" );
+			}
+#else
+			const std::string path = ScratchDirectory( directory ) + "/ltmd-matrix-XXXXXX";
+			std::vector<char> name( path.begin(), path.end() );
+			name.push_back( '\0' );
+
+			mFile = mkstemp( &name[0] );
+			if( mFile == -1 ) {
+				throw OpenMMException( "Unable to create scratch file " + path + ": " + strerror( errno ) );
+			}
+
+			// Nothing else needs the name, the space is returned when the file is closed
+			unlink( &name[0] );
+
+			if( ftruncate( mFile, mBytes ) != 0 ) {
+				const std::string error = strerror( errno );
+				close( mFile );
+				throw OpenMMException( "Unable to size scratch file in " + ScratchDirectory( directory ) + ": " + error );
+			}
+
+			void *memory = mmap( NULL, mBytes, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0 );
+			if( memory == MAP_FAILED ) {
+				const std::string error = strerror( errno );
+				close( mFile );
+				throw OpenMMException( "Unable to map scratch file: " + error );
+			}
+			mData = static_cast<double *>( memory );
+#endif
+		}
+
+		MappedMatrix::~MappedMatrix() {
+#ifdef _WIN32
+			free( mData );
+#else
+			munmap( mData, mBytes );
+			close( mFile );
+#endif
+		}
+
+		size_t MappedMatrix::PanelColumns( const size_t rows, const size_t bytes ) {
+			const size_t panel = ( bytes != 0 ) ? bytes : PanelBytes;
+			return std::max<size_t>( panel / ( std::max<size_t>( rows, 1 ) * sizeof( double ) ), 1 );
+		}
+
+		std::string MappedMatrix::ScratchDirectory( const std::string &directory ) {
+			if( !directory.empty() ) {
+				return directory;
+			}
+
+			const char *tmpdir = getenv( "TMPDIR" );
+			if( tmpdir != NULL && tmpdir[0] != '\0' ) {
+				return tmpdir;
+			}
+
+			return "/tmp";
+		}
+
+		size_t MappedMatrix::ScratchAvailable( const std::string &directory ) {
+#ifndef _WIN32
+			struct statvfs stats;
+			if( statvfs( ScratchDirectory( directory ).c_str(), &stats ) == 0 ) {
+				return ( size_t ) stats.f_bavail * ( size_t ) stats.f_frsize;
+			}
+#endif
+			return 0;
+		}
+
+		// madvise works on whole pages, widen the range to page boundaries
+		void MappedMatrix::Advise( const size_t first, const size_t last, const int advice ) const {
+#ifndef _WIN32
+			if( first >= last || first >= mColumns ) {
+				return;
+			}
+
+			const size_t page = sysconf( _SC_PAGE_SIZE );
+			const size_t begin = first * mRows * sizeof( double ) / page * page;
+			const size_t end = std::min( std::min( last, mColumns ) * mRows * sizeof( double ), mBytes );
+
+			madvise( reinterpret_cast<char *>( mData ) + begin, end - begin, advice );
+#endif
+		}
+
+		void MappedMatrix::Prefetch( const size_t first, const size_t last ) const {
+#ifndef _WIN32
+			Advise( first, last, MADV_WILLNEED );
+#endif
+		}
+
+		void MappedMatrix::Release( const size_t first, const size_t last ) const {
+#ifndef _WIN32
+			// Dropping pages of a shared file mapping keeps their contents in the file
+			Advise( first, last, MADV_DONTNEED );
+#endif
+		}
+	}
+}
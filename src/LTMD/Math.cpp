@@ -10,11 +10,20 @@ extern "C" void dgemm_( char *, char *, int *, int *, int *, double *, double *,
 extern "C" double dlamch_( char * );
 extern "C" void dsyevr_( char *, char *, char *, int *, double *, int *, double *, double *, int *, int *, double *, int *, double *, double *, int *, int *, double *, int *, int *, int *, int * );
 
+extern "C" void dsptrd_( char *, int *, double *, double *, double *, double *, int * );
+extern "C" void dstemr_( char *, char *, int *, double *, double *, double *, double *, int *, int *, int *, double *, double *, int *, int *, int *, int *, double *, int *, int *, int *, int * );
+extern "C" void dopmtr_( char *, char *, char *, int *, int *, double *, double *, double *, int *, double *, int * );
+
 #endif
 
+#include <algorithm>
 #include <vector>
 
 void MatrixMultiply( const Matrix &matrixA, const bool transposeA, const Matrix &matrixB, const bool transposeB, Matrix &matrixC ) {
+	MatrixMultiply( matrixA.View(), transposeA, matrixB.View(), transposeB, matrixC.View() );
+}
+
+void MatrixMultiply( const ConstMatrixView &matrixA, const bool transposeA, const ConstMatrixView &matrixB, const bool transposeB, const MatrixView &matrixC ) {
 	char transa = transposeA ? 'T' : 'N';
 	char transb = transposeB ? 'T' : 'N';
 
@@ -24,22 +33,30 @@ void MatrixMultiply( const Matrix &matrixA, const bool transposeA, const Matrix
 
 	double alpha = 1.0, beta = 0.0;
 
-	int lda = transposeA ? k : m;
-	int ldb = transposeB ? n : k;
-	int ldc = m;
+	int lda = std::max<size_t>( matrixA.LeadingDimension, 1 );
+	int ldb = std::max<size_t>( matrixB.LeadingDimension, 1 );
+	int ldc = std::max<size_t>( matrixC.LeadingDimension, 1 );
 
 #ifdef INTEL_MKL
-	dgemm( &transa, &transb, &m, &n, &k, &alpha, &matrixA.Data[0], &lda, &matrixB.Data[0], &ldb, &beta, &matrixC.Data[0], &ldc );
+	dgemm( &transa, &transb, &m, &n, &k, &alpha, matrixA.Data, &lda, matrixB.Data, &ldb, &beta, matrixC.Data, &ldc );
 #else
-	dgemm_( &transa, &transb, &m, &n, &k, &alpha, ( double * )&matrixA.Data[0], &lda, ( double * )&matrixB.Data[0], &ldb, &beta, &matrixC.Data[0], &ldc );
+	dgemm_( &transa, &transb, &m, &n, &k, &alpha, ( double * )matrixA.Data, &lda, ( double * )matrixB.Data, &ldb, &beta, matrixC.Data, &ldc );
 #endif
 }
 
+// LAPACK destroys its input, so the only copy made is the working copy of matrix
 bool FindEigenvalues( const Matrix &matrix, std::vector<double> &values, Matrix &vectors ) {
 	Matrix temp = matrix;
-	vectors = matrix;
+	if( vectors.Rows != matrix.Rows || vectors.Columns != matrix.Rows ) {
+		vectors = Matrix( matrix.Rows, matrix.Rows );
+	}
+
+	return FindEigenvalues( temp.View(), values, vectors.View() );
+}
 
-	int m = 0, n = matrix.Rows, lda = n, ldz = n;
+bool FindEigenvalues( const MatrixView &matrix, std::vector<double> &values, const MatrixView &vectors ) {
+	const int n = matrix.Rows;
+	int m = 0, size = n, lda = std::max<size_t>( matrix.LeadingDimension, 1 ), ldz = std::max<size_t>( vectors.LeadingDimension, 1 );
 
 	int lwork = 26 * n, liwork = 10 * n;
 	std::vector<int> isuppz( 2 * n );
@@ -52,7 +69,41 @@ bool FindEigenvalues( const Matrix &matrix, std::vector<double> &values, Matrix
 	int info = 0;
 
 	double abstol = dlamch_( "s" );
-	dsyevr_( "V", "A", "U", &n, &temp.Data[0], &lda, &vl, &vu, &il, &iu, &abstol, &m, &values[0], &vectors.Data[0], &ldz, &isuppz[0], &wrkSp[0], &lwork, &iwork[0], &liwork, &info );
+	dsyevr_( "V", "A", "U", &size, matrix.Data, &lda, &vl, &vu, &il, &iu, &abstol, &m, &values[0], vectors.Data, &ldz, &isuppz[0], &wrkSp[0], &lwork, &iwork[0], &liwork, &info );
+
+	return ( info == 0 );
+}
+
+// The steps dsyevr takes, on the packed triangle: reduce to tridiagonal form in place,
+// solve the tridiagonal problem by MRRR and transform its eigenvectors back
+bool FindEigenvalues( SymmetricMatrix &matrix, std::vector<double> &values, const MatrixView &vectors ) {
+	int n = matrix.Rows, ldz = std::max<size_t>( vectors.LeadingDimension, 1 ), info = 0;
+	if( n == 0 ) {
+		return true;
+	}
+
+	char uplo = 'U', jobz = 'V', range = 'A', side = 'L', trans = 'N';
+
+	std::vector<double> diagonal( n ), offDiagonal( n ), tau( n );
+	dsptrd_( &uplo, &n, &matrix.Data[0], &diagonal[0], &offDiagonal[0], &tau[0], &info );
+	if( info != 0 ) {
+		return false;
+	}
+
+	int m = 0, nzc = n, tryrac = 1, il = 1, iu = 1;
+	double vl = 1.0, vu = 1.0;
+
+	int lwork = 18 * n, liwork = 10 * n;
+	std::vector<int> isuppz( 2 * n );
+	std::vector<int> iwork( liwork );
+	std::vector<double> work( lwork );
+
+	dstemr_( &jobz, &range, &n, &diagonal[0], &offDiagonal[0], &vl, &vu, &il, &iu, &m, &values[0], vectors.Data, &ldz, &nzc, &isuppz[0], &tryrac, &work[0], &lwork, &iwork[0], &liwork, &info );
+	if( info != 0 ) {
+		return false;
+	}
+
+	dopmtr_( &side, &uplo, &trans, &n, &n, &matrix.Data[0], &tau[0], vectors.Data, &ldz, &work[0], &info );
 
 	return ( info == 0 );
 }
@@ -2,8 +2,22 @@
 
 #include <cstdio>
 
-Matrix::Matrix( const size_t rows, const size_t columns ) : Rows( rows ), Columns( columns ) {
-	Data.resize( rows * columns );
+Matrix::Matrix( const size_t rows, const size_t columns ) : Rows( rows ), Columns( columns ), Data( rows * columns ) {
+
+}
+
+Matrix::Matrix( const ConstMatrixView &view ) : Rows( view.Rows ), Columns( view.Columns ), Data( view.Rows * view.Columns ) {
+	for( size_t col = 0; col < Columns; col++ ) {
+		std::copy( view.Column( col ), view.Column( col ) + Rows, Column( col ) );
+	}
+}
+
+Matrix::Matrix( const Matrix &other ) : Rows( other.Rows ), Columns( other.Columns ), Data( other.Data ) {
+
+}
+
+Matrix::Matrix( Matrix &&other ) : Rows( other.Rows ), Columns( other.Columns ), Data( std::move( other.Data ) ) {
+	other.Rows = other.Columns = 0;
 }
 
 Matrix::~Matrix() {
@@ -14,15 +28,41 @@ Matrix &Matrix::operator=( const Matrix &other ) {
 	if( this != &other ) {
 		Rows = other.Rows;
 		Columns = other.Columns;
-		Data.resize( Rows * Columns );
-		for( size_t i = 0; i < Data.size(); i++ ) {
-			Data[i] = other.Data[i];
-		}
+		Data = other.Data;
+	}
+
+	return *this;
+}
+
+// The storage is taken over and other is left empty, assigning Matrix() frees a matrix
+Matrix &Matrix::operator=( Matrix &&other ) {
+	if( this != &other ) {
+		Rows = other.Rows;
+		Columns = other.Columns;
+		Data = std::move( other.Data );
+
+		other.Rows = other.Columns = 0;
+		Storage().swap( other.Data );
 	}
 
 	return *this;
 }
 
+SymmetricMatrix::SymmetricMatrix( const ConstMatrixView &view ) : Rows( view.Rows ), Columns( view.Rows ), Data( view.Rows * ( view.Rows + 1 ) / 2 ) {
+	assert( view.Rows == view.Columns );
+
+	// Column j of the packed triangle takes rows 0..j of column j and columns 0..j of row j
+	#pragma omp parallel for schedule( dynamic )
+	for( long long j = 0; j < ( long long ) Columns; j++ ) {
+		const double *column = view.Column( j );
+		double *packed = &Data[Index( 0, j )];
+		for( size_t i = 0; i < ( size_t ) j; i++ ) {
+			packed[i] = 0.5 * ( column[i] + view.Column( i )[j] );
+		}
+		packed[j] = column[j];
+	}
+}
+
 void Matrix::Print() const {
 	for( size_t row = 0; row < Rows; row++ ) {
 		for( size_t col = 0; col < Columns; col++ ) {
@@ -35,12 +75,53 @@ void Matrix::Print() const {
 	}
 }
 
-double &Matrix::operator()( const size_t row, const size_t col ) {
-	assert( row < Rows && col < Columns );
-	return Data[col * Rows + row];
+// Off diagonal tiles are paired with their mirror so both are averaged in one pass
+void Symmetrize( const MatrixView &matrix ) {
+	assert( matrix.Rows == matrix.Columns );
+	const long long tiles = ( matrix.Rows + MatrixTile - 1 ) / MatrixTile;
+
+	#pragma omp parallel for schedule( dynamic )
+	for( long long tj = 0; tj < tiles; tj++ ) {
+		const size_t jStart = tj * MatrixTile, jEnd = std::min( matrix.Columns, jStart + MatrixTile );
+		for( size_t iStart = 0; iStart <= jStart; iStart += MatrixTile ) {
+			const size_t iEnd = std::min( matrix.Rows, iStart + MatrixTile );
+			for( size_t j = jStart; j < jEnd; j++ ) {
+				double *column = matrix.Column( j );
+				for( size_t i = iStart; i < std::min( iEnd, j ); i++ ) {
+					const double avg = 0.5 * ( column[i] + matrix.Column( i )[j] );
+					column[i] = avg;
+					matrix.Column( i )[j] = avg;
+				}
+			}
+		}
+	}
+}
+
+void Transpose( const ConstMatrixView &in, const MatrixView &out ) {
+	assert( out.Rows == in.Columns && out.Columns == in.Rows );
+	const long long tiles = ( in.Columns + MatrixTile - 1 ) / MatrixTile;
+
+	#pragma omp parallel for
+	for( long long tj = 0; tj < tiles; tj++ ) {
+		const size_t jStart = tj * MatrixTile, jEnd = std::min( in.Columns, jStart + MatrixTile );
+		for( size_t iStart = 0; iStart < in.Rows; iStart += MatrixTile ) {
+			const size_t iEnd = std::min( in.Rows, iStart + MatrixTile );
+			for( size_t i = iStart; i < iEnd; i++ ) {
+				double *row = out.Column( i );
+				for( size_t j = jStart; j < jEnd; j++ ) {
+					row[j] = in.Column( j )[i];
+				}
+			}
+		}
+	}
 }
 
-double Matrix::operator()( const size_t row, const size_t col ) const {
-	assert( row < Rows && col < Columns );
-	return Data[col * Rows + row];
+void GatherColumns( const ConstMatrixView &in, const std::vector<size_t> &columns, const MatrixView &out ) {
+	assert( out.Rows == in.Rows && out.Columns == columns.size() );
+
+	#pragma omp parallel for
+	for( long long j = 0; j < ( long long ) columns.size(); j++ ) {
+		const double *source = in.Column( columns[j] );
+		std::copy( source, source + in.Rows, out.Column( j ) );
+	}
 }
@@ -0,0 +1,55 @@
+#include "LTMD/ModeBasis.h"
+#include "LTMD/Aligned.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace OpenMM {
+	namespace LTMD {
+		// Zero is never issued so consumers can use it to mean no basis
+		static std::atomic<uint64_t> NextVersion( 1 );
+
+		ModeBasis::ModeBasis( const unsigned int modes, const unsigned int particles ) : mModes( modes ), mParticles( particles ),
+			mStride( 0 ), mVersion( NextVersion++ ), mData( NULL ) {
+			const size_t perLine = AlignmentBytes / sizeof( double );
+			mStride = ( Degrees() + perLine - 1 ) / perLine * perLine;
+
+			const size_t bytes = std::max<size_t>( mModes * mStride, 1 ) * sizeof( double );
+			mData = static_cast<double *>( AlignedAllocate( bytes ) );
+
+			std::memset( mData, 0, bytes );
+		}
+
+		ModeBasis::~ModeBasis() {
+			AlignedFree( mData );
+		}
+
+		ModeBasisPtr ModeBasis::Create( const std::vector<std::vector<Vec3> > &vectors ) {
+			const unsigned int particles = vectors.empty() ? 0 : vectors[0].size();
+
+			std::shared_ptr<ModeBasis> basis( new ModeBasis( vectors.size(), particles ) );
+			for( unsigned int i = 0; i < basis->Modes(); i++ ) {
+				double *mode = basis->Mode( i );
+				for( unsigned int j = 0; j < particles; j++ ) {
+					mode[3 * j + 0] = vectors[i][j][0];
+					mode[3 * j + 1] = vectors[i][j][1];
+					mode[3 * j + 2] = vectors[i][j][2];
+				}
+			}
+
+			return basis;
+		}
+
+		std::vector<std::vector<Vec3> > ModeBasis::Vectors() const {
+			std::vector<std::vector<Vec3> > vectors( mModes, std::vector<Vec3>( mParticles ) );
+			for( unsigned int i = 0; i < mModes; i++ ) {
+				for( unsigned int j = 0; j < mParticles; j++ ) {
+					vectors[i][j] = Vector( i, j );
+				}
+			}
+
+			return vectors;
+		}
+	}
+}
@@ -15,11 +15,31 @@ namespace OpenMM {
 			MaximumMinimizationCutoff = 2;
 			MaximumMinimizationIterations = 25;
 
+			Minimizer = Preference::Quadratic;
+			LBFGSMemory = 5;
+			ShouldPreconditionMinimizer = false;
+			ShouldUseEnergyOnlyTrials = false;
+			ShouldAdaptStepLength = false;
+			InnerMinimizationGroups = 0;
+			InnerMinimizationIterations = 5;
+
 			// 1/10 * ( 1 / MaxEigenvalue )
 			MinimumLambdaValue = 2e-7;
 
 			DeviceID = -1;
 			ShouldProtoMolDiagonalize = false;
+
+			ShouldPrefillNoise = false;
+			ShouldUseSinglePrecisionModes = false;
+			Rediagonalization = Preference::Automatic;
+			MemoryLimit = 0;
+			ScratchDirectory = "";
+			ScratchPanelBytes = 0;
+			RediagonalizationWorkers = 0;
+			ShouldReuseRediagonalizationMemory = false;
+			ShouldUseHugePages = false;
+
+			ShouldProfile = false;
 		}
 	}
 }
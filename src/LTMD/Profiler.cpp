@@ -0,0 +1,120 @@
+#include "LTMD/Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "openmm/OpenMMException.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		const size_t Profiler::MaximumEvents;
+
+		// Names are identifiers chosen in the code, only quotes and backslashes need escaping
+		static std::string Quote( const std::string &value ) {
+			std::string retVal = "\"";
+			for( size_t i = 0; i < value.size(); i++ ) {
+				if( value[i] == '"' || value[i] == '\\' ) {
+					retVal += '\\';
+				}
+				retVal += value[i];
+			}
+			return retVal + "\"";
+		}
+
+		static void Write( const std::string &filename, const std::string &contents ) {
+			std::ofstream file( filename.c_str() );
+			if( !file ) {
+				throw OpenMMException( "Unable to open profile " + filename );
+			}
+			file << contents;
+		}
+
+		Profiler::Profiler() : mEnabled( false ), mEpoch( std::chrono::steady_clock::now() ) {
+
+		}
+
+		void Profiler::Clear() {
+			mTimers.clear();
+			mCounters.clear();
+			mEvents.clear();
+			mEpoch = std::chrono::steady_clock::now();
+		}
+
+		uint64_t Profiler::Now() const {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - mEpoch ).count();
+		}
+
+		void Profiler::Record( const char *name, const uint64_t start, const uint64_t end ) {
+			const double elapsed = ( end - start ) * 1e-6;
+
+			std::map<std::string, Timer>::iterator it = mTimers.find( name );
+			if( it == mTimers.end() ) {
+				const Timer timer = { 1, elapsed, elapsed, elapsed };
+				mTimers.insert( std::make_pair( std::string( name ), timer ) );
+			} else {
+				Timer &timer = it->second;
+				timer.Calls++;
+				timer.Total += elapsed;
+				timer.Minimum = std::min( timer.Minimum, elapsed );
+				timer.Maximum = std::max( timer.Maximum, elapsed );
+			}
+
+			if( mEvents.size() < MaximumEvents ) {
+				const Event event = { name, start, end - start };
+				mEvents.push_back( event );
+			}
+		}
+
+		std::string Profiler::ToJSON() const {
+			std::ostringstream stream;
+			stream.precision( 15 );
+
+			stream << "{\n\t\"timers\": {";
+			for( std::map<std::string, Timer>::const_iterator it = mTimers.begin(); it != mTimers.end(); ++it ) {
+				stream << ( it == mTimers.begin() ? "\n" : ",\n" );
+				stream << "\t\t" << Quote( it->first ) << ": { \"calls\": " << it->second.Calls << ", \"total_ms\": " << it->second.Total
+					   << ", \"min_ms\": " << it->second.Minimum << ", \"max_ms\": " << it->second.Maximum << " }";
+			}
+			stream << "\n\t},\n\t\"counters\": {";
+			for( std::map<std::string, uint64_t>::const_iterator it = mCounters.begin(); it != mCounters.end(); ++it ) {
+				stream << ( it == mCounters.begin() ? "\n" : ",\n" );
+				stream << "\t\t" << Quote( it->first ) << ": " << it->second;
+			}
+			stream << "\n\t}\n}\n";
+
+			return stream.str();
+		}
+
+		std::string Profiler::ToChromeTrace() const {
+			std::ostringstream stream;
+			stream.precision( 15 );
+
+			stream << "{\"traceEvents\":[";
+			for( size_t i = 0; i < mEvents.size(); i++ ) {
+				stream << ( i == 0 ? "\n" : ",\n" );
+				stream << "{\"name\":" << Quote( mEvents[i].Name ) << ",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << mEvents[i].Start * 1e-3
+					   << ",\"dur\":" << mEvents[i].Duration * 1e-3 << "}";
+			}
+
+			// Counter totals at the end of the timeline
+			const double end = Now() * 1e-3;
+			for( std::map<std::string, uint64_t>::const_iterator it = mCounters.begin(); it != mCounters.end(); ++it ) {
+				stream << ( mEvents.empty() && it == mCounters.begin() ? "\n" : ",\n" );
+				stream << "{\"name\":" << Quote( it->first ) << ",\"ph\":\"C\",\"pid\":0,\"tid\":0,\"ts\":" << end
+					   << ",\"args\":{\"value\":" << it->second << "}}";
+			}
+			stream << "\n]}\n";
+
+			return stream.str();
+		}
+
+		void Profiler::WriteJSON( const std::string &filename ) const {
+			Write( filename, ToJSON() );
+		}
+
+		void Profiler::WriteChromeTrace( const std::string &filename ) const {
+			Write( filename, ToChromeTrace() );
+		}
+	}
+}
@@ -0,0 +1,375 @@
+#include "LTMD/Projection.h"
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace OpenMM {
+	namespace LTMD {
+		// Degrees of freedom below which the passes run on the calling thread only
+		const size_t ParallelThreshold = 30000;
+
+		// Kernels for any number of modes. The basis may be stored as float or double, the
+		// products are always accumulated in double.
+		template<typename Real>
+		static void CoefficientsGeneric( const void *data, const double *in, const long long first, const long long last, const unsigned int modes, double *partial ) {
+			const Real *basis = static_cast<const Real *>( data );
+
+			for( long long j = first; j < last; j++ ) {
+				const double value = in[j];
+				const Real *row = &basis[j * modes];
+				for( unsigned int k = 0; k < modes; k++ ) {
+					partial[k] += row[k] * value;
+				}
+			}
+		}
+
+		template<typename Real>
+		static void ExpandGeneric( const void *data, const double *coefficients, const double *in, double *out, const long long first, const long long last, const unsigned int modes, const bool compliment ) {
+			const Real *basis = static_cast<const Real *>( data );
+
+			for( long long j = first; j < last; j++ ) {
+				const Real *row = &basis[j * modes];
+
+				double sum = 0.0;
+				for( unsigned int k = 0; k < modes; k++ ) {
+					sum += row[k] * coefficients[k];
+				}
+
+				out[j] = compliment ? in[j] - sum : sum;
+			}
+		}
+
+		// Kernels for a fixed number of modes, the coefficients are held in registers and the
+		// inner loops are fully unrolled
+		template<typename Real, unsigned int Modes>
+		static void CoefficientsFixed( const void *data, const double *in, const long long first, const long long last, const unsigned int, double *partial ) {
+			const Real *basis = static_cast<const Real *>( data );
+
+			double c[Modes];
+			for( unsigned int k = 0; k < Modes; k++ ) {
+				c[k] = 0.0;
+			}
+
+			for( long long j = first; j < last; j++ ) {
+				const double value = in[j];
+				const Real *row = &basis[j * Modes];
+				for( unsigned int k = 0; k < Modes; k++ ) {
+					c[k] += row[k] * value;
+				}
+			}
+
+			for( unsigned int k = 0; k < Modes; k++ ) {
+				partial[k] += c[k];
+			}
+		}
+
+		template<typename Real, unsigned int Modes>
+		static void ExpandFixed( const void *data, const double *coefficients, const double *in, double *out, const long long first, const long long last, const unsigned int, const bool compliment ) {
+			const Real *basis = static_cast<const Real *>( data );
+
+			double c[Modes];
+			for( unsigned int k = 0; k < Modes; k++ ) {
+				c[k] = coefficients[k];
+			}
+
+			for( long long j = first; j < last; j++ ) {
+				const Real *row = &basis[j * Modes];
+
+				double sum = 0.0;
+				for( unsigned int k = 0; k < Modes; k++ ) {
+					sum += row[k] * c[k];
+				}
+
+				out[j] = compliment ? in[j] - sum : sum;
+			}
+		}
+
+		// Kernels for several vectors at once, each row of the basis is loaded once and applied
+		// to every vector. The coefficients of vector r are held at r * modes.
+		template<typename Real>
+		static void CoefficientsBatch( const Real *basis, const double *const *in, const size_t count, const long long first, const long long last, const unsigned int modes, double *partial ) {
+			for( long long j = first; j < last; j++ ) {
+				const Real *row = &basis[j * modes];
+				for( size_t r = 0; r < count; r++ ) {
+					const double value = in[r][j];
+					double *c = &partial[r * modes];
+					for( unsigned int k = 0; k < modes; k++ ) {
+						c[k] += row[k] * value;
+					}
+				}
+			}
+		}
+
+		template<typename Real>
+		static void ExpandBatch( const Real *basis, const double *coefficients, const double *const *in, double *const *out, const size_t count, const long long first, const long long last, const unsigned int modes, const bool compliment ) {
+			for( long long j = first; j < last; j++ ) {
+				const Real *row = &basis[j * modes];
+				for( size_t r = 0; r < count; r++ ) {
+					const double *c = &coefficients[r * modes];
+
+					double sum = 0.0;
+					for( unsigned int k = 0; k < modes; k++ ) {
+						sum += row[k] * c[k];
+					}
+
+					out[r][j] = compliment ? in[r][j] - sum : sum;
+				}
+			}
+		}
+
+		Projection::Projection() : mDegrees( 0 ), mModes( 0 ), mThreads( 1 ), mVersion( 0 ), mSinglePrecision( false ), mCoefficientKernel( CoefficientsGeneric<double> ), mExpandKernel( ExpandGeneric<double> ) {
+
+		}
+
+		void Projection::SetMasses( const std::vector<double> &masses ) {
+			mMasses = masses;
+			mDegrees = 3 * mMasses.size();
+
+			// The packed basis carries the old weights
+			mVersion = 0;
+		}
+
+		void Projection::SetSinglePrecision( const bool value ) {
+			mSinglePrecision = value;
+		}
+
+		void Projection::SetBasis( const ModeBasis &basis ) {
+			mModes = basis.Modes();
+			mVersion = basis.Version();
+
+			if( mSinglePrecision ) {
+				Pack( basis, mSingleMassWeighted, mSingleInverseMassWeighted );
+				std::vector<double>().swap( mMassWeighted );
+				std::vector<double>().swap( mInverseMassWeighted );
+			} else {
+				Pack( basis, mMassWeighted, mInverseMassWeighted );
+				std::vector<float>().swap( mSingleMassWeighted );
+				std::vector<float>().swap( mSingleInverseMassWeighted );
+			}
+
+			Dispatch();
+
+#ifdef _OPENMP
+			mThreads = omp_get_max_threads();
+#endif
+			mCoefficients.resize( mModes );
+			mPartial.resize( mThreads * mModes );
+		}
+
+		// Row j holds component j of every mode
+		template<typename Real>
+		void Projection::Pack( const ModeBasis &basis, std::vector<Real> &massWeighted, std::vector<Real> &inverseMassWeighted ) const {
+			massWeighted.resize( mDegrees * mModes );
+			inverseMassWeighted.resize( mDegrees * mModes );
+
+			for( size_t atom = 0; atom < mMasses.size(); atom++ ) {
+				const double weight = std::sqrt( mMasses[atom] );
+				const double inverseWeight = 1.0 / weight;
+
+				for( unsigned int axis = 0; axis < 3; axis++ ) {
+					const size_t row = ( 3 * atom + axis ) * mModes;
+					for( unsigned int mode = 0; mode < mModes; mode++ ) {
+						const double value = basis.Mode( mode )[3 * atom + axis];
+						massWeighted[row + mode] = ( Real )( weight * value );
+						inverseMassWeighted[row + mode] = ( Real )( inverseWeight * value );
+					}
+				}
+			}
+		}
+
+		// Select the kernels once per basis rather than per call
+		template<typename Real>
+		void Projection::Select() {
+			switch( mModes ) {
+				case 8:
+					mCoefficientKernel = CoefficientsFixed<Real, 8>;
+					mExpandKernel = ExpandFixed<Real, 8>;
+					break;
+				case 10:
+					mCoefficientKernel = CoefficientsFixed<Real, 10>;
+					mExpandKernel = ExpandFixed<Real, 10>;
+					break;
+				case 12:
+					mCoefficientKernel = CoefficientsFixed<Real, 12>;
+					mExpandKernel = ExpandFixed<Real, 12>;
+					break;
+				case 16:
+					mCoefficientKernel = CoefficientsFixed<Real, 16>;
+					mExpandKernel = ExpandFixed<Real, 16>;
+					break;
+				case 24:
+					mCoefficientKernel = CoefficientsFixed<Real, 24>;
+					mExpandKernel = ExpandFixed<Real, 24>;
+					break;
+				case 32:
+					mCoefficientKernel = CoefficientsFixed<Real, 32>;
+					mExpandKernel = ExpandFixed<Real, 32>;
+					break;
+				default:
+					mCoefficientKernel = CoefficientsGeneric<Real>;
+					mExpandKernel = ExpandGeneric<Real>;
+					break;
+			}
+		}
+
+		void Projection::Dispatch() {
+			if( mSinglePrecision ) {
+				Select<float>();
+			} else {
+				Select<double>();
+			}
+		}
+
+		void Projection::Project( const double *in, double *out, const EWeight weight, const bool compliment ) {
+			if( mModes == 0 ) {
+				for( size_t i = 0; i < mDegrees; i++ ) {
+					out[i] = compliment ? in[i] : 0.0;
+				}
+				return;
+			}
+
+			// W Q for the coefficients, W^-1 Q for the expansion
+			const void *forward, *backward;
+			if( mSinglePrecision ) {
+				forward = ( weight == Mass ) ? &mSingleMassWeighted[0] : &mSingleInverseMassWeighted[0];
+				backward = ( weight == Mass ) ? &mSingleInverseMassWeighted[0] : &mSingleMassWeighted[0];
+			} else {
+				forward = ( weight == Mass ) ? &mMassWeighted[0] : &mInverseMassWeighted[0];
+				backward = ( weight == Mass ) ? &mInverseMassWeighted[0] : &mMassWeighted[0];
+			}
+
+			Coefficients( forward, in );
+			Expand( backward, in, out, compliment );
+		}
+
+		// c = A^T x, each thread accumulating a slice of rows before a final reduction
+		void Projection::Coefficients( const void *basis, const double *in ) {
+			const unsigned int modes = mModes;
+			const long long rows = mDegrees;
+
+#ifdef _OPENMP
+			if( omp_get_max_threads() > ( int ) mThreads ) {
+				mThreads = omp_get_max_threads();
+				mPartial.resize( mThreads * modes );
+			}
+#endif
+			std::fill( mPartial.begin(), mPartial.end(), 0.0 );
+
+			#pragma omp parallel if( rows > ( long long ) ParallelThreshold )
+			{
+				unsigned int thread = 0, threads = 1;
+#ifdef _OPENMP
+				thread = omp_get_thread_num();
+				threads = omp_get_num_threads();
+#endif
+				const long long first = rows * thread / threads;
+				const long long last = rows * ( thread + 1 ) / threads;
+
+				mCoefficientKernel( basis, in, first, last, modes, &mPartial[thread * modes] );
+			}
+
+			for( unsigned int k = 0; k < modes; k++ ) {
+				double sum = 0.0;
+				for( unsigned int t = 0; t < mThreads; t++ ) {
+					sum += mPartial[t * modes + k];
+				}
+				mCoefficients[k] = sum;
+			}
+		}
+
+		// x' = B c, or x - B c for the compliment
+		void Projection::Expand( const void *basis, const double *in, double *out, const bool compliment ) const {
+			const unsigned int modes = mModes;
+			const long long rows = mDegrees;
+			const double *coefficients = &mCoefficients[0];
+
+			#pragma omp parallel if( rows > ( long long ) ParallelThreshold )
+			{
+				unsigned int thread = 0, threads = 1;
+#ifdef _OPENMP
+				thread = omp_get_thread_num();
+				threads = omp_get_num_threads();
+#endif
+				const long long first = rows * thread / threads;
+				const long long last = rows * ( thread + 1 ) / threads;
+
+				mExpandKernel( basis, coefficients, in, out, first, last, modes, compliment );
+			}
+		}
+
+		void Projection::ProjectBatch( const double *const *in, double *const *out, const size_t count, const EWeight weight, const bool compliment ) {
+			if( mModes == 0 || count < 2 ) {
+				for( size_t r = 0; r < count; r++ ) {
+					Project( in[r], out[r], weight, compliment );
+				}
+				return;
+			}
+
+			if( mSinglePrecision ) {
+				const float *forward = ( weight == Mass ) ? &mSingleMassWeighted[0] : &mSingleInverseMassWeighted[0];
+				const float *backward = ( weight == Mass ) ? &mSingleInverseMassWeighted[0] : &mSingleMassWeighted[0];
+				BatchPasses( forward, backward, in, out, count, compliment );
+			} else {
+				const double *forward = ( weight == Mass ) ? &mMassWeighted[0] : &mInverseMassWeighted[0];
+				const double *backward = ( weight == Mass ) ? &mInverseMassWeighted[0] : &mMassWeighted[0];
+				BatchPasses( forward, backward, in, out, count, compliment );
+			}
+		}
+
+		// Both passes over a slice of rows per thread, as for a single vector
+		template<typename Real>
+		void Projection::BatchPasses( const Real *forward, const Real *backward, const double *const *in, double *const *out, const size_t count, const bool compliment ) {
+			const unsigned int modes = mModes;
+			const long long rows = mDegrees;
+			const size_t width = count * modes;
+
+#ifdef _OPENMP
+			if( omp_get_max_threads() > ( int ) mThreads ) {
+				mThreads = omp_get_max_threads();
+			}
+#endif
+			mBatchPartial.assign( mThreads * width, 0.0 );
+			mBatchCoefficients.resize( width );
+
+			#pragma omp parallel if( rows * ( long long ) count > ( long long ) ParallelThreshold )
+			{
+				unsigned int thread = 0, threads = 1;
+#ifdef _OPENMP
+				thread = omp_get_thread_num();
+				threads = omp_get_num_threads();
+#endif
+				const long long first = rows * thread / threads;
+				const long long last = rows * ( thread + 1 ) / threads;
+
+				CoefficientsBatch( forward, in, count, first, last, modes, &mBatchPartial[thread * width] );
+			}
+
+			for( size_t i = 0; i < width; i++ ) {
+				double sum = 0.0;
+				for( unsigned int t = 0; t < mThreads; t++ ) {
+					sum += mBatchPartial[t * width + i];
+				}
+				mBatchCoefficients[i] = sum;
+			}
+
+			const double *coefficients = &mBatchCoefficients[0];
+
+			#pragma omp parallel if( rows * ( long long ) count > ( long long ) ParallelThreshold )
+			{
+				unsigned int thread = 0, threads = 1;
+#ifdef _OPENMP
+				thread = omp_get_thread_num();
+				threads = omp_get_num_threads();
+#endif
+				const long long first = rows * thread / threads;
+				const long long last = rows * ( thread + 1 ) / threads;
+
+				ExpandBatch( backward, coefficients, in, out, count, first, last, modes, compliment );
+			}
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#include "LTMD/ProjectionBatch.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace OpenMM {
+	namespace LTMD {
+		ProjectionBatch::ProjectionBatch( const std::vector<double> &masses, const ModeBasisPtr &basis, const unsigned int participants, const bool singlePrecision )
+			: mBasis( basis ), mParticipants( participants ), mThreads( 1 ), mGeneration( 0 ), mBatches( 0 ), mVectors( 0 ) {
+#ifdef _OPENMP
+			mThreads = omp_get_max_threads();
+#endif
+			mProjection.SetMasses( masses );
+			mProjection.SetSinglePrecision( singlePrecision );
+			if( mBasis ) {
+				mProjection.SetBasis( *mBasis );
+			}
+			mPending.reserve( participants );
+		}
+
+		void ProjectionBatch::Project( const double *in, double *out, const Projection::EWeight weight, const bool compliment ) {
+			std::unique_lock<std::mutex> lock( mMutex );
+
+			Request request = { in, out, weight, compliment };
+			mPending.push_back( request );
+
+			if( mPending.size() >= mParticipants ) {
+				Flush();
+				return;
+			}
+
+			const uint64_t generation = mGeneration;
+			mReleased.wait( lock, [&]() {
+				return mGeneration != generation;
+			} );
+		}
+
+		void ProjectionBatch::Leave() {
+			std::unique_lock<std::mutex> lock( mMutex );
+
+			mParticipants--;
+			if( !mPending.empty() && mPending.size() >= mParticipants ) {
+				Flush();
+			}
+		}
+
+		uint64_t ProjectionBatch::Batches() const {
+			std::lock_guard<std::mutex> lock( mMutex );
+			return mBatches;
+		}
+
+		uint64_t ProjectionBatch::Vectors() const {
+			std::lock_guard<std::mutex> lock( mMutex );
+			return mVectors;
+		}
+
+		// Called with the lock held once every participant is waiting. Requests are grouped by
+		// weight and direction, in practice every replica is in the same phase and there is one.
+		void ProjectionBatch::Flush() {
+#ifdef _OPENMP
+			const int previous = omp_get_max_threads();
+			omp_set_num_threads( mThreads );
+#endif
+
+			for( unsigned int group = 0; group < 4; group++ ) {
+				const Projection::EWeight weight = ( group & 1 ) ? Projection::InverseMass : Projection::Mass;
+				const bool compliment = ( group & 2 ) != 0;
+
+				mIn.clear();
+				mOut.clear();
+				for( size_t i = 0; i < mPending.size(); i++ ) {
+					if( mPending[i].weight == weight && mPending[i].compliment == compliment ) {
+						mIn.push_back( mPending[i].in );
+						mOut.push_back( mPending[i].out );
+					}
+				}
+
+				if( !mIn.empty() ) {
+					mProjection.ProjectBatch( &mIn[0], &mOut[0], mIn.size(), weight, compliment );
+					mBatches++;
+					mVectors += mIn.size();
+				}
+			}
+
+#ifdef _OPENMP
+			omp_set_num_threads( previous );
+#endif
+
+			mPending.clear();
+			mGeneration++;
+			mReleased.notify_all();
+		}
+	}
+}
@@ -0,0 +1,149 @@
+#include "LTMD/Random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace OpenMM {
+	namespace LTMD {
+		const uint32_t PhiloxM0 = 0xD2511F53, PhiloxM1 = 0xCD9E8D57;
+		const uint32_t PhiloxW0 = 0x9E3779B9, PhiloxW1 = 0xBB67AE85;
+		const unsigned int PhiloxRounds = 10;
+
+		// Counters generated together so the rounds and Box-Muller transform vectorize
+		const unsigned int PhiloxLanes = 8;
+
+		const double TwoPi = 6.283185307179586476925286766559;
+
+		// Maps a 32 bit integer onto (0, 1]
+		static inline double ToUniform( const uint32_t value ) {
+			return ( value + 1.0 ) * ( 1.0 / 4294967296.0 );
+		}
+
+		template<unsigned int Lanes>
+		static inline void PhiloxBatch( uint32_t ( &ctr )[4][Lanes], uint32_t k0, uint32_t k1 ) {
+			for( unsigned int r = 0; r < PhiloxRounds; r++ ) {
+				if( r != 0 ) {
+					k0 += PhiloxW0;
+					k1 += PhiloxW1;
+				}
+
+				for( unsigned int l = 0; l < Lanes; l++ ) {
+					const uint64_t p0 = ( uint64_t ) PhiloxM0 * ctr[0][l];
+					const uint64_t p1 = ( uint64_t ) PhiloxM1 * ctr[2][l];
+
+					const uint32_t c1 = ctr[1][l], c3 = ctr[3][l];
+					ctr[0][l] = ( uint32_t )( p1 >> 32 ) ^ c1 ^ k0;
+					ctr[1][l] = ( uint32_t ) p1;
+					ctr[2][l] = ( uint32_t )( p0 >> 32 ) ^ c3 ^ k1;
+					ctr[3][l] = ( uint32_t ) p0;
+				}
+			}
+		}
+
+		Random::Random( const uint32_t seed ) : mSeed( seed ), mNextStep( 0 ), mHasNext( false ) {
+
+		}
+
+		Random::~Random() {
+			Wait();
+		}
+
+		void Random::SetSeed( const uint32_t seed ) {
+			Wait();
+			mSeed = seed;
+			mHasNext = false;
+		}
+
+		void Random::Philox( const uint32_t counter[4], const uint32_t key[2], uint32_t out[4] ) {
+			uint32_t ctr[4][1] = { { counter[0] }, { counter[1] }, { counter[2] }, { counter[3] } };
+			PhiloxBatch<1>( ctr, key[0], key[1] );
+
+			for( unsigned int i = 0; i < 4; i++ ) {
+				out[i] = ctr[i][0];
+			}
+		}
+
+		// Counter layout: ( block low, block high, step low, step high ), key: ( seed, stream ).
+		// Each counter yields four integers which become two Box-Muller pairs.
+		void Random::FillNormal( const uint32_t stream, const uint64_t step, std::vector<double> &values ) const {
+			const size_t count = values.size();
+			const long long batchValues = 4 * PhiloxLanes;
+			const long long batches = ( count + batchValues - 1 ) / batchValues;
+
+			#pragma omp parallel for
+			for( long long b = 0; b < batches; b++ ) {
+				uint32_t ctr[4][PhiloxLanes];
+				for( unsigned int l = 0; l < PhiloxLanes; l++ ) {
+					const uint64_t block = b * PhiloxLanes + l;
+					ctr[0][l] = ( uint32_t ) block;
+					ctr[1][l] = ( uint32_t )( block >> 32 );
+					ctr[2][l] = ( uint32_t ) step;
+					ctr[3][l] = ( uint32_t )( step >> 32 );
+				}
+
+				PhiloxBatch<PhiloxLanes>( ctr, mSeed, stream );
+
+				double normal[4 * PhiloxLanes];
+				for( unsigned int l = 0; l < PhiloxLanes; l++ ) {
+					const double r0 = std::sqrt( -2.0 * std::log( ToUniform( ctr[0][l] ) ) );
+					const double t0 = TwoPi * ToUniform( ctr[1][l] );
+					const double r1 = std::sqrt( -2.0 * std::log( ToUniform( ctr[2][l] ) ) );
+					const double t1 = TwoPi * ToUniform( ctr[3][l] );
+
+					normal[4 * l + 0] = r0 * std::cos( t0 );
+					normal[4 * l + 1] = r0 * std::sin( t0 );
+					normal[4 * l + 2] = r1 * std::cos( t1 );
+					normal[4 * l + 3] = r1 * std::sin( t1 );
+				}
+
+				const size_t start = b * batchValues;
+				const size_t end = std::min( count, ( size_t )( start + batchValues ) );
+				for( size_t i = start; i < end; i++ ) {
+					values[i] = normal[i - start];
+				}
+			}
+		}
+
+		double Random::Uniform( const uint32_t stream, const uint64_t step, const uint32_t index ) const {
+			const uint64_t block = index / 4;
+			const uint32_t counter[4] = { ( uint32_t ) block, ( uint32_t )( block >> 32 ), ( uint32_t ) step, ( uint32_t )( step >> 32 ) };
+			const uint32_t key[2] = { mSeed, stream };
+
+			uint32_t out[4];
+			Philox( counter, key, out );
+
+			return ToUniform( out[index % 4] );
+		}
+
+		const std::vector<double> &Random::Normal( const uint64_t step, const size_t count ) {
+			Wait();
+
+			if( mHasNext && mNextStep == step && mNext.size() == count ) {
+				mCurrent.swap( mNext );
+			} else {
+				mCurrent.resize( count );
+				FillNormal( Noise, step, mCurrent );
+			}
+			mHasNext = false;
+
+			return mCurrent;
+		}
+
+		void Random::Prefill( const uint64_t step, const size_t count ) {
+			Wait();
+
+			mNext.resize( count );
+			mNextStep = step;
+			mHasNext = true;
+
+			mWorker = std::thread( &Random::FillNormal, this, ( uint32_t ) Noise, step, std::ref( mNext ) );
+		}
+
+		void Random::Wait() {
+			if( mWorker.joinable() ) {
+				mWorker.join();
+			}
+		}
+	}
+}
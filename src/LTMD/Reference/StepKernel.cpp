@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include "LTMD/ProjectionBatch.h"
 #include "LTMD/Reference/StepKernel.h"
 #include "openmm/HarmonicAngleForce.h"
 #include "openmm/internal/ContextImpl.h"
@@ -40,8 +42,17 @@ namespace OpenMM {
 
 				mXPrime.resize( mParticles );
 				mPreviousPositions.resize( mParticles );
+				mHasPreviousPositions = false;
+				mMinimizerScale = 1.0;
+
+				mProjection.SetMasses( mMasses );
+				mProjection.SetSinglePrecision( integrator.getParameters().ShouldUseSinglePrecisionModes );
+#ifdef KERNEL_VALIDATION
+				mValidationProjection.SetMasses( mMasses );
+#endif
 
-				SimTKOpenMMUtilities::setRandomNumberSeed( ( unsigned int ) integrator.getRandomNumberSeed() );
+				mRandom.SetSeed( ( uint32_t ) integrator.getRandomNumberSeed() );
+				mShouldPrefillNoise = integrator.getParameters().ShouldPrefillNoise;
 			}
 
 			void StepKernel::Integrate( ContextImpl &context, const Integrator &integrator ) {
@@ -58,26 +69,37 @@ namespace OpenMM {
 				VectorArray &velocities = extractVelocities( context );
 				const VectorArray &forces = extractForces( context );
 
+				// Noise is keyed by seed and step so it is independent of thread count
+				const DoubleArray &gaussian = mRandom.Normal( data.stepCount, 3 * mParticles );
+
 				// Update the velocity.
-				for( unsigned int i = 0; i < mParticles; i++ ) {
+				#pragma omp parallel for
+				for( int i = 0; i < ( int ) mParticles; i++ ) {
 					for( unsigned int j = 0; j < 3; j++ ) {
 						const double velocity = vscale * velocities[i][j];
 						const double force = fscale * forces[i][j];
-						const double noise = noisescale * SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
+						const double noise = noisescale * gaussian[3 * i + j];
 
 						velocities[i][j] = velocity + force * mInverseMasses[i] + noise * std::sqrt( mInverseMasses[i] );
 					}
 				}
 
+				// Overlap generating the next step's noise with projection and minimization
+				if( mShouldPrefillNoise ) {
+					mRandom.Prefill( data.stepCount + 1, 3 * mParticles );
+				}
+
 				// Project resulting velocities onto subspace
-				Project( integrator, velocities, velocities, mMasses, mInverseMasses, false );
+				Project( integrator, velocities, velocities, Projection::Mass, false );
 
 				// Update the positions.
+				VectorArray &target = MoveTarget( context );
 				for( unsigned int i = 0; i < mParticles; i++ ) {
-					coordinates[i][0] += deltaT * velocities[i][0];
-					coordinates[i][1] += deltaT * velocities[i][1];
-					coordinates[i][2] += deltaT * velocities[i][2];
+					target[i][0] = coordinates[i][0] + deltaT * velocities[i][0];
+					target[i][1] = coordinates[i][1] + deltaT * velocities[i][1];
+					target[i][2] = coordinates[i][2] + deltaT * velocities[i][2];
 				}
+				CommitMove( context );
 			}
 
 			void StepKernel::UpdateTime( const Integrator &integrator ) {
@@ -85,24 +107,30 @@ namespace OpenMM {
 				data.stepCount++;
 			}
 
-			void StepKernel::AcceptStep( ContextImpl &context ) {
-				VectorArray &coordinates = extractPositions( context );
+			// The positions are double buffered. The first move after accepting, by Integrate or
+			// either minimizer, is written into the spare buffer and swapped with the context's,
+			// leaving the accepted positions in the spare one. Later moves are made in place. So
+			// accepting is free and rejecting swaps them back, as copying them would.
+			VectorArray &StepKernel::MoveTarget( ContextImpl &context ) {
+				return mHasPreviousPositions ? extractPositions( context ) : mPreviousPositions;
+			}
 
-				for( unsigned int i = 0; i < mParticles; i++ ) {
-					mPreviousPositions[i][0] = coordinates[i][0];
-					mPreviousPositions[i][1] = coordinates[i][1];
-					mPreviousPositions[i][2] = coordinates[i][2];
+			void StepKernel::CommitMove( ContextImpl &context ) {
+				if( !mHasPreviousPositions ) {
+					extractPositions( context ).swap( mPreviousPositions );
+					mHasPreviousPositions = true;
 				}
+			}
+
+			void StepKernel::AcceptStep( ContextImpl &context ) {
+				mHasPreviousPositions = false;
 				mMinimizerScale = 1.0;
 			}
 
 			void StepKernel::RejectStep( ContextImpl &context ) {
-				VectorArray &coordinates = extractPositions( context );
-
-				for( unsigned int i = 0; i < mParticles; i++ ) {
-					coordinates[i][0] = mPreviousPositions[i][0];
-					coordinates[i][1] = mPreviousPositions[i][1];
-					coordinates[i][2] = mPreviousPositions[i][2];
+				if( mHasPreviousPositions ) {
+					extractPositions( context ).swap( mPreviousPositions );
+					mHasPreviousPositions = false;
 				}
 				mMinimizerScale *= 0.25;
 			}
@@ -115,7 +143,7 @@ namespace OpenMM {
 				mPreviousEnergy = energy;
 
 				//project forces into complement space, put in mXPrime
-				Project( integrator, forces, mXPrime, mInverseMasses, mMasses, true );
+				Project( integrator, forces, mXPrime, Projection::InverseMass, true );
 
 				// Scale mXPrime if needed
 				if( mMinimizerScale != 1.0 ) {
@@ -128,13 +156,15 @@ namespace OpenMM {
 
 				//Add minimizer position update to atomCoordinates
 				// with 'line search guess = 1/maxEig (the solution if the system was quadratic)
+				VectorArray &target = MoveTarget( context );
 				for( unsigned int i = 0; i < mParticles; i++ ) {
 					double factor = mInverseMasses[i] / integrator.getMaxEigenvalue();
 
-					coordinates[i][0] += factor * mXPrime[i][0];
-					coordinates[i][1] += factor * mXPrime[i][1];
-					coordinates[i][2] += factor * mXPrime[i][2];
+					target[i][0] = coordinates[i][0] + factor * mXPrime[i][0];
+					target[i][1] = coordinates[i][1] + factor * mXPrime[i][1];
+					target[i][2] = coordinates[i][2] + factor * mXPrime[i][2];
 				}
+				CommitMove( context );
 			}
 
 			double StepKernel::QuadraticMinimize( ContextImpl &context, const Integrator &integrator, const double energy ) {
@@ -175,13 +205,15 @@ namespace OpenMM {
 				const double dlambda = lambda - oldLambda;
 
 				//Remove previous position update (-oldLambda) and add new move (lambda)
+				VectorArray &target = MoveTarget( context );
 				for( unsigned int i = 0; i < mParticles; i++ ) {
 					const double factor = mInverseMasses[i] * dlambda;
 
-					coordinates[i][0] += factor * mXPrime[i][0];
-					coordinates[i][1] += factor * mXPrime[i][1];
-					coordinates[i][2] += factor * mXPrime[i][2];
+					target[i][0] = coordinates[i][0] + factor * mXPrime[i][0];
+					target[i][1] = coordinates[i][1] + factor * mXPrime[i][1];
+					target[i][2] = coordinates[i][2] + factor * mXPrime[i][2];
 				}
+				CommitMove( context );
 
 				return lambda;
 			}
@@ -190,105 +222,47 @@ namespace OpenMM {
 			// Find forces OR positions inside subspace (defined as the span of the 'eigenvectors' Q)
 			// Take 'array' as input, 'outArray' as output (may be the same vector).
 			//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-			void CopyArray( const VectorArray &in, VectorArray &out ) {
-				if( &in != &out ) {
-					const unsigned int size = in.size();
-					for( unsigned int i = 0; i < size; i++ ) {
-						out[i][0] = in[i][0];
-						out[i][1] = in[i][1];
-						out[i][2] = in[i][2];
-					}
+			void StepKernel::Project( const Integrator &integrator, const VectorArray &in, VectorArray &out, const Projection::EWeight weight, const bool compliment ) {
+				static_assert( sizeof( RealVec ) == 3 * sizeof( double ), "Projection requires contiguous double precision vectors" );
+
+				// Replicas sharing a basis project together
+				ProjectionBatch *batch = integrator.getProjectionBatch();
+				if( batch ) {
+					batch->Project( reinterpret_cast<const double *>( &in[0] ), reinterpret_cast<double *>( &out[0] ), weight, compliment );
+					return;
 				}
-			}
-
-			void ScaleArray( const DoubleArray &scale, VectorArray &out ) {
-				const unsigned int size = out.size();
-				for( unsigned int i = 0; i < size; i++ ) {
-					const double weight = std::sqrt( scale[i] );
 
-					out[i][0] *= weight;
-					out[i][1] *= weight;
-					out[i][2] *= weight;
+				// Repack only when the integrator holds a different basis
+				const ModeBasisPtr basis = integrator.getModeBasis();
+				if( basis && basis->Version() != mProjection.Version() ) {
+					mProjection.SetBasis( *basis );
+#ifdef KERNEL_VALIDATION
+					mValidationProjection.SetBasis( *basis );
+#endif
 				}
-			}
-
-			void StepKernel::Project( const Integrator &integrator, const VectorArray &in, VectorArray &out, const DoubleArray &scale, const DoubleArray &inverseScale, const bool compliment ) {
-				unsigned int vectors = integrator.getNumProjectionVectors();
-
-				if( mProjectionVectors.size() == 0 || integrator.getProjVecChanged() ) {
-					if( mProjectionVectors.size() == 0 ) {
-						const unsigned int size = vectors * mParticles * 3;
 
-						mProjectionVectors.resize( size );
-					}
-
-					const std::vector<std::vector<OpenMM::Vec3> > &dProjectionVectors = integrator.getProjectionVectors();
-
-					int index = 0;
-					for( unsigned int i = 0; i < dProjectionVectors.size(); i++ ) {
-						for( unsigned int j = 0; j < dProjectionVectors[i].size(); j++ ) {
-							mProjectionVectors[index++] = dProjectionVectors[i][j][0];
-							mProjectionVectors[index++] = dProjectionVectors[i][j][1];
-							mProjectionVectors[index++] = dProjectionVectors[i][j][2];
-						}
-					}
+#ifdef KERNEL_VALIDATION
+				// Compare the single precision basis against the double precision path
+				VectorArray expected( in.size() );
+				if( mProjection.IsSinglePrecision() ) {
+					mValidationProjection.Project( reinterpret_cast<const double *>( &in[0] ), reinterpret_cast<double *>( &expected[0] ), weight, compliment );
 				}
+#endif
 
-				CopyArray( in, out );
-				ScaleArray( scale, out );
-
-				const unsigned int _3N = in.size() * 3;
+				mProjection.Project( reinterpret_cast<const double *>( &in[0] ), reinterpret_cast<double *>( &out[0] ), weight, compliment );
 
-				//Project onto mode space by taking the matrix product of
-				//the transpose of the eigenvectors Q with the array.
-				//
-				//c=Q^T*a', a' from last algorithm step
-				//
-
-				//If no Blas is available we need to manually find the product c=A*b
-				//c_i=\sum_{j=1}^n A_{i,j} b_j
-
-				//c=Q^T*a', a' from last algorithm step
-				//Q is a linear array in column major format
-				//so tmpC_i = \sum_{j=1}^n Q_{j,i} outArray_j
-				//Q_{j,i}=_projectionVectors[j * numberOfAtoms * 3 + i]
-
-				DoubleArray tmpC( vectors );
-				for( unsigned int i = 0; i < vectors; i++ ) {
-
-					tmpC[i] = 0.0;
-					for( unsigned int j = 0; j < _3N; j++ ) {
-						tmpC[i] += mProjectionVectors[j  + i * _3N] * out[j / 3][j % 3];
-					}
-				}
-
-				//Now find projected force/positions a'' by matrix product with Eigenvectors Q
-				//a''=Qc
-				//so outArray_i  = \sum_{j=1}^n Q_{i,j} tmpC_i
-
-				//find product
-				for( unsigned int i = 0; i < _3N; i++ ) {
-
-					//if sub-space do Q*c
-					//else do a'-Q(Q^T a') = (I-QQ^T)a'
-					const unsigned int ii = i / 3;
-					const unsigned int jj = i % 3;
-					if( !compliment ) {
-						out[ii][jj] = 0.0;
-
-						for( unsigned int j = 0; j < vectors; j++ ) {
-							out[ii][jj] += mProjectionVectors[i + j * _3N] * tmpC[j];
-						}
-					} else {
-						for( unsigned int j = 0; j < vectors; j++ ) {
-							out[ii][jj] -= mProjectionVectors[i + j * _3N] * tmpC[j];
+#ifdef KERNEL_VALIDATION
+				if( mProjection.IsSinglePrecision() ) {
+					double difference = 0.0, magnitude = 0.0;
+					for( unsigned int i = 0; i < mParticles; i++ ) {
+						for( unsigned int j = 0; j < 3; j++ ) {
+							difference = std::max( difference, std::fabs( out[i][j] - expected[i][j] ) );
+							magnitude = std::max( magnitude, std::fabs( expected[i][j] ) );
 						}
-
 					}
-
+					std::cout << "[Reference::StepKernel::Project] Single Precision Error: " << difference << " Relative: " << ( magnitude > 0.0 ? difference / magnitude : 0.0 ) << std::endl;
 				}
-
-				ScaleArray( inverseScale, out );
+#endif
 			}
 		}
 	}
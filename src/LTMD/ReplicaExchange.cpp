@@ -0,0 +1,79 @@
+#include "LTMD/ReplicaExchange.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "openmm/OpenMMException.h"
+#include "openmm/State.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		// kJ/(mol K), OpenMM energies are in kJ/mol
+		const double BoltzmannConstant = 0.0083144621;
+
+		ReplicaExchange::ReplicaExchange( const System &system, const Parameters &params, const std::vector<double> &temperatures, const double frictionCoeff, const double stepSize, Platform &platform )
+			: mEnsemble( system, params, temperatures.size(), temperatures.empty() ? 0.0 : temperatures[0], frictionCoeff, stepSize, platform, false ),
+			  mTemperatures( temperatures ), mReplica( temperatures.size() ), mAttempts( temperatures.size(), 0 ), mAcceptances( temperatures.size(), 0 ),
+			  mRandom( ( uint32_t ) mEnsemble.GetIntegrator( 0 ).getRandomNumberSeed() ), mCycle( 0 ) {
+			for( unsigned int i = 0; i < mTemperatures.size(); i++ ) {
+				mReplica[i] = i;
+				mEnsemble.GetIntegrator( i ).setTemperature( mTemperatures[i] );
+			}
+		}
+
+		double ReplicaExchange::Probability( const double temperatureI, const double energyI, const double temperatureJ, const double energyJ ) {
+			const double betaI = 1.0 / ( BoltzmannConstant * temperatureI );
+			const double betaJ = 1.0 / ( BoltzmannConstant * temperatureJ );
+
+			const double delta = ( betaI - betaJ ) * ( energyI - energyJ );
+			return delta >= 0.0 ? 1.0 : std::exp( delta );
+		}
+
+		void ReplicaExchange::Run( const unsigned int cycles, const unsigned int stepsPerExchange ) {
+			for( unsigned int i = 0; i < cycles; i++ ) {
+				mEnsemble.Step( stepsPerExchange );
+				Exchange();
+			}
+		}
+
+		void ReplicaExchange::Exchange() {
+			std::vector<double> energy( Replicas() );
+			for( unsigned int i = 0; i < Replicas(); i++ ) {
+				energy[i] = mEnsemble.GetContext( i ).getState( State::Energy ).getPotentialEnergy();
+			}
+
+			for( unsigned int i = mCycle % 2; i + 1 < Replicas(); i += 2 ) {
+				const unsigned int a = mReplica[i], b = mReplica[i + 1];
+
+				mAttempts[i]++;
+				const double probability = Probability( mTemperatures[i], energy[a], mTemperatures[i + 1], energy[b] );
+				if( probability >= 1.0 || mRandom.Uniform( Random::Exchange, mCycle, i ) < probability ) {
+					mAcceptances[i]++;
+					Swap( i );
+				}
+			}
+
+			mCycle++;
+		}
+
+		void ReplicaExchange::Swap( const unsigned int index ) {
+			for( unsigned int k = 0; k < 2; k++ ) {
+				const unsigned int replica = mReplica[index + k];
+				const double from = mTemperatures[index + k], to = mTemperatures[index + 1 - k];
+
+				Context &context = mEnsemble.GetContext( replica );
+				std::vector<Vec3> velocities = context.getState( State::Velocities ).getVelocities();
+
+				const double scale = std::sqrt( to / from );
+				for( size_t i = 0; i < velocities.size(); i++ ) {
+					velocities[i] *= scale;
+				}
+
+				context.setVelocities( velocities );
+				mEnsemble.GetIntegrator( replica ).setTemperature( to );
+			}
+
+			std::swap( mReplica[index], mReplica[index + 1] );
+		}
+	}
+}
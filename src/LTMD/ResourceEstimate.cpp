@@ -0,0 +1,198 @@
+#include "LTMD/ResourceEstimate.h"
+#include "LTMD/MappedMatrix.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace OpenMM {
+	namespace LTMD {
+		static std::string Megabytes( const size_t bytes ) {
+			std::ostringstream stream;
+			stream.setf( std::ios::fixed );
+			stream.precision( 1 );
+			stream << bytes / ( 1024.0 * 1024.0 ) << " MiB";
+			return stream.str();
+		}
+
+		static const char *Name( const Preference::ERediagonalization method ) {
+			switch( method ) {
+				case Preference::Full:
+					return "Full";
+				case Preference::Lean:
+					return "Lean";
+				case Preference::OutOfCore:
+					return "OutOfCore";
+				default:
+					return "None";
+			}
+		}
+
+		ResourceEstimate::ResourceEstimate()
+			: Particles( 0 ), Degrees( 0 ), Blocks( 0 ), LargestBlock( 0 ), Vectors( 0 ), Modes( 0 ), FullBytes( 0 ), LeanBytes( 0 ), OutOfCoreBytes( 0 ), AvailableBytes( 0 ),
+			  ScratchBytes( 0 ), ScratchAvailableBytes( 0 ), BlockForceEvaluations( 0 ), ForceEvaluations( 0 ), Method( Preference::Automatic ) {
+
+		}
+
+		size_t ResourceEstimate::AvailableMemory() {
+#ifdef __linux__
+			std::ifstream meminfo( "/proc/meminfo" );
+			std::string key;
+			size_t value = 0;
+			while( meminfo >> key >> value ) {
+				if( key == "MemAvailable:" ) {
+					return value * 1024;
+				}
+				meminfo.ignore( 256, '\n' );
+			}
+#endif
+#if !defined( _WIN32 ) && defined( _SC_PHYS_PAGES )
+			const long pages = sysconf( _SC_PHYS_PAGES ), size = sysconf( _SC_PAGE_SIZE );
+			if( pages > 0 && size > 0 ) {
+				return ( size_t ) pages * ( size_t ) size;
+			}
+#endif
+			return 0;
+		}
+
+		std::vector<size_t> ResourceEstimate::BlockSizes( const size_t particles, const Parameters &params ) {
+			const int residuesPerBlock = std::max( params.res_per_block, 1 );
+
+			std::vector<size_t> starts;
+			size_t start = 0;
+			for( size_t i = 0; i < params.residue_sizes.size(); i++ ) {
+				if( i % residuesPerBlock == 0 ) {
+					starts.push_back( start );
+				}
+				start += params.residue_sizes[i];
+			}
+
+			// The last block runs to the end of the system
+			std::vector<size_t> retVal( starts.size() );
+			for( size_t i = 0; i < starts.size(); i++ ) {
+				const size_t end = ( i + 1 < starts.size() ) ? starts[i + 1] : particles;
+				retVal[i] = 3 * ( end - std::min( starts[i], end ) );
+			}
+
+			return retVal;
+		}
+
+		ResourceEstimate ResourceEstimate::Calculate( const size_t particles, const Parameters &params, const size_t limit ) {
+			ResourceEstimate retVal;
+
+			const std::vector<size_t> blocks = BlockSizes( particles, params );
+
+			retVal.Particles = particles;
+			retVal.Degrees = 3 * particles;
+			retVal.Blocks = blocks.size();
+			retVal.Modes = std::max( params.modes, 0 );
+
+			const double n = retVal.Degrees;
+
+			double blockSquares = 0.0, blockVectors = 0.0;
+			for( size_t i = 0; i < blocks.size(); i++ ) {
+				retVal.LargestBlock = std::max( retVal.LargestBlock, blocks[i] );
+				blockSquares += ( double ) blocks[i] * blocks[i];
+				blockVectors += ( double ) blocks[i] * std::min( blocks[i], ( size_t ) std::max( params.bdof, 0 ) );
+			}
+
+			retVal.Vectors = std::min( retVal.Degrees, ( size_t ) std::max( params.bdof, 0 ) * blocks.size() );
+
+			const double m = retVal.Vectors, modes = retVal.Modes, largest = retVal.LargestBlock;
+
+			unsigned int threads = 1;
+#ifdef _OPENMP
+			threads = omp_get_max_threads();
+#endif
+
+			// Doubles alive at the peak of each method, all need the LAPACK workspace and a few
+			// n vectors of positions and forces
+			const double shared = 26.0 * m + 16.0 * n;
+
+			// Block Hessians are packed triangles
+			const double packedBlocks = 0.5 * blockSquares;
+
+			// Hessian and block eigenvectors, the block copies, E, HE, U, then S with its
+			// packed copy, eigenvectors and sorted copy
+			const double full = 2.0 * n * n + packedBlocks + 3.0 * n * m + 3.5 * m * m + shared;
+
+			// Blocks, per thread block eigensystem work, block columns of E, U and one column
+			// of HE, with S and its eigenvectors either in memory, S packed, or square in
+			// scratch files
+			const double blocked = packedBlocks + 4.0 * threads * largest * largest + blockVectors + n * modes + n + shared;
+			const double packed = 1.5 * m * m;
+			const double square = 2.0 * m * m;
+			const double panels = 2.0 * MappedMatrix::PanelColumns( retVal.Vectors, params.ScratchPanelBytes ) * m;
+
+			retVal.FullBytes = ( size_t )( sizeof( double ) * full );
+			retVal.LeanBytes = ( size_t )( sizeof( double ) * ( blocked + packed ) );
+			retVal.OutOfCoreBytes = ( size_t )( sizeof( double ) * ( blocked + std::min( square, panels ) ) );
+			retVal.AvailableBytes = ( limit != 0 ) ? limit : AvailableMemory();
+
+			retVal.ScratchBytes = ( size_t )( sizeof( double ) * square );
+			retVal.ScratchAvailableBytes = MappedMatrix::ScratchAvailable( params.ScratchDirectory );
+
+#ifdef FIRST_ORDER
+			retVal.BlockForceEvaluations = retVal.LargestBlock + 1;
+			retVal.ForceEvaluations = retVal.Vectors + 1;
+#else
+			retVal.BlockForceEvaluations = 2 * retVal.LargestBlock;
+			retVal.ForceEvaluations = 2 * retVal.Vectors;
+#endif
+
+			return retVal;
+		}
+
+		bool ResourceEstimate::Select( const Preference::ERediagonalization preference ) {
+			const bool fullFits = ( AvailableBytes == 0 || FullBytes <= AvailableBytes );
+			const bool leanFits = ( AvailableBytes == 0 || LeanBytes <= AvailableBytes );
+			const bool outOfCoreFits = ( AvailableBytes == 0 || OutOfCoreBytes <= AvailableBytes ) &&
+									   ( ScratchAvailableBytes == 0 || ScratchBytes <= ScratchAvailableBytes );
+
+			switch( preference ) {
+				case Preference::Full:
+					Method = Preference::Full;
+					return fullFits;
+				case Preference::Lean:
+					Method = Preference::Lean;
+					return leanFits;
+				case Preference::OutOfCore:
+					Method = Preference::OutOfCore;
+					return outOfCoreFits;
+				default:
+					if( fullFits ) {
+						Method = Preference::Full;
+					} else if( leanFits ) {
+						Method = Preference::Lean;
+					} else if( outOfCoreFits ) {
+						Method = Preference::OutOfCore;
+					} else {
+						Method = Preference::Automatic;
+					}
+					return Method != Preference::Automatic;
+			}
+		}
+
+		std::string ResourceEstimate::Report() const {
+			std::ostringstream stream;
+			stream << "LTMD rediagonalization of " << Particles << " particles, " << Blocks << " blocks (largest " << LargestBlock
+				   << " degrees of freedom), " << Vectors << " block vectors, " << Modes << " modes\n";
+			stream << "  Full: " << Megabytes( FullBytes ) << "\n";
+			stream << "  Lean: " << Megabytes( LeanBytes ) << "\n";
+			stream << "  OutOfCore: " << Megabytes( OutOfCoreBytes ) << " plus " << Megabytes( ScratchBytes ) << " scratch ("
+				   << ( ScratchAvailableBytes != 0 ? Megabytes( ScratchAvailableBytes ) : std::string( "unknown" ) ) << " free)\n";
+			stream << "  Available: " << ( AvailableBytes != 0 ? Megabytes( AvailableBytes ) : std::string( "unknown" ) ) << "\n";
+			stream << "  Force evaluations: " << BlockForceEvaluations << " block system, " << ForceEvaluations << " full system\n";
+			stream << "  Method: " << Name( Method ) << "\n";
+			return stream.str();
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#include "LTMD/StepLengthController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace OpenMM {
+	namespace LTMD {
+		// Weight of a new quadratic lambda against the running estimate
+		static const double ObserveWeight = 0.5;
+
+		// Curvature scale applied after an accepted linear step, lengthening the next step
+		static const double AcceptRelaxation = 0.9;
+
+		StepLengthController::StepLengthController() : mCurvature( 1.0 ), mMinimum( 0.0 ), mMaximum( HUGE_VAL ) {
+
+		}
+
+		void StepLengthController::Reset( const double curvature, const double minimum, const double maximum ) {
+			mCurvature = curvature;
+			mMinimum = minimum;
+			mMaximum = maximum;
+			Clamp();
+		}
+
+		void StepLengthController::Observe( const double lambda ) {
+			if( !( lambda > 0.0 ) || !std::isfinite( lambda ) ) {
+				return;
+			}
+
+			mCurvature *= std::pow( 1.0 / ( lambda * mCurvature ), ObserveWeight );
+			Clamp();
+		}
+
+		void StepLengthController::Accept() {
+			mCurvature *= AcceptRelaxation;
+			Clamp();
+		}
+
+		void StepLengthController::Reject() {
+			mCurvature *= 2.0;
+			Clamp();
+		}
+
+		void StepLengthController::Clamp() {
+			mCurvature = std::min( std::max( mCurvature, mMinimum ), mMaximum );
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#include "LTMD/SyntheticSystem.h"
+
+#include <cmath>
+#include <utility>
+
+#include "openmm/OpenMMException.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		// Residue sizes cycled along the chain, spanning glycine to tryptophan with hydrogens
+		// folded into their heavy atoms
+		const unsigned int ResidueSequence[] = { 10, 14, 17, 12, 20, 7, 24, 16 };
+		const unsigned int ResidueSequenceLength = sizeof( ResidueSequence ) / sizeof( ResidueSequence[0] );
+
+		// Backbone N, CA, C, O followed by CH2 side chain groups
+		const double BackboneMass[] = { 14.007, 12.011, 12.011, 15.999 };
+		const double SideChainMass = 14.027;
+
+		// Helix of 3.6 atoms per turn with a 0.1 nm rise per atom and 0.153 nm bonds
+		const double BondLength = 0.153, HelixRise = 0.1, HelixTurn = 1.7453292519943295;
+
+		const double BondK = 259408.0, AngleK = 527.0, TorsionK = 0.6;
+		const int TorsionPeriodicity = 3;
+		const double Charge = 0.3, Sigma = 0.32, Epsilon = 0.4, Cutoff = 1.2;
+		const double Coulomb14Scale = 0.8333, LennardJones14Scale = 0.5;
+
+		static double Length( const Vec3 &v ) {
+			return std::sqrt( v.dot( v ) );
+		}
+
+		SyntheticSystem::SyntheticSystem( const unsigned int atoms ) {
+			if( atoms == 0 ) {
+				throw OpenMMException( "SyntheticSystem requires at least one atom" );
+			}
+
+			// Whole residues from the sequence, the remainder joins the last one
+			unsigned int remaining = atoms;
+			for( unsigned int i = 0; remaining >= ResidueSequence[i % ResidueSequenceLength]; i++ ) {
+				mResidueSizes.push_back( ResidueSequence[i % ResidueSequenceLength] );
+				remaining -= ResidueSequence[i % ResidueSequenceLength];
+			}
+
+			if( mResidueSizes.empty() ) {
+				mResidueSizes.push_back( remaining );
+			} else {
+				mResidueSizes.back() += remaining;
+			}
+
+			// Alternating charges keep each residue neutral, an odd atom out is left uncharged
+			for( size_t r = 0; r < mResidueSizes.size(); r++ ) {
+				const unsigned int size = mResidueSizes[r];
+				for( unsigned int i = 0; i < size; i++ ) {
+					mMasses.push_back( i < 4 ? BackboneMass[i] : SideChainMass );
+					mCharges.push_back( ( size % 2 == 1 && i == size - 1 ) ? 0.0 : ( i % 2 == 0 ? -Charge : Charge ) );
+				}
+			}
+
+			const double radius = std::sqrt( ( BondLength * BondLength - HelixRise * HelixRise ) / ( 2.0 * ( 1.0 - std::cos( HelixTurn ) ) ) );
+
+			mPositions.resize( atoms );
+			for( unsigned int i = 0; i < atoms; i++ ) {
+				mPositions[i] = Vec3( radius * std::cos( HelixTurn * i ), radius * std::sin( HelixTurn * i ), HelixRise * i );
+			}
+		}
+
+		System *SyntheticSystem::CreateSystem() const {
+			System *system = new System();
+			for( size_t i = 0; i < mMasses.size(); i++ ) {
+				system->addParticle( mMasses[i] );
+			}
+
+			const int atoms = mPositions.size();
+
+			// Bonds and angles take their lengths from the helix so it starts at their minimum
+			HarmonicBondForce *bonds = new HarmonicBondForce();
+			std::vector<std::pair<int, int> > pairs;
+			for( int i = 1; i < atoms; i++ ) {
+				bonds->addBond( i - 1, i, Length( mPositions[i] - mPositions[i - 1] ), BondK );
+				pairs.push_back( std::make_pair( i - 1, i ) );
+			}
+
+			HarmonicAngleForce *angles = new HarmonicAngleForce();
+			for( int i = 2; i < atoms; i++ ) {
+				const Vec3 a = mPositions[i - 2] - mPositions[i - 1], b = mPositions[i] - mPositions[i - 1];
+				angles->addAngle( i - 2, i - 1, i, std::acos( a.dot( b ) / ( Length( a ) * Length( b ) ) ), AngleK );
+			}
+
+			PeriodicTorsionForce *torsions = new PeriodicTorsionForce();
+			for( int i = 3; i < atoms; i++ ) {
+				torsions->addTorsion( i - 3, i - 2, i - 1, i, TorsionPeriodicity, 0.0, TorsionK );
+			}
+
+			NonbondedForce *nonbonded = new NonbondedForce();
+			nonbonded->setNonbondedMethod( NonbondedForce::CutoffNonPeriodic );
+			nonbonded->setCutoffDistance( Cutoff );
+			for( int i = 0; i < atoms; i++ ) {
+				nonbonded->addParticle( mCharges[i], Sigma, Epsilon );
+			}
+			nonbonded->createExceptionsFromBonds( pairs, Coulomb14Scale, LennardJones14Scale );
+
+			bonds->setForceGroup( BondedGroup );
+			angles->setForceGroup( BondedGroup );
+			torsions->setForceGroup( BondedGroup );
+			nonbonded->setForceGroup( NonbondedGroup );
+
+			system->addForce( bonds );
+			system->addForce( angles );
+			system->addForce( torsions );
+			system->addForce( nonbonded );
+
+			return system;
+		}
+
+		void SyntheticSystem::Configure( Parameters &params ) const {
+			params.residue_sizes = mResidueSizes;
+
+			params.forces.clear();
+			params.forces.push_back( LTMD::Force( "Bond", Bond ) );
+			params.forces.push_back( LTMD::Force( "Angle", Angle ) );
+			params.forces.push_back( LTMD::Force( "Dihedral", Dihedral ) );
+			params.forces.push_back( LTMD::Force( "Nonbonded", Nonbonded ) );
+		}
+
+		void SyntheticSystem::Configure( Parameters &params, const int residuesPerBlock, const int blockDegrees, const int modes ) const {
+			Configure( params );
+			params.res_per_block = residuesPerBlock;
+			params.bdof = blockDegrees;
+			params.modes = modes;
+			params.BlockDiagonalizePlatform = Preference::Reference;
+		}
+	}
+}
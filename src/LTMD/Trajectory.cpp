@@ -0,0 +1,423 @@
+#include "LTMD/Trajectory.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "openmm/OpenMMException.h"
+
+namespace OpenMM {
+	namespace LTMD {
+		const char TrajectoryMagic[8] = { 'L', 'T', 'M', 'D', 'T', 'R', 'J', '2' };
+		const char BasisTag = 'B', KeyframeTag = 'K', FrameTag = 'F';
+
+		// Encoding
+		static void PutVarint( std::vector<unsigned char> &out, uint64_t value ) {
+			while( value >= 0x80 ) {
+				out.push_back( ( unsigned char )( value | 0x80 ) );
+				value >>= 7;
+			}
+			out.push_back( ( unsigned char ) value );
+		}
+
+		static uint64_t ZigZag( const int64_t value ) {
+			return ( ( uint64_t ) value << 1 ) ^ ( uint64_t )( value >> 63 );
+		}
+
+		static int64_t UnZigZag( const uint64_t value ) {
+			return ( int64_t )( value >> 1 ) ^ -( int64_t )( value & 1 );
+		}
+
+		static void PutSigned( std::vector<unsigned char> &out, const int64_t value ) {
+			PutVarint( out, ZigZag( value ) );
+		}
+
+		// Appends the count low bits of value, least significant first, used bits of the last
+		// byte are already taken
+		static void PutBits( std::vector<unsigned char> &out, unsigned int &used, const uint64_t value, const unsigned int count ) {
+			for( unsigned int i = 0; i < count; i++ ) {
+				if( used == 0 ) {
+					out.push_back( 0 );
+				}
+				out.back() |= ( unsigned char )( ( ( value >> i ) & 1 ) << used );
+				used = ( used + 1 ) % 8;
+			}
+		}
+
+		// Rice code of the zigzagged values: the quotient by 2^k in unary followed by the k low
+		// bits, packed least significant bit first. k is chosen per call to minimize the size
+		// and written first. Residuals that are mostly zero cost little over a bit each.
+		static void PutRice( std::vector<unsigned char> &out, const std::vector<int64_t> &values ) {
+			std::vector<uint64_t> zigzag( values.size() );
+			for( size_t i = 0; i < values.size(); i++ ) {
+				zigzag[i] = ZigZag( values[i] );
+			}
+
+			unsigned int k = 0;
+			uint64_t bits = ~( uint64_t ) 0;
+			for( unsigned int trial = 0; trial < 64; trial++ ) {
+				uint64_t total = 0;
+				for( size_t i = 0; i < zigzag.size() && total < bits; i++ ) {
+					total += ( zigzag[i] >> trial ) + 1 + trial;
+				}
+				if( total >= bits ) {
+					break;
+				}
+				bits = total;
+				k = trial;
+			}
+
+			out.push_back( ( unsigned char ) k );
+
+			unsigned int used = 0;
+			for( size_t i = 0; i < zigzag.size(); i++ ) {
+				for( uint64_t q = zigzag[i] >> k; q > 0; q-- ) {
+					PutBits( out, used, 1, 1 );
+				}
+				PutBits( out, used, 0, 1 );
+				PutBits( out, used, zigzag[i], k );
+			}
+		}
+
+		template<typename T>
+		static void PutRaw( std::vector<unsigned char> &out, const T &value ) {
+			const unsigned char *bytes = reinterpret_cast<const unsigned char *>( &value );
+			out.insert( out.end(), bytes, bytes + sizeof( T ) );
+		}
+
+		// Decoding
+		class Cursor {
+			public:
+				Cursor( const std::vector<unsigned char> &data ) : mPosition( 0 ), mBit( 0 ), mByte( 0 ), mData( data ) {}
+
+				uint64_t Varint() {
+					uint64_t value = 0;
+					for( unsigned int shift = 0; shift < 64; shift += 7 ) {
+						const unsigned char byte = Byte();
+						value |= ( uint64_t )( byte & 0x7F ) << shift;
+						if( ( byte & 0x80 ) == 0 ) {
+							return value;
+						}
+					}
+					throw OpenMMException( "Corrupt trajectory varint" );
+				}
+
+				int64_t Signed() {
+					return UnZigZag( Varint() );
+				}
+
+				// count values written by PutRice, the record must end with them
+				void Rice( const size_t count, std::vector<int64_t> &values ) {
+					const unsigned int k = Byte();
+					if( k >= 64 ) {
+						throw OpenMMException( "Corrupt trajectory residuals" );
+					}
+
+					values.resize( count );
+					for( size_t i = 0; i < count; i++ ) {
+						uint64_t quotient = 0;
+						while( Bit() ) {
+							quotient++;
+						}
+
+						uint64_t remainder = 0;
+						for( unsigned int b = 0; b < k; b++ ) {
+							remainder |= ( uint64_t ) Bit() << b;
+						}
+						values[i] = UnZigZag( ( quotient << k ) | remainder );
+					}
+				}
+
+				template<typename T>
+				T Raw() {
+					if( mPosition + sizeof( T ) > mData.size() ) {
+						throw OpenMMException( "Truncated trajectory record" );
+					}
+
+					T value;
+					std::memcpy( &value, &mData[mPosition], sizeof( T ) );
+					mPosition += sizeof( T );
+					return value;
+				}
+			private:
+				unsigned char Byte() {
+					if( mPosition >= mData.size() ) {
+						throw OpenMMException( "Truncated trajectory record" );
+					}
+					return mData[mPosition++];
+				}
+
+				unsigned int Bit() {
+					if( mBit == 0 ) {
+						mByte = Byte();
+					}
+
+					const unsigned int bit = ( mByte >> mBit ) & 1;
+					mBit = ( mBit + 1 ) % 8;
+					return bit;
+				}
+			private:
+				size_t mPosition;
+				unsigned int mBit;
+				unsigned char mByte;
+				const std::vector<unsigned char> &mData;
+		};
+
+		static int64_t Quantize( const double value, const double precision ) {
+			return ( int64_t ) std::floor( value / precision + 0.5 );
+		}
+
+		// previous + W^-1 Q amplitudes, shared by writer and reader so both predict the same value
+		static void Predict( const std::vector<float> &basis, const unsigned int modes, const std::vector<double> &inverseRootMass, const std::vector<double> &previous, const std::vector<float> &amplitudes, std::vector<double> &out ) {
+			const size_t degrees = previous.size();
+			for( size_t j = 0; j < degrees; j++ ) {
+				double sum = 0.0;
+				for( unsigned int k = 0; k < modes; k++ ) {
+					sum += ( double ) basis[k * degrees + j] * ( double ) amplitudes[k];
+				}
+				out[j] = previous[j] + inverseRootMass[j / 3] * sum;
+			}
+		}
+
+		TrajectoryWriter::TrajectoryWriter( const std::string &filename, const std::vector<double> &masses, const double precision, const unsigned int keyframeInterval )
+			: mFile( filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc ), mPrecision( precision ), mKeyframeInterval( keyframeInterval ),
+			  mFrames( 0 ), mSinceKeyframe( 0 ), mBytes( 0 ), mVersion( 0 ), mModes( 0 ), mInverseRootMass( masses.size() ), mPrevious( 3 * masses.size() ) {
+			if( !mFile ) {
+				throw OpenMMException( "Unable to open trajectory " + filename );
+			}
+			if( precision <= 0.0 ) {
+				throw OpenMMException( "Trajectory precision must be positive" );
+			}
+
+			std::vector<unsigned char> header( TrajectoryMagic, TrajectoryMagic + sizeof( TrajectoryMagic ) );
+			PutRaw( header, ( uint32_t ) masses.size() );
+			PutRaw( header, precision );
+			for( size_t i = 0; i < masses.size(); i++ ) {
+				PutRaw( header, masses[i] );
+				mInverseRootMass[i] = 1.0 / std::sqrt( masses[i] );
+			}
+
+			mFile.write( reinterpret_cast<const char *>( &header[0] ), header.size() );
+			mBytes += header.size();
+		}
+
+		TrajectoryWriter::~TrajectoryWriter() {
+			Close();
+		}
+
+		void TrajectoryWriter::Close() {
+			if( mFile.is_open() ) {
+				mFile.close();
+			}
+		}
+
+		void TrajectoryWriter::WriteRecord( const char tag, const std::vector<unsigned char> &payload ) {
+			std::vector<unsigned char> header( 1, ( unsigned char ) tag );
+			PutVarint( header, payload.size() );
+
+			mFile.write( reinterpret_cast<const char *>( &header[0] ), header.size() );
+			if( !payload.empty() ) {
+				mFile.write( reinterpret_cast<const char *>( &payload[0] ), payload.size() );
+			}
+
+			if( !mFile ) {
+				throw OpenMMException( "Unable to write trajectory record" );
+			}
+			mBytes += header.size() + payload.size();
+		}
+
+		void TrajectoryWriter::WriteFrame( const double time, const std::vector<Vec3> &positions, const ModeBasisPtr &basis ) {
+			if( positions.size() != mInverseRootMass.size() ) {
+				throw OpenMMException( "Trajectory frame has the wrong number of particles" );
+			}
+
+			const uint64_t version = basis ? basis->Version() : 0;
+			const bool changed = ( mFrames == 0 || version != mVersion );
+			if( changed ) {
+				WriteBasis( basis );
+				mVersion = version;
+			}
+
+			if( changed || mSinceKeyframe >= mKeyframeInterval ) {
+				WriteKeyframe( time, positions );
+				mSinceKeyframe = 0;
+			} else {
+				WriteDelta( time, positions );
+			}
+
+			mSinceKeyframe++;
+			mFrames++;
+		}
+
+		void TrajectoryWriter::WriteBasis( const ModeBasisPtr &basis ) {
+			mModes = basis ? basis->Modes() : 0;
+			if( basis && basis->Particles() != mInverseRootMass.size() ) {
+				throw OpenMMException( "Trajectory basis has the wrong number of particles" );
+			}
+
+			const size_t degrees = mPrevious.size();
+			mBasis.resize( mModes * degrees );
+			for( unsigned int k = 0; k < mModes; k++ ) {
+				const double *mode = basis->Mode( k );
+				for( size_t j = 0; j < degrees; j++ ) {
+					mBasis[k * degrees + j] = ( float ) mode[j];
+				}
+			}
+
+			std::vector<unsigned char> payload;
+			PutRaw( payload, ( uint32_t ) mModes );
+			for( size_t i = 0; i < mBasis.size(); i++ ) {
+				PutRaw( payload, mBasis[i] );
+			}
+			WriteRecord( BasisTag, payload );
+		}
+
+		void TrajectoryWriter::WriteKeyframe( const double time, const std::vector<Vec3> &positions ) {
+			std::vector<unsigned char> payload;
+			PutRaw( payload, time );
+
+			for( size_t j = 0; j < mPrevious.size(); j++ ) {
+				const int64_t value = Quantize( positions[j / 3][j % 3], mPrecision );
+				PutSigned( payload, value );
+				mPrevious[j] = value * mPrecision;
+			}
+
+			WriteRecord( KeyframeTag, payload );
+		}
+
+		void TrajectoryWriter::WriteDelta( const double time, const std::vector<Vec3> &positions ) {
+			const size_t degrees = mPrevious.size();
+
+			// Mass weighted amplitudes of the displacement from the previous frame
+			std::vector<float> amplitudes( mModes );
+			for( unsigned int k = 0; k < mModes; k++ ) {
+				double sum = 0.0;
+				for( size_t j = 0; j < degrees; j++ ) {
+					sum += mBasis[k * degrees + j] * ( positions[j / 3][j % 3] - mPrevious[j] ) / mInverseRootMass[j / 3];
+				}
+				amplitudes[k] = ( float ) sum;
+			}
+
+			std::vector<double> predicted( degrees );
+			Predict( mBasis, mModes, mInverseRootMass, mPrevious, amplitudes, predicted );
+
+			std::vector<unsigned char> payload;
+			PutRaw( payload, time );
+			for( unsigned int k = 0; k < mModes; k++ ) {
+				PutRaw( payload, amplitudes[k] );
+			}
+
+			std::vector<int64_t> residual( degrees );
+			for( size_t j = 0; j < degrees; j++ ) {
+				residual[j] = Quantize( positions[j / 3][j % 3] - predicted[j], mPrecision );
+				mPrevious[j] = predicted[j] + residual[j] * mPrecision;
+			}
+			PutRice( payload, residual );
+
+			WriteRecord( FrameTag, payload );
+		}
+
+		TrajectoryReader::TrajectoryReader( const std::string &filename )
+			: mFile( filename.c_str(), std::ios::in | std::ios::binary ), mPrecision( 0.0 ), mModes( 0 ), mHasFrame( false ) {
+			if( !mFile ) {
+				throw OpenMMException( "Unable to open trajectory " + filename );
+			}
+
+			char magic[sizeof( TrajectoryMagic )];
+			uint32_t particles = 0;
+			mFile.read( magic, sizeof( magic ) );
+			mFile.read( reinterpret_cast<char *>( &particles ), sizeof( particles ) );
+			mFile.read( reinterpret_cast<char *>( &mPrecision ), sizeof( mPrecision ) );
+			if( !mFile || std::memcmp( magic, TrajectoryMagic, sizeof( magic ) ) != 0 ) {
+				throw OpenMMException( "Not an LTMD trajectory: " + filename );
+			}
+
+			mInverseRootMass.resize( particles );
+			for( uint32_t i = 0; i < particles; i++ ) {
+				double mass = 0.0;
+				mFile.read( reinterpret_cast<char *>( &mass ), sizeof( mass ) );
+				mInverseRootMass[i] = 1.0 / std::sqrt( mass );
+			}
+			if( !mFile ) {
+				throw OpenMMException( "Truncated trajectory header" );
+			}
+
+			mPrevious.resize( 3 * particles );
+		}
+
+		bool TrajectoryReader::ReadFrame( double &time, std::vector<Vec3> &positions ) {
+			const size_t degrees = mPrevious.size();
+
+			while( true ) {
+				char tag = 0;
+				if( !mFile.get( tag ) ) {
+					return false;
+				}
+
+				uint64_t length = 0;
+				for( unsigned int shift = 0; shift < 64; shift += 7 ) {
+					char byte = 0;
+					if( !mFile.get( byte ) ) {
+						throw OpenMMException( "Truncated trajectory record" );
+					}
+
+					length |= ( uint64_t )( ( unsigned char ) byte & 0x7F ) << shift;
+					if( ( ( unsigned char ) byte & 0x80 ) == 0 ) {
+						break;
+					}
+				}
+
+				std::vector<unsigned char> payload( length );
+				if( length != 0 ) {
+					mFile.read( reinterpret_cast<char *>( &payload[0] ), length );
+				}
+				if( !mFile ) {
+					throw OpenMMException( "Truncated trajectory record" );
+				}
+
+				Cursor cursor( payload );
+				if( tag == BasisTag ) {
+					mModes = cursor.Raw<uint32_t>();
+					mBasis.resize( mModes * degrees );
+					for( size_t i = 0; i < mBasis.size(); i++ ) {
+						mBasis[i] = cursor.Raw<float>();
+					}
+					continue;
+				}
+
+				time = cursor.Raw<double>();
+				if( tag == KeyframeTag ) {
+					for( size_t j = 0; j < degrees; j++ ) {
+						mPrevious[j] = cursor.Signed() * mPrecision;
+					}
+					mHasFrame = true;
+				} else if( tag == FrameTag ) {
+					if( !mHasFrame ) {
+						throw OpenMMException( "Trajectory frame before the first keyframe" );
+					}
+
+					std::vector<float> amplitudes( mModes );
+					for( unsigned int k = 0; k < mModes; k++ ) {
+						amplitudes[k] = cursor.Raw<float>();
+					}
+
+					std::vector<double> predicted( degrees );
+					Predict( mBasis, mModes, mInverseRootMass, mPrevious, amplitudes, predicted );
+
+					std::vector<int64_t> residual;
+					cursor.Rice( degrees, residual );
+					for( size_t j = 0; j < degrees; j++ ) {
+						mPrevious[j] = predicted[j] + residual[j] * mPrecision;
+					}
+				} else {
+					throw OpenMMException( "Unknown trajectory record" );
+				}
+
+				positions.resize( degrees / 3 );
+				for( size_t i = 0; i < positions.size(); i++ ) {
+					positions[i] = Vec3( mPrevious[3 * i], mPrevious[3 * i + 1], mPrevious[3 * i + 2] );
+				}
+				return true;
+			}
+		}
+	}
+}
@@ -10,10 +10,18 @@ namespace LTMD {
 				CPPUNIT_TEST_SUITE( Test );
 				CPPUNIT_TEST( BlockDiagonalize );
 				CPPUNIT_TEST( GeometricDOF );
+				CPPUNIT_TEST( Shards );
+				CPPUNIT_TEST( LeanMatchesFull );
+				CPPUNIT_TEST( ShardsMatchSerial );
+				CPPUNIT_TEST( OutOfCoreMatchesFull );
 				CPPUNIT_TEST_SUITE_END();
 			public:
 				void BlockDiagonalize();
 				void GeometricDOF();
+				void Shards();
+				void LeanMatchesFull();
+				void ShardsMatchSerial();
+				void OutOfCoreMatchesFull();
 		};
 	}
 }
@@ -0,0 +1,21 @@
+#ifndef OPENMM_LTMD_ARENATEST_H_
+#define OPENMM_LTMD_ARENATEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Arena {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( ReuseTest );
+				CPPUNIT_TEST( TrimTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void ReuseTest();
+				void TrimTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_ARENATEST_H_
@@ -0,0 +1,19 @@
+#ifndef OPENMM_LTMD_BENCHMARKTEST_H_
+#define OPENMM_LTMD_BENCHMARKTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Benchmark {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( WarmUpTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void WarmUpTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_BENCHMARKTEST_H_
@@ -0,0 +1,23 @@
+#ifndef OPENMM_LTMD_CPUTEST_H_
+#define OPENMM_LTMD_CPUTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace CPU {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( IntegrateTest );
+				CPPUNIT_TEST( LinearMinimizeTest );
+				CPPUNIT_TEST( QuadraticMinimizeTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void IntegrateTest();
+				void LinearMinimizeTest();
+				void QuadraticMinimizeTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_CPUTEST_H_
@@ -0,0 +1,23 @@
+#ifndef OPENMM_LTMD_ENSEMBLETEST_H_
+#define OPENMM_LTMD_ENSEMBLETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Ensemble {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( ShareBasisTest );
+				CPPUNIT_TEST( StepTest );
+				CPPUNIT_TEST( BatchTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void ShareBasisTest();
+				void StepTest();
+				void BatchTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_ENSEMBLETEST_H_
@@ -0,0 +1,21 @@
+#ifndef OPENMM_LTMD_INTEGRATORTEST_H_
+#define OPENMM_LTMD_INTEGRATORTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Integrator {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( EnergyOnlyTrialsTest );
+				CPPUNIT_TEST( SplitMinimizationTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void EnergyOnlyTrialsTest();
+				void SplitMinimizationTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_INTEGRATORTEST_H_
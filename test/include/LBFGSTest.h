@@ -0,0 +1,25 @@
+#ifndef OPENMM_LTMD_LBFGSTEST_H_
+#define OPENMM_LTMD_LBFGSTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace LBFGS {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( InitialScaleTest );
+				CPPUNIT_TEST( SecantTest );
+				CPPUNIT_TEST( QuadraticTest );
+				CPPUNIT_TEST( PreconditionerTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void InitialScaleTest();
+				void SecantTest();
+				void QuadraticTest();
+				void PreconditionerTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_LBFGSTEST_H_
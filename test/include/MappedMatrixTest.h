@@ -0,0 +1,25 @@
+#ifndef OPENMM_LTMD_MAPPEDMATRIXTEST_H_
+#define OPENMM_LTMD_MAPPEDMATRIXTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace MappedMatrix {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( RoundTripTest );
+				CPPUNIT_TEST( ColumnTest );
+				CPPUNIT_TEST( PanelColumnsTest );
+				CPPUNIT_TEST( MissingDirectoryTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void RoundTripTest();
+				void ColumnTest();
+				void PanelColumnsTest();
+				void MissingDirectoryTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_MAPPEDMATRIXTEST_H_
@@ -10,18 +10,24 @@ namespace LTMD {
 				CPPUNIT_TEST_SUITE( Test );
 				CPPUNIT_TEST( EigenvalueTest );
 				CPPUNIT_TEST( EigenvectorTest );
+				CPPUNIT_TEST( PackedEigenvalueTest );
 				CPPUNIT_TEST( MatrixMultiplyTest );
 				CPPUNIT_TEST( TransposeMatrixMultiplyTest );
 				CPPUNIT_TEST( TransposeAMatrixMultiplyTest );
 				CPPUNIT_TEST( TransposeBMatrixMultiplyTest );
+				CPPUNIT_TEST( ViewMatrixMultiplyTest );
+				CPPUNIT_TEST( TiledRoutinesTest );
 				CPPUNIT_TEST_SUITE_END();
 			public:
 				void EigenvalueTest();
 				void EigenvectorTest();
+				void PackedEigenvalueTest();
 				void MatrixMultiplyTest();
 				void TransposeMatrixMultiplyTest();
 				void TransposeAMatrixMultiplyTest();
 				void TransposeBMatrixMultiplyTest();
+				void ViewMatrixMultiplyTest();
+				void TiledRoutinesTest();
 		};
 	}
 }
@@ -0,0 +1,103 @@
+#ifndef OPENMM_LTMD_PLUGINS_H_
+#define OPENMM_LTMD_PLUGINS_H_
+
+#include "OpenMM.h"
+#include "openmm/Kernel.h"
+#include "openmm/internal/ContextImpl.h"
+#include "LTMD/Integrator.h"
+#include "LTMD/StepKernel.h"
+#include "LTMD/Reference/KernelFactory.h"
+
+#ifdef BUILD_CPU
+#include "LTMD/CPU/KernelFactory.h"
+#endif
+
+namespace LTMD {
+	/**
+	 * Register the LTMD kernels of the Reference plugin, which the tests link directly
+	 * rather than load from the plugin directory.
+	 */
+	inline void RegisterReferencePlugin() {
+		static bool registered = false;
+		if( !registered ) {
+			OpenMM::Platform::getPlatformByName( "Reference" ).registerKernelFactory( OpenMM::LTMD::StepKernel::Name(), new OpenMM::LTMD::Reference::KernelFactory() );
+			registered = true;
+		}
+	}
+
+#ifdef BUILD_CPU
+	/**
+	 * Register the LTMD kernels of the CPU plugin, after loading the OpenMM CPU platform,
+	 * itself a plugin, if nothing else has.
+	 */
+	inline void RegisterCPUPlugin() {
+		RegisterReferencePlugin();
+
+		static bool registered = false;
+		if( !registered ) {
+			bool found = false;
+			for( int i = 0; i < OpenMM::Platform::getNumPlatforms(); i++ ) {
+				found = found || OpenMM::Platform::getPlatform( i ).getName() == "CPU";
+			}
+			if( !found ) {
+				OpenMM::Platform::loadPluginsFromDirectory( OpenMM::Platform::getDefaultPluginsDirectory() );
+			}
+
+			OpenMM::Platform::getPlatformByName( "CPU" ).registerKernelFactory( OpenMM::LTMD::StepKernel::Name(), new OpenMM::LTMD::CPU::KernelFactory() );
+			registered = true;
+		}
+	}
+#endif
+
+	/**
+	 * Integrator giving direct access to the LTMD step kernel of the platform it is used
+	 * with, so tests can call each kernel operation on a known state. The kernel reads its
+	 * parameters, step size and modes from integrator, which is not itself attached to a
+	 * context.
+	 */
+	class StepKernelHarness : public OpenMM::Integrator {
+		public:
+			StepKernelHarness( const OpenMM::LTMD::Integrator &integrator ) : mIntegrator( integrator ), mContext( NULL ) {
+				setStepSize( integrator.getStepSize() );
+			}
+
+			OpenMM::LTMD::StepKernel &Kernel() {
+				return mKernel.getAs<OpenMM::LTMD::StepKernel>();
+			}
+
+			OpenMM::ContextImpl &Context() {
+				return *mContext;
+			}
+
+			/**
+			 * Evaluate the forces the kernel reads, returning the energy.
+			 */
+			double Forces() {
+				return mContext->calcForcesAndEnergy( true, true );
+			}
+
+			void step( int ) {
+
+			}
+		protected:
+			void initialize( OpenMM::ContextImpl &context ) {
+				mContext = &context;
+				mKernel = context.getPlatform().createKernel( OpenMM::LTMD::StepKernel::Name(), context );
+				Kernel().initialize( context.getSystem(), mIntegrator );
+			}
+
+			std::vector<std::string> getKernelNames() {
+				return std::vector<std::string>( 1, OpenMM::LTMD::StepKernel::Name() );
+			}
+
+			double computeKineticEnergy() {
+				return Kernel().computeKineticEnergy( *mContext, mIntegrator );
+			}
+		private:
+			const OpenMM::LTMD::Integrator &mIntegrator;
+			OpenMM::ContextImpl *mContext;
+			OpenMM::Kernel mKernel;
+	};
+}
+
+#endif // OPENMM_LTMD_PLUGINS_H_
@@ -0,0 +1,27 @@
+#ifndef OPENMM_LTMD_PROFILERTEST_H_
+#define OPENMM_LTMD_PROFILERTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Profiler {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( DisabledTest );
+				CPPUNIT_TEST( ScopeTest );
+				CPPUNIT_TEST( CountTest );
+				CPPUNIT_TEST( JSONTest );
+				CPPUNIT_TEST( ChromeTraceTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void DisabledTest();
+				void ScopeTest();
+				void CountTest();
+				void JSONTest();
+				void ChromeTraceTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_PROFILERTEST_H_
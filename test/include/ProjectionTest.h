@@ -0,0 +1,33 @@
+#ifndef OPENMM_LTMD_PROJECTIONTEST_H_
+#define OPENMM_LTMD_PROJECTIONTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Projection {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( SubspaceTest );
+				CPPUNIT_TEST( ComplimentTest );
+				CPPUNIT_TEST( InPlaceTest );
+				CPPUNIT_TEST( ModeCountTest );
+				CPPUNIT_TEST( SinglePrecisionTest );
+				CPPUNIT_TEST( BasisVersionTest );
+				CPPUNIT_TEST( BatchTest );
+				CPPUNIT_TEST( SharedBatchTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void SubspaceTest();
+				void ComplimentTest();
+				void InPlaceTest();
+				void ModeCountTest();
+				void SinglePrecisionTest();
+				void BasisVersionTest();
+				void BatchTest();
+				void SharedBatchTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_PROJECTIONTEST_H_
@@ -0,0 +1,25 @@
+#ifndef OPENMM_LTMD_RANDOMTEST_H_
+#define OPENMM_LTMD_RANDOMTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Random {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( PhiloxKnownAnswerTest );
+				CPPUNIT_TEST( ReproducibleTest );
+				CPPUNIT_TEST( DistributionTest );
+				CPPUNIT_TEST( PrefillTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void PhiloxKnownAnswerTest();
+				void ReproducibleTest();
+				void DistributionTest();
+				void PrefillTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_RANDOMTEST_H_
@@ -0,0 +1,21 @@
+#ifndef OPENMM_LTMD_REPLICAEXCHANGETEST_H_
+#define OPENMM_LTMD_REPLICAEXCHANGETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace ReplicaExchange {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( ProbabilityTest );
+				CPPUNIT_TEST( SwapTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void ProbabilityTest();
+				void SwapTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_REPLICAEXCHANGETEST_H_
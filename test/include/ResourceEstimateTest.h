@@ -0,0 +1,21 @@
+#ifndef OPENMM_LTMD_RESOURCEESTIMATETEST_H_
+#define OPENMM_LTMD_RESOURCEESTIMATETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace ResourceEstimate {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( BlockSizesTest );
+				CPPUNIT_TEST( SelectTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void BlockSizesTest();
+				void SelectTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_RESOURCEESTIMATETEST_H_
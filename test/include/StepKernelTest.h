@@ -0,0 +1,27 @@
+#ifndef OPENMM_LTMD_STEPKERNELTEST_H_
+#define OPENMM_LTMD_STEPKERNELTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace StepKernel {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( LinearRejectTest );
+				CPPUNIT_TEST( LinearLinearRejectTest );
+				CPPUNIT_TEST( LinearAcceptRejectTest );
+				CPPUNIT_TEST( LinearQuadraticRejectTest );
+				CPPUNIT_TEST( IntegrateRejectTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void LinearRejectTest();
+				void LinearLinearRejectTest();
+				void LinearAcceptRejectTest();
+				void LinearQuadraticRejectTest();
+				void IntegrateRejectTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_STEPKERNELTEST_H_
@@ -0,0 +1,21 @@
+#ifndef OPENMM_LTMD_STEPLENGTHCONTROLLERTEST_H_
+#define OPENMM_LTMD_STEPLENGTHCONTROLLERTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace StepLengthController {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( ObserveTest );
+				CPPUNIT_TEST( LimitsTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void ObserveTest();
+				void LimitsTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_STEPLENGTHCONTROLLERTEST_H_
@@ -0,0 +1,21 @@
+#ifndef OPENMM_LTMD_TRAJECTORYTEST_H_
+#define OPENMM_LTMD_TRAJECTORYTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace LTMD {
+	namespace Trajectory {
+		class Test : public CppUnit::TestFixture  {
+			private:
+				CPPUNIT_TEST_SUITE( Test );
+				CPPUNIT_TEST( RoundTripTest );
+				CPPUNIT_TEST( CompressionTest );
+				CPPUNIT_TEST_SUITE_END();
+			public:
+				void RoundTripTest();
+				void CompressionTest();
+		};
+	}
+}
+
+#endif // OPENMM_LTMD_TRAJECTORYTEST_H_
@@ -1,6 +1,11 @@
 #include "AnalysisTest.h"
 
 #include "LTMD/Analysis.h"
+#include "LTMD/MappedMatrix.h"
+#include "LTMD/SyntheticSystem.h"
+
+#include <algorithm>
+#include <memory>
 
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -286,5 +291,126 @@ namespace LTMD {
 				}
 			}
 		}
+
+		void Test::Shards() {
+			// Equal blocks split evenly
+			const std::vector<size_t> even( 4, 30 );
+			std::vector<size_t> shards = OpenMM::LTMD::Analysis::Shards( even, 2 );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 3, shards.size() );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 0, shards[0] );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 2, shards[1] );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 4, shards[2] );
+
+			// Never more shards than blocks
+			shards = OpenMM::LTMD::Analysis::Shards( std::vector<size_t>( 3, 30 ), 8 );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 4, shards.size() );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 1, shards[1] );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 2, shards[2] );
+
+			// A large block gets a shard of its own
+			std::vector<size_t> uneven( 5, 30 );
+			uneven[0] = 90;
+			shards = OpenMM::LTMD::Analysis::Shards( uneven, 2 );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 3, shards.size() );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 1, shards[1] );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 5, shards[2] );
+		}
+
+		// One residue per block of a small synthetic system
+		static OpenMM::LTMD::Parameters Configure( const OpenMM::LTMD::SyntheticSystem &synthetic ) {
+			OpenMM::LTMD::Parameters params;
+			synthetic.Configure( params, 1, 12, 10 );
+			return params;
+		}
+
+		// Smallest squared overlap of a mode of one basis with the span of the other, 1 when
+		// both span the same modes
+		static double MinimumOverlap( const OpenMM::LTMD::ModeBasis &first, const OpenMM::LTMD::ModeBasis &second ) {
+			double retVal = 1.0;
+			for( unsigned int i = 0; i < first.Modes(); i++ ) {
+				double overlap = 0.0;
+				for( unsigned int j = 0; j < second.Modes(); j++ ) {
+					double dot = 0.0;
+					for( size_t k = 0; k < first.Degrees(); k++ ) {
+						dot += first.Mode( i )[k] * second.Mode( j )[k];
+					}
+					overlap += dot * dot;
+				}
+				retVal = std::min( retVal, overlap );
+			}
+			return retVal;
+		}
+
+		void Test::LeanMatchesFull() {
+			const OpenMM::LTMD::SyntheticSystem synthetic( 120 );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+			const OpenMM::LTMD::Parameters params = Configure( synthetic );
+
+			OpenMM::VerletIntegrator integrator( 0.001 );
+			OpenMM::Context context( *system, integrator, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+
+			OpenMM::LTMD::Analysis full, lean;
+			full.computeEigenvectorsFull( context, params );
+			lean.computeEigenvectorsLean( context, params );
+
+			const OpenMM::LTMD::ModeBasisPtr fullBasis = full.getModeBasis(), leanBasis = lean.getModeBasis();
+			CPPUNIT_ASSERT_EQUAL( fullBasis->Modes(), leanBasis->Modes() );
+			CPPUNIT_ASSERT_EQUAL( fullBasis->Degrees(), leanBasis->Degrees() );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, MinimumOverlap( *leanBasis, *fullBasis ), 1e-3 );
+		}
+
+		// Worker threads build a block system and context per shard, the serial path one for
+		// every block. Both the Lean and Full paths use the workers.
+		void Test::ShardsMatchSerial() {
+			const OpenMM::LTMD::SyntheticSystem synthetic( 120 );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Parameters serialParams = Configure( synthetic ), shardParams = Configure( synthetic );
+			shardParams.RediagonalizationWorkers = 3;
+
+			OpenMM::VerletIntegrator integrator( 0.001 );
+			OpenMM::Context context( *system, integrator, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+
+			OpenMM::LTMD::Analysis serial, sharded;
+			serial.computeEigenvectorsLean( context, serialParams );
+			sharded.computeEigenvectorsLean( context, shardParams );
+
+			const OpenMM::LTMD::ModeBasisPtr serialBasis = serial.getModeBasis(), shardBasis = sharded.getModeBasis();
+			CPPUNIT_ASSERT_EQUAL( serialBasis->Modes(), shardBasis->Modes() );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, MinimumOverlap( *shardBasis, *serialBasis ), 1e-6 );
+
+			OpenMM::LTMD::Analysis shardedFull;
+			shardedFull.computeEigenvectorsFull( context, shardParams );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, MinimumOverlap( *shardedFull.getModeBasis(), *serialBasis ), 1e-3 );
+		}
+
+		// Scratch panels a few columns wide, so S and its eigenvectors pass through several
+		void Test::OutOfCoreMatchesFull() {
+			const OpenMM::LTMD::SyntheticSystem synthetic( 120 );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Parameters params = Configure( synthetic );
+			params.ScratchPanelBytes = 16 * 1024;
+
+			OpenMM::VerletIntegrator integrator( 0.001 );
+			OpenMM::Context context( *system, integrator, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+
+			OpenMM::LTMD::Analysis full, outOfCore;
+			full.computeEigenvectors( context, params );
+
+			outOfCore.SetMethod( OpenMM::LTMD::Preference::OutOfCore );
+			outOfCore.computeEigenvectors( context, params );
+
+			const OpenMM::LTMD::ModeBasisPtr fullBasis = full.getModeBasis(), outOfCoreBasis = outOfCore.getModeBasis();
+			const size_t vectors = params.bdof * params.residue_sizes.size();
+			CPPUNIT_ASSERT( OpenMM::LTMD::MappedMatrix::PanelColumns( vectors, params.ScratchPanelBytes ) * 3 < vectors );
+
+			CPPUNIT_ASSERT_EQUAL( fullBasis->Modes(), outOfCoreBasis->Modes() );
+			CPPUNIT_ASSERT_EQUAL( fullBasis->Degrees(), outOfCoreBasis->Degrees() );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, MinimumOverlap( *outOfCoreBasis, *fullBasis ), 1e-3 );
+		}
 	}
 }
@@ -0,0 +1,75 @@
+#include "ArenaTest.h"
+
+#include "LTMD/Arena.h"
+#include "LTMD/Matrix.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Arena::Test );
+
+namespace LTMD {
+	namespace Arena {
+		void Test::ReuseTest() {
+			OpenMM::LTMD::Arena arena;
+
+			const double *first = NULL;
+			{
+				OpenMM::LTMD::Arena::Scope scope( &arena );
+				CPPUNIT_ASSERT( OpenMM::LTMD::Arena::Current() == &arena );
+
+				Matrix a( 200, 200 );
+				first = a.Column( 0 );
+				CPPUNIT_ASSERT_EQUAL( ( size_t ) 0, ( size_t ) first % OpenMM::LTMD::AlignmentBytes );
+
+				// Small requests go straight to the system
+				Matrix small( 4, 4 );
+				CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 1, arena.GetStatistics().Allocations );
+			}
+			CPPUNIT_ASSERT( OpenMM::LTMD::Arena::Current() == NULL );
+
+			const OpenMM::LTMD::Arena::Statistics freed = arena.GetStatistics();
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 0, freed.InUseBytes );
+			CPPUNIT_ASSERT( freed.PeakBytes >= 200 * 200 * sizeof( double ) );
+			CPPUNIT_ASSERT_EQUAL( freed.PeakBytes, freed.ReservedBytes );
+
+			// A much smaller matrix does not take the cached block, a slightly smaller one does
+			OpenMM::LTMD::Arena::Scope scope( &arena );
+			{
+				Matrix b( 200, 100 );
+				CPPUNIT_ASSERT( b.Column( 0 ) != first );
+			}
+
+			Matrix c( 200, 180 );
+			CPPUNIT_ASSERT( c.Column( 0 ) == first );
+
+			const OpenMM::LTMD::Arena::Statistics statistics = arena.GetStatistics();
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 3, statistics.Allocations );
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 1, statistics.Reused );
+		}
+
+		void Test::TrimTest() {
+			OpenMM::LTMD::Arena *arena = new OpenMM::LTMD::Arena;
+
+			Matrix kept;
+			{
+				OpenMM::LTMD::Arena::Scope scope( arena );
+				Matrix unused( 200, 200 );
+				kept = Matrix( 100, 100 );
+			}
+
+			// The freed block was returned since the last Trim, so it survives one Trim
+			const size_t reserved = arena->GetStatistics().ReservedBytes;
+			arena->Trim();
+			CPPUNIT_ASSERT_EQUAL( reserved, arena->GetStatistics().ReservedBytes );
+
+			arena->Trim();
+			CPPUNIT_ASSERT( arena->GetStatistics().ReservedBytes < reserved );
+			CPPUNIT_ASSERT_EQUAL( arena->GetStatistics().InUseBytes, arena->GetStatistics().ReservedBytes );
+
+			// Blocks outliving the arena are freed normally
+			delete arena;
+			kept( 99, 99 ) = 1.0;
+			kept = Matrix();
+		}
+	}
+}
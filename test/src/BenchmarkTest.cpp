@@ -0,0 +1,35 @@
+#include "BenchmarkTest.h"
+
+#include "Benchmark.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Benchmark::Test );
+
+namespace LTMD {
+	namespace Benchmark {
+		// The first body is a warm up, every later body is one sample
+		void Test::WarmUpTest() {
+			State state( 1, 5 );
+
+			unsigned int bodies = 0;
+			while( state.Running() ) {
+				bodies++;
+			}
+
+			CPPUNIT_ASSERT_EQUAL( 6u, bodies );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 5, state.Samples().size() );
+
+			// Iterations are at least one
+			State single( 1, 0 );
+
+			bodies = 0;
+			while( single.Running() ) {
+				bodies++;
+			}
+
+			CPPUNIT_ASSERT_EQUAL( 2u, bodies );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 1, single.Samples().size() );
+		}
+	}
+}
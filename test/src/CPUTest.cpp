@@ -0,0 +1,140 @@
+#include "CPUTest.h"
+#include "Plugins.h"
+
+#include "LTMD/Analysis.h"
+#include "LTMD/Integrator.h"
+#include "LTMD/SyntheticSystem.h"
+
+#include <cmath>
+#include <map>
+#include <memory>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::CPU::Test );
+
+namespace LTMD {
+	namespace CPU {
+		const unsigned int Atoms = 120;
+
+		// The CPU platform evaluates some forces in single precision, so a kernel call agrees
+		// with the Reference one to within its rounding
+		const double PositionTolerance = 1e-6, VelocityTolerance = 1e-4;
+
+		// A Reference and a CPU kernel reading their parameters, modes and seed from the same
+		// integrator, each with its own context holding the same positions and velocities
+		class Kernels {
+			public:
+				Kernels() : mSynthetic( Atoms ), mSystem( mSynthetic.CreateSystem() ) {
+					RegisterCPUPlugin();
+
+					OpenMM::LTMD::Parameters params;
+					mSynthetic.Configure( params, 1, 12, 10 );
+
+					mIntegrator.reset( new OpenMM::LTMD::Integrator( 300.0, 91.0, 0.004, params ) );
+					mIntegrator->setRandomNumberSeed( 1234 );
+
+					OpenMM::VerletIntegrator verlet( 0.001 );
+					OpenMM::Context modes( *mSystem, verlet, OpenMM::Platform::getPlatformByName( "Reference" ) );
+					modes.setPositions( mSynthetic.Positions() );
+
+					OpenMM::LTMD::Analysis analysis;
+					analysis.computeEigenvectorsFull( modes, params );
+					mIntegrator->setModeBasis( analysis.getModeBasis() );
+
+					std::map<std::string, std::string> threads;
+					threads["Threads"] = "2";
+
+					mReference.reset( new StepKernelHarness( *mIntegrator ) );
+					mReferenceContext.reset( new OpenMM::Context( *mSystem, *mReference, OpenMM::Platform::getPlatformByName( "Reference" ) ) );
+
+					mCPU.reset( new StepKernelHarness( *mIntegrator ) );
+					mCPUContext.reset( new OpenMM::Context( *mSystem, *mCPU, OpenMM::Platform::getPlatformByName( "CPU" ), threads ) );
+
+					std::vector<OpenMM::Vec3> velocities( Atoms );
+					for( unsigned int i = 0; i < Atoms; i++ ) {
+						velocities[i] = OpenMM::Vec3( std::sin( 1.0 + i ), std::cos( 2.0 * i ), std::sin( 0.5 * i ) ) * 0.5;
+					}
+
+					mReferenceContext->setPositions( mSynthetic.Positions() );
+					mReferenceContext->setVelocities( velocities );
+					mCPUContext->setPositions( mSynthetic.Positions() );
+					mCPUContext->setVelocities( velocities );
+
+					mReference->Kernel().AcceptStep( mReference->Context() );
+					mCPU->Kernel().AcceptStep( mCPU->Context() );
+				}
+
+				const OpenMM::LTMD::Integrator &Integrator() const {
+					return *mIntegrator;
+				}
+
+				StepKernelHarness &Reference() {
+					return *mReference;
+				}
+
+				StepKernelHarness &CPU() {
+					return *mCPU;
+				}
+
+				void Compare() const {
+					const int types = OpenMM::State::Positions | OpenMM::State::Velocities;
+					const OpenMM::State reference = mReferenceContext->getState( types ), cpu = mCPUContext->getState( types );
+
+					for( unsigned int i = 0; i < Atoms; i++ ) {
+						for( unsigned int j = 0; j < 3; j++ ) {
+							CPPUNIT_ASSERT_DOUBLES_EQUAL( reference.getPositions()[i][j], cpu.getPositions()[i][j], PositionTolerance );
+							CPPUNIT_ASSERT_DOUBLES_EQUAL( reference.getVelocities()[i][j], cpu.getVelocities()[i][j], VelocityTolerance );
+						}
+					}
+				}
+			private:
+				const OpenMM::LTMD::SyntheticSystem mSynthetic;
+				std::unique_ptr<OpenMM::System> mSystem;
+				std::unique_ptr<OpenMM::LTMD::Integrator> mIntegrator;
+				std::unique_ptr<StepKernelHarness> mReference, mCPU;
+				std::unique_ptr<OpenMM::Context> mReferenceContext, mCPUContext;
+		};
+
+		void Test::IntegrateTest() {
+			Kernels kernels;
+
+			kernels.Reference().Forces();
+			kernels.Reference().Kernel().Integrate( kernels.Reference().Context(), kernels.Integrator() );
+
+			kernels.CPU().Forces();
+			kernels.CPU().Kernel().Integrate( kernels.CPU().Context(), kernels.Integrator() );
+
+			kernels.Compare();
+		}
+
+		void Test::LinearMinimizeTest() {
+			Kernels kernels;
+
+			const double referenceEnergy = kernels.Reference().Forces();
+			kernels.Reference().Kernel().LinearMinimize( kernels.Reference().Context(), kernels.Integrator(), referenceEnergy );
+
+			const double cpuEnergy = kernels.CPU().Forces();
+			kernels.CPU().Kernel().LinearMinimize( kernels.CPU().Context(), kernels.Integrator(), cpuEnergy );
+
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( referenceEnergy, cpuEnergy, 1e-4 * std::fabs( referenceEnergy ) );
+			kernels.Compare();
+		}
+
+		// The quadratic fit divides an energy difference by the step, so its rounding is
+		// compared relative to the step length it returns
+		void Test::QuadraticMinimizeTest() {
+			Kernels kernels;
+
+			kernels.Reference().Kernel().LinearMinimize( kernels.Reference().Context(), kernels.Integrator(), kernels.Reference().Forces() );
+			const double referenceLambda = kernels.Reference().Kernel().QuadraticMinimize( kernels.Reference().Context(), kernels.Integrator(), kernels.Reference().Forces() );
+
+			kernels.CPU().Kernel().LinearMinimize( kernels.CPU().Context(), kernels.Integrator(), kernels.CPU().Forces() );
+			const double cpuLambda = kernels.CPU().Kernel().QuadraticMinimize( kernels.CPU().Context(), kernels.Integrator(), kernels.CPU().Forces() );
+
+			CPPUNIT_ASSERT( referenceLambda > 0.0 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( referenceLambda, cpuLambda, 1e-2 * referenceLambda );
+			kernels.Compare();
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#include "EnsembleTest.h"
+#include "Plugins.h"
+
+#include "LTMD/Ensemble.h"
+#include "LTMD/SyntheticSystem.h"
+
+#include <memory>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Ensemble::Test );
+
+namespace LTMD {
+	namespace Ensemble {
+		const unsigned int Atoms = 120, Replicas = 3;
+
+		// One residue per block, with a rediagonalization interval longer than any test run
+		static OpenMM::LTMD::Parameters Configure( const OpenMM::LTMD::SyntheticSystem &synthetic ) {
+			OpenMM::LTMD::Parameters params;
+			synthetic.Configure( params, 1, 12, 10 );
+			params.rediagFreq = 1000;
+			return params;
+		}
+
+		void Test::ShareBasisTest() {
+			RegisterReferencePlugin();
+
+			const OpenMM::LTMD::SyntheticSystem synthetic( Atoms );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Ensemble ensemble( *system, Configure( synthetic ), Replicas, 300.0, 91.0, 0.004, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			ensemble.SetPositions( synthetic.Positions() );
+			ensemble.ShareBasis();
+
+			const OpenMM::LTMD::ModeBasisPtr basis = ensemble.GetIntegrator( 0 ).getModeBasis();
+			CPPUNIT_ASSERT( basis );
+			CPPUNIT_ASSERT_EQUAL( 10u, basis->Modes() );
+
+			for( unsigned int i = 1; i < Replicas; i++ ) {
+				CPPUNIT_ASSERT( ensemble.GetIntegrator( i ).getModeBasis() == basis );
+			}
+		}
+
+		// Every replica completes the chunk and advances its own time
+		void Test::StepTest() {
+			RegisterReferencePlugin();
+
+			const OpenMM::LTMD::SyntheticSystem synthetic( Atoms );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Ensemble ensemble( *system, Configure( synthetic ), Replicas, 300.0, 91.0, 0.004, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			ensemble.SetPositions( synthetic.Positions() );
+
+			const unsigned int steps = 5;
+			ensemble.Step( steps );
+
+			for( unsigned int i = 0; i < Replicas; i++ ) {
+				CPPUNIT_ASSERT( ensemble.GetIntegrator( i ).getModeBasis() );
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( steps * 0.004, ensemble.GetContext( i ).getState( 0 ).getTime(), 1e-9 );
+			}
+
+			// Replicas with different seeds leave the shared start
+			const std::vector<OpenMM::Vec3> first = ensemble.GetContext( 0 ).getState( OpenMM::State::Positions ).getPositions();
+			const std::vector<OpenMM::Vec3> second = ensemble.GetContext( 1 ).getState( OpenMM::State::Positions ).getPositions();
+
+			double difference = 0.0;
+			for( size_t i = 0; i < first.size(); i++ ) {
+				const OpenMM::Vec3 delta = first[i] - second[i];
+				difference += delta.dot( delta );
+			}
+			CPPUNIT_ASSERT( difference > 0.0 );
+		}
+
+		// With a shared basis the kernel projections of the replicas are done together, each
+		// batch holding more than one replica, and the batched run matches the unbatched one
+		void Test::BatchTest() {
+			RegisterReferencePlugin();
+
+			const OpenMM::LTMD::SyntheticSystem synthetic( Atoms );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+			OpenMM::LTMD::Parameters params = Configure( synthetic );
+			params.ShouldProtoMolDiagonalize = true;
+
+			OpenMM::LTMD::Ensemble ensemble( *system, params, Replicas, 300.0, 91.0, 0.004, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			ensemble.SetPositions( synthetic.Positions() );
+			ensemble.Step( 3 );
+
+			CPPUNIT_ASSERT( ensemble.Batches() > 0 );
+			CPPUNIT_ASSERT( ensemble.BatchedProjections() > ensemble.Batches() );
+
+			// The same replica alone, from the same basis and seed, with its own projection
+			OpenMM::LTMD::Integrator integrator( 300.0, 91.0, 0.004, params );
+			integrator.setRandomNumberSeed( ensemble.GetIntegrator( 1 ).getRandomNumberSeed() );
+			OpenMM::Context context( *system, integrator, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+			integrator.setModeBasis( ensemble.GetIntegrator( 0 ).getModeBasis() );
+			integrator.setBlockPreconditioner( ensemble.GetIntegrator( 0 ).getBlockPreconditioner() );
+			integrator.step( 3 );
+
+			const std::vector<OpenMM::Vec3> batched = ensemble.GetContext( 1 ).getState( OpenMM::State::Positions ).getPositions();
+			const std::vector<OpenMM::Vec3> alone = context.getState( OpenMM::State::Positions ).getPositions();
+			for( size_t i = 0; i < batched.size(); i++ ) {
+				for( unsigned int j = 0; j < 3; j++ ) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( alone[i][j], batched[i][j], 1e-6 );
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,136 @@
+#include "IntegratorTest.h"
+#include "Plugins.h"
+
+#include "LTMD/Integrator.h"
+#include "LTMD/SyntheticSystem.h"
+
+#include <cmath>
+#include <memory>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Integrator::Test );
+
+namespace LTMD {
+	namespace Integrator {
+		const unsigned int Atoms = 120, Steps = 5;
+
+		struct Run {
+			std::vector<OpenMM::Vec3> Positions;
+			std::vector<unsigned int> History;
+			unsigned int ForceEvaluations, EnergyEvaluations, Avoided;
+		};
+
+		// Steps the synthetic system on the Reference platform from fixed positions, velocities
+		// and seed
+		static Run Simulate( const OpenMM::LTMD::SyntheticSystem &synthetic, const OpenMM::LTMD::Parameters &params ) {
+			RegisterReferencePlugin();
+
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Integrator integrator( 300.0, 91.0, 0.004, params );
+			integrator.setRandomNumberSeed( 1234 );
+
+			OpenMM::Context context( *system, integrator, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			context.setPositions( synthetic.Positions() );
+
+			std::vector<OpenMM::Vec3> velocities( synthetic.Atoms() );
+			for( unsigned int i = 0; i < synthetic.Atoms(); i++ ) {
+				velocities[i] = OpenMM::Vec3( std::sin( 1.0 + i ), std::cos( 2.0 * i ), std::sin( 0.5 * i ) ) * 0.5;
+			}
+			context.setVelocities( velocities );
+
+			integrator.step( Steps );
+
+			Run retVal;
+			retVal.Positions = context.getState( OpenMM::State::Positions ).getPositions();
+			retVal.History = integrator.getMinimizationHistory();
+			retVal.ForceEvaluations = integrator.getForceEvaluations();
+			retVal.EnergyEvaluations = integrator.getEnergyEvaluations();
+			retVal.Avoided = integrator.getForceEvaluationsAvoided();
+			return retVal;
+		}
+
+		struct Relaxation {
+			double Initial, Final;
+			unsigned int ForceEvaluations, PartialEvaluations;
+		};
+
+		// Minimizes the synthetic system on the Reference platform from its starting structure,
+		// strained so the bonded terms have something to relax
+		static Relaxation Minimize( const OpenMM::LTMD::SyntheticSystem &synthetic, const OpenMM::LTMD::Parameters &params ) {
+			RegisterReferencePlugin();
+
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Integrator integrator( 300.0, 91.0, 0.004, params );
+			OpenMM::Context context( *system, integrator, OpenMM::Platform::getPlatformByName( "Reference" ) );
+
+			std::vector<OpenMM::Vec3> positions = synthetic.Positions();
+			for( unsigned int i = 0; i < positions.size(); i++ ) {
+				positions[i] += OpenMM::Vec3( std::sin( 3.0 * i ), std::cos( 5.0 * i ), std::sin( 7.0 * i ) ) * 0.01;
+			}
+			context.setPositions( positions );
+
+			Relaxation retVal;
+			retVal.Initial = context.getState( OpenMM::State::Energy ).getPotentialEnergy();
+			integrator.minimize( params.MaximumMinimizationIterations, params.MaximumMinimizationIterations );
+			retVal.Final = context.getState( OpenMM::State::Energy ).getPotentialEnergy();
+			retVal.ForceEvaluations = integrator.getForceEvaluations();
+			retVal.PartialEvaluations = integrator.getPartialForceEvaluations();
+			return retVal;
+		}
+
+		// Energy only trials change which evaluations compute forces, not the trajectory. The
+		// L-BFGS line search rejects trial points, with a small limit keeping it iterating.
+		void Test::EnergyOnlyTrialsTest() {
+			const OpenMM::LTMD::SyntheticSystem synthetic( Atoms );
+
+			OpenMM::LTMD::Parameters params;
+			synthetic.Configure( params, 1, 12, 10 );
+			params.Minimizer = OpenMM::LTMD::Preference::LBFGS;
+			params.minLimit = 1e-3;
+
+			const Run full = Simulate( synthetic, params );
+
+			params.ShouldUseEnergyOnlyTrials = true;
+			const Run trials = Simulate( synthetic, params );
+
+			CPPUNIT_ASSERT( full.History == trials.History );
+			CPPUNIT_ASSERT_EQUAL( full.Positions.size(), trials.Positions.size() );
+			for( size_t i = 0; i < full.Positions.size(); i++ ) {
+				for( unsigned int j = 0; j < 3; j++ ) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( full.Positions[i][j], trials.Positions[i][j], 1e-10 );
+				}
+			}
+
+			CPPUNIT_ASSERT_EQUAL( 0u, full.EnergyEvaluations );
+			CPPUNIT_ASSERT_EQUAL( 0u, full.Avoided );
+			CPPUNIT_ASSERT( trials.EnergyEvaluations > 0 );
+			CPPUNIT_ASSERT( trials.Avoided > 0 );
+			CPPUNIT_ASSERT( trials.ForceEvaluations < full.ForceEvaluations );
+		}
+
+		// Relaxing the bonded group between evaluations of every group still lowers the full
+		// energy, with fewer of those evaluations than minimizing every group throughout
+		void Test::SplitMinimizationTest() {
+			const OpenMM::LTMD::SyntheticSystem synthetic( Atoms );
+
+			OpenMM::LTMD::Parameters params;
+			synthetic.Configure( params, 1, 12, 10 );
+
+			const Relaxation full = Minimize( synthetic, params );
+
+			params.InnerMinimizationGroups = 1 << OpenMM::LTMD::SyntheticSystem::BondedGroup;
+			const Relaxation split = Minimize( synthetic, params );
+
+			CPPUNIT_ASSERT( full.Final < full.Initial );
+			CPPUNIT_ASSERT( split.Final < split.Initial );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( full.Initial, split.Initial, 1e-9 * std::fabs( full.Initial ) );
+
+			CPPUNIT_ASSERT_EQUAL( 0u, full.PartialEvaluations );
+			CPPUNIT_ASSERT( split.PartialEvaluations > 0 );
+			CPPUNIT_ASSERT( split.ForceEvaluations < full.ForceEvaluations );
+		}
+	}
+}
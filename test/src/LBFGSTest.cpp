@@ -0,0 +1,162 @@
+#include "LBFGSTest.h"
+
+#include "LTMD/BlockPreconditioner.h"
+#include "LTMD/LBFGS.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::LBFGS::Test );
+
+namespace LTMD {
+	namespace LBFGS {
+		const unsigned int Size = 20;
+
+		// Diagonal quadratic with curvatures spanning three orders of magnitude
+		static double Curvature( const unsigned int i ) {
+			return std::pow( 1000.0, ( double ) i / ( Size - 1 ) );
+		}
+
+		// With no history the direction is the scaled negative gradient
+		void Test::InitialScaleTest() {
+			OpenMM::LTMD::LBFGS lbfgs( 5 );
+			lbfgs.SetInitialScale( 0.5 );
+
+			std::vector<double> gradient( Size ), direction;
+			for( unsigned int i = 0; i < Size; i++ ) {
+				gradient[i] = i + 1.0;
+			}
+
+			lbfgs.Direction( gradient, direction );
+			for( unsigned int i = 0; i < Size; i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( -0.5 * gradient[i], direction[i], 1e-12 );
+			}
+
+			// Pairs without positive curvature are rejected
+			std::vector<double> s( Size, 1.0 ), y( Size, -1.0 );
+			CPPUNIT_ASSERT( !lbfgs.Update( s, y ) );
+			CPPUNIT_ASSERT_EQUAL( 0u, lbfgs.Size() );
+		}
+
+		// The updated inverse Hessian must map the newest gradient change back to its step
+		void Test::SecantTest() {
+			OpenMM::LTMD::LBFGS lbfgs( 3 );
+
+			for( unsigned int k = 0; k < 5; k++ ) {
+				std::vector<double> s( Size ), y( Size );
+				for( unsigned int i = 0; i < Size; i++ ) {
+					s[i] = std::sin( 1.0 + i * ( k + 1.0 ) );
+					y[i] = Curvature( i ) * s[i];
+				}
+				CPPUNIT_ASSERT( lbfgs.Update( s, y ) );
+
+				std::vector<double> direction;
+				lbfgs.Direction( y, direction );
+				for( unsigned int i = 0; i < Size; i++ ) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( -s[i], direction[i], 1e-9 );
+				}
+			}
+			CPPUNIT_ASSERT_EQUAL( 3u, lbfgs.Size() );
+		}
+
+		// Exact line searches on a quadratic must converge in far fewer iterations than
+		// steepest descent needs for this conditioning
+		void Test::QuadraticTest() {
+			OpenMM::LTMD::LBFGS lbfgs( 10 );
+			lbfgs.SetInitialScale( 1.0 / Curvature( Size - 1 ) );
+
+			std::vector<double> x( Size, 1.0 ), gradient( Size ), direction, step( Size ), change( Size );
+			for( unsigned int i = 0; i < Size; i++ ) {
+				gradient[i] = Curvature( i ) * x[i];
+			}
+
+			unsigned int iterations = 0;
+			while( std::sqrt( OpenMM::LTMD::LBFGS::Dot( gradient, gradient ) ) > 1e-8 && iterations < 100 ) {
+				lbfgs.Direction( gradient, direction );
+
+				double curvature = 0.0;
+				for( unsigned int i = 0; i < Size; i++ ) {
+					curvature += direction[i] * Curvature( i ) * direction[i];
+				}
+				const double alpha = -OpenMM::LTMD::LBFGS::Dot( direction, gradient ) / curvature;
+
+				for( unsigned int i = 0; i < Size; i++ ) {
+					step[i] = alpha * direction[i];
+					x[i] += step[i];
+					change[i] = Curvature( i ) * step[i];
+					gradient[i] += change[i];
+				}
+				lbfgs.Update( step, change );
+
+				iterations++;
+			}
+
+			CPPUNIT_ASSERT( iterations < 40 );
+			for( unsigned int i = 0; i < Size; i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, x[i], 1e-8 );
+			}
+		}
+
+		// Without history the preconditioned direction is the Newton step of each block, with
+		// curvatures below the floor clamped
+		void Test::PreconditionerTest() {
+			const unsigned int BlockSize = 6, Blocks = 3;
+			const double Floor = 0.5;
+
+			// Rotation in the plane of the first two degrees, eigenvalues 0.1, 1, 2, ...
+			const double angle = 0.3;
+			Matrix vectors( BlockSize, BlockSize );
+			for( unsigned int i = 0; i < BlockSize; i++ ) {
+				vectors( i, i ) = 1.0;
+			}
+			vectors( 0, 0 ) = std::cos( angle );
+			vectors( 1, 0 ) = std::sin( angle );
+			vectors( 0, 1 ) = -std::sin( angle );
+			vectors( 1, 1 ) = std::cos( angle );
+
+			std::vector<double> values( BlockSize );
+			values[0] = 0.1;
+			for( unsigned int i = 1; i < BlockSize; i++ ) {
+				values[i] = i;
+			}
+
+			// Last two degrees belong to no block
+			const unsigned int degrees = BlockSize * Blocks + 2;
+			OpenMM::LTMD::BlockPreconditioner preconditioner( degrees, Blocks );
+			for( unsigned int b = 0; b < Blocks; b++ ) {
+				preconditioner.SetBlock( b, b * BlockSize, values, vectors );
+			}
+			preconditioner.SetFloor( Floor );
+
+			std::vector<double> gradient( degrees ), direction;
+			for( unsigned int i = 0; i < degrees; i++ ) {
+				gradient[i] = std::sin( 2.0 + i );
+			}
+
+			OpenMM::LTMD::LBFGS lbfgs( 0 );
+			lbfgs.SetPreconditioner( &preconditioner );
+			lbfgs.Direction( gradient, direction );
+
+			for( unsigned int b = 0; b < Blocks; b++ ) {
+				for( unsigned int j = 0; j < BlockSize; j++ ) {
+					double expected = 0.0;
+					for( unsigned int k = 0; k < BlockSize; k++ ) {
+						double coefficient = 0.0;
+						for( unsigned int l = 0; l < BlockSize; l++ ) {
+							coefficient += vectors( l, k ) * gradient[b * BlockSize + l];
+						}
+						expected -= vectors( j, k ) * coefficient / std::max( values[k], Floor );
+					}
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( expected, direction[b * BlockSize + j], 1e-12 );
+				}
+			}
+
+			for( unsigned int i = BlockSize * Blocks; i < degrees; i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( -gradient[i] / Floor, direction[i], 1e-12 );
+			}
+		}
+	}
+}
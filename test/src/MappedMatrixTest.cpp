@@ -0,0 +1,69 @@
+#include "MappedMatrixTest.h"
+
+#include "LTMD/MappedMatrix.h"
+#include "openmm/OpenMMException.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::MappedMatrix::Test );
+
+namespace LTMD {
+	namespace MappedMatrix {
+		const size_t Rows = 300, Columns = 200;
+
+		// Values survive having their pages released and read back from the scratch file
+		void Test::RoundTripTest() {
+			OpenMM::LTMD::MappedMatrix matrix( Rows, Columns );
+			CPPUNIT_ASSERT_EQUAL( Rows, matrix.Rows() );
+			CPPUNIT_ASSERT_EQUAL( Columns, matrix.Columns() );
+
+			for( size_t j = 0; j < Columns; j++ ) {
+				for( size_t i = 0; i < Rows; i++ ) {
+					matrix( i, j ) = i + 0.001 * j;
+				}
+			}
+
+			matrix.Release( 0, Columns );
+			matrix.Prefetch( 0, Columns / 2 );
+
+			for( size_t j = 0; j < Columns; j++ ) {
+				for( size_t i = 0; i < Rows; i++ ) {
+					CPPUNIT_ASSERT_EQUAL( i + 0.001 * j, matrix( i, j ) );
+				}
+			}
+		}
+
+		// Columns are contiguous and follow one another
+		void Test::ColumnTest() {
+			OpenMM::LTMD::MappedMatrix matrix( Rows, Columns );
+
+			for( size_t j = 0; j < Columns; j++ ) {
+				double *column = matrix.Column( j );
+				CPPUNIT_ASSERT( column == matrix.Column( 0 ) + j * Rows );
+				for( size_t i = 0; i < Rows; i++ ) {
+					column[i] = -( double )( i * Columns + j );
+				}
+			}
+
+			const OpenMM::LTMD::MappedMatrix &constant = matrix;
+			for( size_t j = 0; j < Columns; j++ ) {
+				for( size_t i = 0; i < Rows; i++ ) {
+					CPPUNIT_ASSERT_EQUAL( -( double )( i * Columns + j ), constant( i, j ) );
+					CPPUNIT_ASSERT_EQUAL( constant( i, j ), constant.Column( j )[i] );
+				}
+			}
+		}
+
+		void Test::PanelColumnsTest() {
+			CPPUNIT_ASSERT_EQUAL( OpenMM::LTMD::MappedMatrix::PanelBytes / ( Rows * sizeof( double ) ), OpenMM::LTMD::MappedMatrix::PanelColumns( Rows ) );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 4, OpenMM::LTMD::MappedMatrix::PanelColumns( Rows, 4 * Rows * sizeof( double ) + 1 ) );
+
+			// A panel holds at least one column
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 1, OpenMM::LTMD::MappedMatrix::PanelColumns( Rows, 1 ) );
+		}
+
+		void Test::MissingDirectoryTest() {
+			CPPUNIT_ASSERT_THROW( OpenMM::LTMD::MappedMatrix( Rows, Columns, "/nonexistent/ltmd-scratch" ), OpenMM::OpenMMException );
+		}
+	}
+}
@@ -2,6 +2,8 @@
 
 #include "LTMD/Math.h"
 
+#include <cmath>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Math::Test );
@@ -70,6 +72,48 @@ namespace LTMD {
 			}
 		}
 
+		void Test::PackedEigenvalueTest() {
+			Matrix a( 5, 5 ), vectors( 5, 5 ), packedVectors( 5, 5 );
+
+			a( 0, 0 ) =  1.96; a( 1, 0 ) =  0.00; a( 2, 0 ) =  0.00; a( 3, 0 ) =  0.00; a( 4, 0 ) =  0.00;
+			a( 0, 1 ) = -6.49; a( 1, 1 ) =  3.80; a( 2, 1 ) =  0.00; a( 3, 1 ) =  0.00; a( 4, 1 ) =  0.00;
+			a( 0, 2 ) = -0.47; a( 1, 2 ) = -6.39; a( 2, 2 ) =  4.17; a( 3, 2 ) =  0.00; a( 4, 2 ) =  0.00;
+			a( 0, 3 ) = -7.20; a( 1, 3 ) =  1.50; a( 2, 3 ) = -1.51; a( 3, 3 ) =  5.70; a( 4, 3 ) =  0.00;
+			a( 0, 4 ) = -0.65; a( 1, 4 ) = -6.34; a( 2, 4 ) =  2.67; a( 3, 4 ) =  1.80; a( 4, 4 ) = -7.10;
+
+			// Only the upper triangle is set, which is all either solver reads
+			SymmetricMatrix packed( 5 );
+			for( size_t j = 0; j < 5; j++ ) {
+				for( size_t i = 0; i <= j; i++ ) {
+					packed( i, j ) = a( i, j );
+				}
+			}
+
+			std::vector<double> values( 5 ), packedValues( 5 );
+			FindEigenvalues( a, values, vectors );
+			CPPUNIT_ASSERT( FindEigenvalues( packed, packedValues, packedVectors.View() ) );
+
+			for( size_t i = 0; i < 5; i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( values[i], packedValues[i], 1e-10 );
+
+				double dot = 0.0;
+				for( size_t k = 0; k < 5; k++ ) {
+					dot += vectors( k, i ) * packedVectors( k, i );
+				}
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, fabs( dot ), 1e-10 );
+			}
+
+			// Assembling a matrix and its transpose averages them
+			SymmetricMatrix assembled( 2 );
+			assembled.Assemble( 0, 0, 2.0 );
+			assembled.Assemble( 0, 1, 1.0 );
+			assembled.Assemble( 1, 0, 3.0 );
+			assembled.Assemble( 1, 1, 4.0 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, assembled( 0, 0 ), 1e-12 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, assembled( 1, 0 ), 1e-12 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 4.0, assembled( 1, 1 ), 1e-12 );
+		}
+
 		void Test::MatrixMultiplyTest() {
 			Matrix a( 2, 3 ), b( 3, 2 ), c( 2, 2 ), expected( 2, 2 );
 
@@ -166,5 +210,77 @@ namespace LTMD {
 				}
 			}
 		}
+
+		void Test::ViewMatrixMultiplyTest() {
+			// Multiply the interior 2 x 2 blocks of larger matrices, writing into a block of c
+			Matrix a( 4, 4 ), b( 4, 4 ), c( 3, 3 );
+			for( size_t i = 0; i < 4; i++ ) {
+				for( size_t j = 0; j < 4; j++ ) {
+					a( i, j ) = 10.0 * i + j;
+					b( i, j ) = i == j ? 1.0 : 0.0;
+				}
+			}
+			b( 1, 2 ) = 2.0;
+
+			MatrixMultiply( a.View( 1, 1, 2, 2 ), false, b.View( 1, 1, 2, 2 ), false, c.View( 1, 1, 2, 2 ) );
+
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 11.0, c( 1, 1 ), 1e-12 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 34.0, c( 1, 2 ), 1e-12 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 21.0, c( 2, 1 ), 1e-12 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 64.0, c( 2, 2 ), 1e-12 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, c( 0, 0 ), 1e-12 );
+
+			// Moving leaves the source empty
+			Matrix moved( std::move( c ) );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 3, moved.Rows );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 0, c.Rows );
+			CPPUNIT_ASSERT( c.Data.empty() );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 0, ( size_t ) moved.Data.data() % OpenMM::LTMD::AlignmentBytes );
+		}
+
+		void Test::TiledRoutinesTest() {
+			// Sizes that are not a multiple of the tile
+			const size_t rows = 150, columns = 70;
+
+			Matrix a( rows, columns );
+			for( size_t i = 0; i < rows; i++ ) {
+				for( size_t j = 0; j < columns; j++ ) {
+					a( i, j ) = i * 1000.0 + j;
+				}
+			}
+
+			Matrix t( columns, rows );
+			Transpose( a.View(), t.View() );
+			for( size_t i = 0; i < rows; i++ ) {
+				for( size_t j = 0; j < columns; j++ ) {
+					CPPUNIT_ASSERT_EQUAL( a( i, j ), t( j, i ) );
+				}
+			}
+
+			std::vector<size_t> selected;
+			selected.push_back( 69 );
+			selected.push_back( 3 );
+			selected.push_back( 3 );
+			Matrix g( rows, selected.size() );
+			GatherColumns( a.View(), selected, g.View() );
+			for( size_t i = 0; i < rows; i++ ) {
+				for( size_t j = 0; j < selected.size(); j++ ) {
+					CPPUNIT_ASSERT_EQUAL( a( i, selected[j] ), g( i, j ) );
+				}
+			}
+
+			Matrix s( rows, rows );
+			for( size_t i = 0; i < rows; i++ ) {
+				for( size_t j = 0; j < rows; j++ ) {
+					s( i, j ) = i * 1000.0 + j;
+				}
+			}
+			Symmetrize( s.View() );
+			for( size_t i = 0; i < rows; i++ ) {
+				for( size_t j = 0; j < rows; j++ ) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5 * ( i * 1000.0 + j + j * 1000.0 + i ), s( i, j ), 1e-9 );
+				}
+			}
+		}
 	}
 }
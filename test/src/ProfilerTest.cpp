@@ -0,0 +1,232 @@
+#include "ProfilerTest.h"
+
+#include "LTMD/Profiler.h"
+
+#include <cctype>
+#include <set>
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Profiler::Test );
+
+namespace LTMD {
+	namespace Profiler {
+		// Minimal JSON reader, enough to check the output parses and to collect its keys
+		class Parser {
+			public:
+				Parser( const std::string &text ) : mText( text ), mPosition( 0 ) {
+
+				}
+
+				bool Parse() {
+					const bool retVal = Value();
+					Space();
+					return retVal && mPosition == mText.size();
+				}
+
+				const std::set<std::string> &Keys() const {
+					return mKeys;
+				}
+			private:
+				void Space() {
+					while( mPosition < mText.size() && isspace( ( unsigned char ) mText[mPosition] ) ) {
+						mPosition++;
+					}
+				}
+
+				bool Accept( const char c ) {
+					Space();
+					if( mPosition < mText.size() && mText[mPosition] == c ) {
+						mPosition++;
+						return true;
+					}
+					return false;
+				}
+
+				bool String( std::string &value ) {
+					if( !Accept( '"' ) ) {
+						return false;
+					}
+					while( mPosition < mText.size() && mText[mPosition] != '"' ) {
+						if( mText[mPosition] == '\\' ) {
+							mPosition++;
+						}
+						value += mText[mPosition++];
+					}
+					return Accept( '"' );
+				}
+
+				bool Number() {
+					const size_t start = mPosition;
+					while( mPosition < mText.size() && ( isdigit( ( unsigned char ) mText[mPosition] ) || std::string( "+-.eE" ).find( mText[mPosition] ) != std::string::npos ) ) {
+						mPosition++;
+					}
+					return mPosition > start;
+				}
+
+				bool Value() {
+					Space();
+					if( mPosition >= mText.size() ) {
+						return false;
+					}
+
+					std::string text;
+					switch( mText[mPosition] ) {
+						case '{':
+							return Object();
+						case '[':
+							return Array();
+						case '"':
+							return String( text );
+						default:
+							return Number();
+					}
+				}
+
+				bool Object() {
+					Accept( '{' );
+					if( Accept( '}' ) ) {
+						return true;
+					}
+					do {
+						std::string key;
+						if( !String( key ) || !Accept( ':' ) || !Value() ) {
+							return false;
+						}
+						mKeys.insert( key );
+					} while( Accept( ',' ) );
+					return Accept( '}' );
+				}
+
+				bool Array() {
+					Accept( '[' );
+					if( Accept( ']' ) ) {
+						return true;
+					}
+					do {
+						if( !Value() ) {
+							return false;
+						}
+					} while( Accept( ',' ) );
+					return Accept( ']' );
+				}
+			private:
+				std::string mText;
+				size_t mPosition;
+				std::set<std::string> mKeys;
+		};
+
+		static void Profile( OpenMM::LTMD::Profiler &profiler ) {
+			OpenMM::LTMD::Profiler::Scope outer( &profiler, "Outer" );
+			for( unsigned int i = 0; i < 3; i++ ) {
+				OpenMM::LTMD::Profiler::Scope inner( &profiler, "Inner" );
+				profiler.Count( "Iterations" );
+			}
+		}
+
+		void Test::DisabledTest() {
+			OpenMM::LTMD::Profiler profiler;
+			CPPUNIT_ASSERT( !profiler.IsEnabled() );
+
+			Profile( profiler );
+			profiler.Count( "Other", 5 );
+
+			CPPUNIT_ASSERT( profiler.Timers().empty() );
+			CPPUNIT_ASSERT( profiler.Counters().empty() );
+
+			// Nothing was recorded, so nothing appears in the trace
+			CPPUNIT_ASSERT( profiler.ToChromeTrace().find( "\"name\"" ) == std::string::npos );
+		}
+
+		// Nested scopes each record their own calls, the outer interval holds the inner ones
+		void Test::ScopeTest() {
+			OpenMM::LTMD::Profiler profiler;
+			profiler.SetEnabled( true );
+
+			Profile( profiler );
+			Profile( profiler );
+
+			const std::map<std::string, OpenMM::LTMD::Profiler::Timer> &timers = profiler.Timers();
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 2, timers.size() );
+
+			const OpenMM::LTMD::Profiler::Timer &outer = timers.find( "Outer" )->second, &inner = timers.find( "Inner" )->second;
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 2, outer.Calls );
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 6, inner.Calls );
+			CPPUNIT_ASSERT( outer.Total >= inner.Total );
+			CPPUNIT_ASSERT( inner.Minimum <= inner.Maximum );
+			CPPUNIT_ASSERT( inner.Maximum <= inner.Total );
+
+			// A stopped scope records once
+			{
+				OpenMM::LTMD::Profiler::Scope scope( &profiler, "Stopped" );
+				scope.Stop();
+			}
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 1, profiler.Timers().find( "Stopped" )->second.Calls );
+
+			profiler.Clear();
+			CPPUNIT_ASSERT( profiler.Timers().empty() );
+		}
+
+		void Test::CountTest() {
+			OpenMM::LTMD::Profiler profiler;
+			profiler.SetEnabled( true );
+
+			profiler.Count( "Evaluations" );
+			profiler.Count( "Evaluations", 4 );
+			profiler.Count( "Other", 2 );
+			Profile( profiler );
+
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 5, profiler.Counters().find( "Evaluations" )->second );
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 2, profiler.Counters().find( "Other" )->second );
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) 3, profiler.Counters().find( "Iterations" )->second );
+		}
+
+		void Test::JSONTest() {
+			OpenMM::LTMD::Profiler profiler;
+			profiler.SetEnabled( true );
+
+			// Both sections parse when empty
+			Parser empty( profiler.ToJSON() );
+			CPPUNIT_ASSERT( empty.Parse() );
+
+			Profile( profiler );
+			profiler.Count( "Quoted \"name\"" );
+
+			Parser parser( profiler.ToJSON() );
+			CPPUNIT_ASSERT( parser.Parse() );
+
+			const char *keys[] = { "timers", "counters", "Outer", "Inner", "calls", "total_ms", "min_ms", "max_ms", "Iterations", "Quoted \"name\"" };
+			for( size_t i = 0; i < sizeof( keys ) / sizeof( keys[0] ); i++ ) {
+				CPPUNIT_ASSERT( parser.Keys().count( keys[i] ) == 1 );
+			}
+		}
+
+		void Test::ChromeTraceTest() {
+			OpenMM::LTMD::Profiler profiler;
+			profiler.SetEnabled( true );
+
+			Profile( profiler );
+
+			Parser parser( profiler.ToChromeTrace() );
+			CPPUNIT_ASSERT( parser.Parse() );
+
+			const char *keys[] = { "traceEvents", "name", "ph", "pid", "tid", "ts", "dur", "args", "value" };
+			for( size_t i = 0; i < sizeof( keys ) / sizeof( keys[0] ); i++ ) {
+				CPPUNIT_ASSERT( parser.Keys().count( keys[i] ) == 1 );
+			}
+
+			// Four complete events and one counter
+			const std::string trace = profiler.ToChromeTrace();
+			size_t complete = 0, counters = 0;
+			for( size_t at = trace.find( "\"ph\":\"X\"" ); at != std::string::npos; at = trace.find( "\"ph\":\"X\"", at + 1 ) ) {
+				complete++;
+			}
+			for( size_t at = trace.find( "\"ph\":\"C\"" ); at != std::string::npos; at = trace.find( "\"ph\":\"C\"", at + 1 ) ) {
+				counters++;
+			}
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 4, complete );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 1, counters );
+		}
+	}
+}
@@ -0,0 +1,342 @@
+#include "ProjectionTest.h"
+
+#include "LTMD/ModeBasis.h"
+#include "LTMD/Projection.h"
+#include "LTMD/ProjectionBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Projection::Test );
+
+namespace LTMD {
+	namespace Projection {
+		const unsigned int Atoms = 50;
+
+		static double Uniform() {
+			return ( double ) rand() / RAND_MAX - 0.5;
+		}
+
+		// Orthonormal random modes by Gram-Schmidt
+		static std::vector<std::vector<OpenMM::Vec3> > Modes( const unsigned int count ) {
+			std::vector<std::vector<OpenMM::Vec3> > retVal( count, std::vector<OpenMM::Vec3>( Atoms ) );
+
+			for( unsigned int i = 0; i < count; i++ ) {
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					retVal[i][j] = OpenMM::Vec3( Uniform(), Uniform(), Uniform() );
+				}
+
+				for( unsigned int k = 0; k < i; k++ ) {
+					double dot = 0.0;
+					for( unsigned int j = 0; j < Atoms; j++ ) {
+						dot += retVal[i][j].dot( retVal[k][j] );
+					}
+					for( unsigned int j = 0; j < Atoms; j++ ) {
+						retVal[i][j] -= retVal[k][j] * dot;
+					}
+				}
+
+				double norm = 0.0;
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					norm += retVal[i][j].dot( retVal[i][j] );
+				}
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					retVal[i][j] *= 1.0 / std::sqrt( norm );
+				}
+			}
+
+			return retVal;
+		}
+
+		static std::vector<double> Masses() {
+			std::vector<double> retVal( Atoms );
+			for( unsigned int i = 0; i < Atoms; i++ ) {
+				retVal[i] = 1.0 + 15.0 * ( Uniform() + 0.5 );
+			}
+			return retVal;
+		}
+
+		// Direct evaluation of W^-1 Q Q^T W x
+		static std::vector<double> Expected( const std::vector<std::vector<OpenMM::Vec3> > &modes, const std::vector<double> &masses, const std::vector<double> &in, const bool massWeight ) {
+			std::vector<double> weighted( in.size() ), retVal( in.size(), 0.0 );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				const double weight = massWeight ? std::sqrt( masses[i / 3] ) : 1.0 / std::sqrt( masses[i / 3] );
+				weighted[i] = in[i] * weight;
+			}
+
+			for( size_t k = 0; k < modes.size(); k++ ) {
+				double c = 0.0;
+				for( size_t i = 0; i < in.size(); i++ ) {
+					c += modes[k][i / 3][i % 3] * weighted[i];
+				}
+				for( size_t i = 0; i < in.size(); i++ ) {
+					retVal[i] += modes[k][i / 3][i % 3] * c;
+				}
+			}
+
+			for( size_t i = 0; i < in.size(); i++ ) {
+				const double weight = massWeight ? std::sqrt( masses[i / 3] ) : 1.0 / std::sqrt( masses[i / 3] );
+				retVal[i] /= weight;
+			}
+
+			return retVal;
+		}
+
+		void Test::SubspaceTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 10 );
+			const std::vector<double> masses = Masses();
+
+			OpenMM::LTMD::Projection projection;
+			projection.SetMasses( masses );
+			projection.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+
+			std::vector<double> in( 3 * Atoms ), out( 3 * Atoms );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				in[i] = Uniform();
+			}
+
+			projection.Project( &in[0], &out[0], OpenMM::LTMD::Projection::Mass, false );
+			const std::vector<double> expected = Expected( modes, masses, in, true );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( expected[i], out[i], 1e-12 );
+			}
+
+			// Projecting twice changes nothing
+			std::vector<double> twice( 3 * Atoms );
+			projection.Project( &out[0], &twice[0], OpenMM::LTMD::Projection::Mass, false );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( out[i], twice[i], 1e-12 );
+			}
+		}
+
+		void Test::ComplimentTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 12 );
+			const std::vector<double> masses = Masses();
+
+			OpenMM::LTMD::Projection projection;
+			projection.SetMasses( masses );
+			projection.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+
+			std::vector<double> in( 3 * Atoms ), out( 3 * Atoms );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				in[i] = Uniform();
+			}
+
+			projection.Project( &in[0], &out[0], OpenMM::LTMD::Projection::InverseMass, true );
+			const std::vector<double> expected = Expected( modes, masses, in, false );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( in[i] - expected[i], out[i], 1e-12 );
+			}
+
+			// Nothing of the compliment remains in the subspace
+			std::vector<double> residual( 3 * Atoms );
+			projection.Project( &out[0], &residual[0], OpenMM::LTMD::Projection::InverseMass, false );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, residual[i], 1e-12 );
+			}
+		}
+
+		void Test::InPlaceTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 8 );
+			const std::vector<double> masses = Masses();
+
+			OpenMM::LTMD::Projection projection;
+			projection.SetMasses( masses );
+			projection.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+
+			std::vector<double> in( 3 * Atoms ), out( 3 * Atoms );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				in[i] = Uniform();
+			}
+
+			projection.Project( &in[0], &out[0], OpenMM::LTMD::Projection::Mass, true );
+			projection.Project( &in[0], &in[0], OpenMM::LTMD::Projection::Mass, true );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( out[i], in[i], 1e-14 );
+			}
+		}
+
+		// Specialized and generic kernels must agree with the direct evaluation
+		void Test::ModeCountTest() {
+			const unsigned int counts[] = { 1, 7, 8, 16, 24, 32, 33 };
+			const std::vector<double> masses = Masses();
+
+			for( unsigned int c = 0; c < sizeof( counts ) / sizeof( counts[0] ); c++ ) {
+				const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( counts[c] );
+
+				OpenMM::LTMD::Projection projection;
+				projection.SetMasses( masses );
+				projection.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+
+				std::vector<double> in( 3 * Atoms ), out( 3 * Atoms );
+				for( size_t i = 0; i < in.size(); i++ ) {
+					in[i] = Uniform();
+				}
+
+				projection.Project( &in[0], &out[0], OpenMM::LTMD::Projection::Mass, false );
+				const std::vector<double> expected = Expected( modes, masses, in, true );
+				for( size_t i = 0; i < in.size(); i++ ) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( expected[i], out[i], 1e-12 );
+				}
+			}
+		}
+
+		// Float storage of the basis must stay close to the double precision path
+		void Test::SinglePrecisionTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 16 );
+			const std::vector<double> masses = Masses();
+
+			OpenMM::LTMD::Projection full, single;
+			full.SetMasses( masses );
+			full.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+
+			single.SetMasses( masses );
+			single.SetSinglePrecision( true );
+			single.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+			CPPUNIT_ASSERT( single.IsSinglePrecision() );
+
+			std::vector<double> in( 3 * Atoms ), expected( 3 * Atoms ), out( 3 * Atoms );
+			for( size_t i = 0; i < in.size(); i++ ) {
+				in[i] = Uniform();
+			}
+
+			for( unsigned int w = 0; w < 2; w++ ) {
+				const OpenMM::LTMD::Projection::EWeight weight = ( w == 0 ) ? OpenMM::LTMD::Projection::Mass : OpenMM::LTMD::Projection::InverseMass;
+
+				for( unsigned int c = 0; c < 2; c++ ) {
+					full.Project( &in[0], &expected[0], weight, c == 1 );
+					single.Project( &in[0], &out[0], weight, c == 1 );
+
+					double difference = 0.0, magnitude = 0.0;
+					for( size_t i = 0; i < in.size(); i++ ) {
+						difference = std::max( difference, std::fabs( out[i] - expected[i] ) );
+						magnitude = std::max( magnitude, std::fabs( expected[i] ) );
+					}
+
+					CPPUNIT_ASSERT( difference <= 1e-6 * magnitude );
+				}
+			}
+		}
+
+		// Each basis is aligned, keeps its contents and carries its own version
+		void Test::BasisVersionTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 10 );
+
+			const OpenMM::LTMD::ModeBasisPtr first = OpenMM::LTMD::ModeBasis::Create( modes );
+			const OpenMM::LTMD::ModeBasisPtr second = OpenMM::LTMD::ModeBasis::Create( modes );
+			CPPUNIT_ASSERT( first->Version() != 0 );
+			CPPUNIT_ASSERT( second->Version() > first->Version() );
+
+			CPPUNIT_ASSERT_EQUAL( 10u, first->Modes() );
+			CPPUNIT_ASSERT_EQUAL( Atoms, first->Particles() );
+			for( unsigned int i = 0; i < first->Modes(); i++ ) {
+				CPPUNIT_ASSERT( ( ( size_t ) first->Mode( i ) ) % 64 == 0 );
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					for( unsigned int k = 0; k < 3; k++ ) {
+						CPPUNIT_ASSERT_DOUBLES_EQUAL( modes[i][j][k], first->Vector( i, j )[k], 0.0 );
+					}
+				}
+			}
+
+			OpenMM::LTMD::Projection projection;
+			projection.SetMasses( Masses() );
+			CPPUNIT_ASSERT( projection.Version() == 0 );
+
+			projection.SetBasis( *first );
+			CPPUNIT_ASSERT( projection.Version() == first->Version() );
+
+			projection.SetBasis( *second );
+			CPPUNIT_ASSERT( projection.Version() == second->Version() );
+		}
+
+		// One pass for several vectors, in place or not, must match projecting each alone
+		void Test::BatchTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 10 );
+			const std::vector<double> masses = Masses();
+			const size_t count = 5;
+
+			OpenMM::LTMD::Projection projection;
+			projection.SetMasses( masses );
+			projection.SetBasis( *OpenMM::LTMD::ModeBasis::Create( modes ) );
+
+			for( unsigned int mode = 0; mode < 4; mode++ ) {
+				const OpenMM::LTMD::Projection::EWeight weight = ( mode & 1 ) ? OpenMM::LTMD::Projection::InverseMass : OpenMM::LTMD::Projection::Mass;
+				const bool compliment = ( mode & 2 ) != 0;
+
+				std::vector<std::vector<double> > in( count, std::vector<double>( 3 * Atoms ) ), out( count, std::vector<double>( 3 * Atoms ) ), expected( count, std::vector<double>( 3 * Atoms ) );
+				std::vector<const double *> inputs( count );
+				std::vector<double *> outputs( count );
+				for( size_t r = 0; r < count; r++ ) {
+					for( size_t i = 0; i < in[r].size(); i++ ) {
+						in[r][i] = Uniform();
+					}
+					projection.Project( &in[r][0], &expected[r][0], weight, compliment );
+
+					// The last vector is projected in place
+					inputs[r] = &in[r][0];
+					outputs[r] = ( r + 1 == count ) ? &in[r][0] : &out[r][0];
+				}
+
+				projection.ProjectBatch( &inputs[0], &outputs[0], count, weight, compliment );
+				for( size_t r = 0; r < count; r++ ) {
+					for( size_t i = 0; i < 3 * Atoms; i++ ) {
+						CPPUNIT_ASSERT_DOUBLES_EQUAL( expected[r][i], outputs[r][i], 1e-12 );
+					}
+				}
+			}
+		}
+
+		// Participants on their own threads are projected together, a participant that leaves
+		// releases the others
+		void Test::SharedBatchTest() {
+			const std::vector<std::vector<OpenMM::Vec3> > modes = Modes( 10 );
+			const std::vector<double> masses = Masses();
+			const OpenMM::LTMD::ModeBasisPtr basis = OpenMM::LTMD::ModeBasis::Create( modes );
+			const unsigned int participants = 3, rounds = 4;
+
+			OpenMM::LTMD::Projection projection;
+			projection.SetMasses( masses );
+			projection.SetBasis( *basis );
+
+			std::vector<std::vector<double> > in( participants, std::vector<double>( 3 * Atoms ) ), out( participants, std::vector<double>( 3 * Atoms ) );
+			for( unsigned int p = 0; p < participants; p++ ) {
+				for( size_t i = 0; i < in[p].size(); i++ ) {
+					in[p][i] = Uniform();
+				}
+			}
+
+			OpenMM::LTMD::ProjectionBatch batch( masses, basis, participants, false );
+
+			// Participant p projects rounds - p times, then leaves
+			std::vector<std::thread> threads;
+			for( unsigned int p = 0; p < participants; p++ ) {
+				threads.push_back( std::thread( [&, p]() {
+					for( unsigned int r = 0; r < rounds - p; r++ ) {
+						batch.Project( &in[p][0], &out[p][0], OpenMM::LTMD::Projection::Mass, false );
+					}
+					batch.Leave();
+				} ) );
+			}
+			for( unsigned int p = 0; p < participants; p++ ) {
+				threads[p].join();
+			}
+
+			for( unsigned int p = 0; p < participants; p++ ) {
+				std::vector<double> expected( 3 * Atoms );
+				projection.Project( &in[p][0], &expected[0], OpenMM::LTMD::Projection::Mass, false );
+				for( size_t i = 0; i < expected.size(); i++ ) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL( expected[i], out[p][i], 1e-12 );
+				}
+			}
+
+			// One batch per round, holding every participant still projecting
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t ) rounds, batch.Batches() );
+			CPPUNIT_ASSERT_EQUAL( ( uint64_t )( 4 + 3 + 2 ), batch.Vectors() );
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#include "RandomTest.h"
+
+#include "LTMD/Random.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Random::Test );
+
+namespace LTMD {
+	namespace Random {
+		void Test::PhiloxKnownAnswerTest() {
+			// Random123 known answer vectors for philox4x32-10
+			const uint32_t counter[3][4] = {
+				{ 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+				{ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+				{ 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }
+			};
+
+			const uint32_t key[3][2] = {
+				{ 0x00000000, 0x00000000 },
+				{ 0xffffffff, 0xffffffff },
+				{ 0xa4093822, 0x299f31d0 }
+			};
+
+			const uint32_t expected[3][4] = {
+				{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+				{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+				{ 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+			};
+
+			for( unsigned int i = 0; i < 3; i++ ) {
+				uint32_t out[4];
+				OpenMM::LTMD::Random::Philox( counter[i], key[i], out );
+
+				for( unsigned int j = 0; j < 4; j++ ) {
+					CPPUNIT_ASSERT_EQUAL( expected[i][j], out[j] );
+				}
+			}
+		}
+
+		void Test::ReproducibleTest() {
+			OpenMM::LTMD::Random a( 1234 ), b( 1234 );
+
+			std::vector<double> first( 1001 ), second( 1001 ), other( 1001 );
+			a.FillNormal( OpenMM::LTMD::Random::Noise, 17, first );
+			b.FillNormal( OpenMM::LTMD::Random::Noise, 17, second );
+			a.FillNormal( OpenMM::LTMD::Random::Noise, 18, other );
+
+			unsigned int differences = 0;
+			for( size_t i = 0; i < first.size(); i++ ) {
+				CPPUNIT_ASSERT_EQUAL( first[i], second[i] );
+				if( first[i] != other[i] ) {
+					differences++;
+				}
+			}
+			CPPUNIT_ASSERT_EQUAL( ( unsigned int ) first.size(), differences );
+
+			// A shorter buffer is a prefix of a longer one
+			std::vector<double> prefix( 37 );
+			a.FillNormal( OpenMM::LTMD::Random::Noise, 17, prefix );
+			for( size_t i = 0; i < prefix.size(); i++ ) {
+				CPPUNIT_ASSERT_EQUAL( first[i], prefix[i] );
+			}
+		}
+
+		void Test::DistributionTest() {
+			OpenMM::LTMD::Random random( 42 );
+
+			std::vector<double> values( 300000 );
+			random.FillNormal( OpenMM::LTMD::Random::Noise, 7, values );
+
+			double mean = 0.0, variance = 0.0;
+			for( size_t i = 0; i < values.size(); i++ ) {
+				mean += values[i];
+				variance += values[i] * values[i];
+			}
+			mean /= values.size();
+			variance = variance / values.size() - mean * mean;
+
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, mean, 1e-2 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, variance, 1e-2 );
+
+			double uniform = 0.0;
+			for( uint32_t i = 0; i < 100000; i++ ) {
+				const double value = random.Uniform( OpenMM::LTMD::Random::Metropolis, 3, i );
+				CPPUNIT_ASSERT( value > 0.0 && value <= 1.0 );
+				uniform += value;
+			}
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, uniform / 100000.0, 1e-2 );
+		}
+
+		void Test::PrefillTest() {
+			OpenMM::LTMD::Random random( 99 );
+
+			std::vector<double> expected( 3000 );
+			random.FillNormal( OpenMM::LTMD::Random::Noise, 8, expected );
+
+			random.Prefill( 8, expected.size() );
+			const std::vector<double> &prefilled = random.Normal( 8, expected.size() );
+			for( size_t i = 0; i < expected.size(); i++ ) {
+				CPPUNIT_ASSERT_EQUAL( expected[i], prefilled[i] );
+			}
+
+			// A prefill for a different step must not be used
+			random.Prefill( 9, expected.size() );
+			const std::vector<double> &direct = random.Normal( 8, expected.size() );
+			for( size_t i = 0; i < expected.size(); i++ ) {
+				CPPUNIT_ASSERT_EQUAL( expected[i], direct[i] );
+			}
+		}
+	}
+}
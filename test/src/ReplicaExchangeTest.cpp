@@ -0,0 +1,83 @@
+#include "ReplicaExchangeTest.h"
+#include "Plugins.h"
+
+#include "LTMD/ReplicaExchange.h"
+#include "LTMD/SyntheticSystem.h"
+
+#include <cmath>
+#include <memory>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::ReplicaExchange::Test );
+
+namespace LTMD {
+	namespace ReplicaExchange {
+		void Test::ProbabilityTest() {
+			// Moving the lower energy to the lower temperature is always accepted, as is any
+			// exchange between equal temperatures
+			CPPUNIT_ASSERT_EQUAL( 1.0, OpenMM::LTMD::ReplicaExchange::Probability( 300.0, -90.0, 400.0, -100.0 ) );
+			CPPUNIT_ASSERT_EQUAL( 1.0, OpenMM::LTMD::ReplicaExchange::Probability( 300.0, -50.0, 300.0, -90.0 ) );
+
+			// exp( ( 1 / kT_I - 1 / kT_J ) ( E_I - E_J ) ) with k = 0.0083144621 kJ/(mol K)
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.367045416531509, OpenMM::LTMD::ReplicaExchange::Probability( 300.0, -100.0, 400.0, -90.0 ), 1e-12 );
+		}
+
+		void Test::SwapTest() {
+			RegisterReferencePlugin();
+
+			const OpenMM::LTMD::SyntheticSystem synthetic( 120 );
+			std::unique_ptr<OpenMM::System> system( synthetic.CreateSystem() );
+
+			OpenMM::LTMD::Parameters params;
+			synthetic.Configure( params, 1, 12, 10 );
+
+			std::vector<double> temperatures;
+			temperatures.push_back( 300.0 );
+			temperatures.push_back( 400.0 );
+
+			OpenMM::LTMD::ReplicaExchange exchange( *system, params, temperatures, 91.0, 0.004, OpenMM::Platform::getPlatformByName( "Reference" ) );
+			exchange.SetPositions( synthetic.Positions() );
+
+			std::vector<OpenMM::Vec3> velocities[2];
+			OpenMM::LTMD::ModeBasisPtr bases[2];
+			for( unsigned int i = 0; i < 2; i++ ) {
+				exchange.GetIntegrator( i ).Rediagonalize();
+				bases[i] = exchange.GetIntegrator( i ).getModeBasis();
+
+				exchange.GetContext( i ).setVelocitiesToTemperature( temperatures[i], 1 + i );
+				velocities[i] = exchange.GetContext( i ).getState( OpenMM::State::Velocities ).getVelocities();
+			}
+			const uint64_t versions[2] = { bases[0]->Version(), bases[1]->Version() };
+
+			exchange.Swap( 0 );
+
+			CPPUNIT_ASSERT_EQUAL( 1u, exchange.ReplicaAt( 0 ) );
+			CPPUNIT_ASSERT_EQUAL( 0u, exchange.ReplicaAt( 1 ) );
+
+			// Each replica runs at the other temperature with velocities scaled to match
+			for( unsigned int i = 0; i < 2; i++ ) {
+				const double scale = std::sqrt( temperatures[1 - i] / temperatures[i] );
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( temperatures[1 - i], exchange.GetIntegrator( i ).getTemperature(), 1e-12 );
+
+				const std::vector<OpenMM::Vec3> swapped = exchange.GetContext( i ).getState( OpenMM::State::Velocities ).getVelocities();
+				for( size_t j = 0; j < swapped.size(); j++ ) {
+					for( unsigned int k = 0; k < 3; k++ ) {
+						CPPUNIT_ASSERT_DOUBLES_EQUAL( scale * velocities[i][j][k], swapped[j][k], 1e-12 );
+					}
+				}
+			}
+
+			// The bases stay with their replicas
+			for( unsigned int i = 0; i < 2; i++ ) {
+				CPPUNIT_ASSERT( exchange.GetIntegrator( i ).getModeBasis() == bases[i] );
+				CPPUNIT_ASSERT_EQUAL( versions[i], exchange.GetIntegrator( i ).getModeBasis()->Version() );
+			}
+
+			// Swapping back restores the order
+			exchange.Swap( 0 );
+			CPPUNIT_ASSERT_EQUAL( 0u, exchange.ReplicaAt( 0 ) );
+			CPPUNIT_ASSERT_EQUAL( 1u, exchange.ReplicaAt( 1 ) );
+		}
+	}
+}
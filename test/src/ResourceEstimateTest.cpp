@@ -0,0 +1,67 @@
+#include "ResourceEstimateTest.h"
+
+#include "LTMD/ResourceEstimate.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::ResourceEstimate::Test );
+
+namespace LTMD {
+	namespace ResourceEstimate {
+		// Ten residues of 10 atoms, two per block, with 8 trailing atoms outside any residue
+		static OpenMM::LTMD::Parameters Layout() {
+			OpenMM::LTMD::Parameters params;
+			params.residue_sizes.assign( 10, 10 );
+			params.res_per_block = 2;
+			params.bdof = 12;
+			params.modes = 10;
+			return params;
+		}
+
+		void Test::BlockSizesTest() {
+			const std::vector<size_t> sizes = OpenMM::LTMD::ResourceEstimate::BlockSizes( 108, Layout() );
+
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 5, sizes.size() );
+			for( size_t i = 0; i < 4; i++ ) {
+				CPPUNIT_ASSERT_EQUAL( ( size_t ) 60, sizes[i] );
+			}
+
+			// The last block takes the trailing atoms
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 84, sizes[4] );
+
+			const OpenMM::LTMD::ResourceEstimate estimate = OpenMM::LTMD::ResourceEstimate::Calculate( 108, Layout(), 1 );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 324, estimate.Degrees );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 84, estimate.LargestBlock );
+			CPPUNIT_ASSERT_EQUAL( ( size_t ) 60, estimate.Vectors );
+		}
+
+		void Test::SelectTest() {
+			OpenMM::LTMD::ResourceEstimate estimate = OpenMM::LTMD::ResourceEstimate::Calculate( 108, Layout(), 1 );
+
+			// Lean never needs more than Full
+			CPPUNIT_ASSERT( estimate.LeanBytes <= estimate.FullBytes );
+
+			estimate.AvailableBytes = estimate.FullBytes;
+			CPPUNIT_ASSERT( estimate.Select( OpenMM::LTMD::Preference::Automatic ) );
+			CPPUNIT_ASSERT_EQUAL( OpenMM::LTMD::Preference::Full, estimate.Method );
+
+			estimate.AvailableBytes = estimate.LeanBytes;
+			CPPUNIT_ASSERT( estimate.Select( OpenMM::LTMD::Preference::Automatic ) );
+			CPPUNIT_ASSERT_EQUAL( OpenMM::LTMD::Preference::Lean, estimate.Method );
+			CPPUNIT_ASSERT( !estimate.Select( OpenMM::LTMD::Preference::Full ) );
+
+			estimate.AvailableBytes = estimate.LeanBytes - 1;
+			CPPUNIT_ASSERT( !estimate.Select( OpenMM::LTMD::Preference::Automatic ) );
+			CPPUNIT_ASSERT_EQUAL( OpenMM::LTMD::Preference::Automatic, estimate.Method );
+
+			// Out of core only holds panels of S, so it fits once they are smaller than S
+			estimate.OutOfCoreBytes = estimate.LeanBytes / 2;
+			estimate.ScratchAvailableBytes = estimate.ScratchBytes;
+			CPPUNIT_ASSERT( estimate.Select( OpenMM::LTMD::Preference::Automatic ) );
+			CPPUNIT_ASSERT_EQUAL( OpenMM::LTMD::Preference::OutOfCore, estimate.Method );
+
+			estimate.ScratchAvailableBytes = estimate.ScratchBytes - 1;
+			CPPUNIT_ASSERT( !estimate.Select( OpenMM::LTMD::Preference::Automatic ) );
+		}
+	}
+}
@@ -0,0 +1,187 @@
+#include "StepKernelTest.h"
+#include "Plugins.h"
+
+#include "LTMD/Analysis.h"
+#include "LTMD/Integrator.h"
+#include "LTMD/SyntheticSystem.h"
+
+#include <cmath>
+#include <memory>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::StepKernel::Test );
+
+namespace LTMD {
+	namespace StepKernel {
+		const unsigned int Atoms = 120;
+
+		static std::vector<std::string> Platforms() {
+			std::vector<std::string> retVal( 1, "Reference" );
+#ifdef BUILD_CPU
+			RegisterCPUPlugin();
+			retVal.push_back( "CPU" );
+#endif
+			return retVal;
+		}
+
+		// Drives one kernel through a sequence of moves, keeping a copy of the positions at
+		// each accept as the kernels did before they were double buffered
+		class Sequence {
+			public:
+				Sequence( const std::string &platform ) : mSynthetic( Atoms ), mSystem( mSynthetic.CreateSystem() ) {
+					RegisterReferencePlugin();
+
+					OpenMM::LTMD::Parameters params;
+					mSynthetic.Configure( params, 1, 12, 10 );
+
+					mIntegrator.reset( new OpenMM::LTMD::Integrator( 300.0, 91.0, 0.004, params ) );
+					mIntegrator->setRandomNumberSeed( 1234 );
+
+					// Modes from the starting structure
+					OpenMM::VerletIntegrator verlet( 0.001 );
+					OpenMM::Context modes( *mSystem, verlet, OpenMM::Platform::getPlatformByName( "Reference" ) );
+					modes.setPositions( mSynthetic.Positions() );
+
+					OpenMM::LTMD::Analysis analysis;
+					analysis.computeEigenvectorsFull( modes, params );
+					mIntegrator->setModeBasis( analysis.getModeBasis() );
+
+					mHarness.reset( new StepKernelHarness( *mIntegrator ) );
+					mContext.reset( new OpenMM::Context( *mSystem, *mHarness, OpenMM::Platform::getPlatformByName( platform ) ) );
+					mContext->setPositions( mSynthetic.Positions() );
+
+					std::vector<OpenMM::Vec3> velocities( Atoms );
+					for( unsigned int i = 0; i < Atoms; i++ ) {
+						velocities[i] = OpenMM::Vec3( std::sin( 1.0 + i ), std::cos( 2.0 * i ), std::sin( 0.5 * i ) ) * 0.5;
+					}
+					mContext->setVelocities( velocities );
+
+					Accept();
+				}
+
+				std::vector<OpenMM::Vec3> Positions() const {
+					return mContext->getState( OpenMM::State::Positions ).getPositions();
+				}
+
+				void Integrate() {
+					mHarness->Forces();
+					mHarness->Kernel().Integrate( mHarness->Context(), *mIntegrator );
+					Moved();
+				}
+
+				void Linear() {
+					mEnergy = mHarness->Forces();
+					mHarness->Kernel().LinearMinimize( mHarness->Context(), *mIntegrator, mEnergy );
+					Moved();
+				}
+
+				void Quadratic() {
+					mEnergy = mHarness->Forces();
+					mHarness->Kernel().QuadraticMinimize( mHarness->Context(), *mIntegrator, mEnergy );
+					Moved();
+				}
+
+				void Accept() {
+					mHarness->Kernel().AcceptStep( mHarness->Context() );
+					mSaved = Positions();
+				}
+
+				// Rejecting returns exactly to the copy taken at the last accept
+				void Reject() {
+					mHarness->Kernel().RejectStep( mHarness->Context() );
+
+					const std::vector<OpenMM::Vec3> positions = Positions();
+					CPPUNIT_ASSERT_EQUAL( mSaved.size(), positions.size() );
+					for( size_t i = 0; i < positions.size(); i++ ) {
+						for( unsigned int j = 0; j < 3; j++ ) {
+							CPPUNIT_ASSERT_EQUAL( mSaved[i][j], positions[i][j] );
+						}
+					}
+				}
+			private:
+				// Each move changes the positions, so a reject has something to undo
+				void Moved() {
+					const std::vector<OpenMM::Vec3> positions = Positions();
+
+					double difference = 0.0;
+					for( size_t i = 0; i < positions.size(); i++ ) {
+						const OpenMM::Vec3 delta = positions[i] - mSaved[i];
+						difference += delta.dot( delta );
+					}
+					CPPUNIT_ASSERT( difference > 0.0 );
+				}
+
+				const OpenMM::LTMD::SyntheticSystem mSynthetic;
+				std::unique_ptr<OpenMM::System> mSystem;
+				std::unique_ptr<OpenMM::LTMD::Integrator> mIntegrator;
+				std::unique_ptr<StepKernelHarness> mHarness;
+				std::unique_ptr<OpenMM::Context> mContext;
+				std::vector<OpenMM::Vec3> mSaved;
+				double mEnergy;
+		};
+
+		void Test::LinearRejectTest() {
+			const std::vector<std::string> platforms = Platforms();
+			for( size_t i = 0; i < platforms.size(); i++ ) {
+				Sequence sequence( platforms[i] );
+				sequence.Linear();
+				sequence.Reject();
+			}
+		}
+
+		void Test::LinearLinearRejectTest() {
+			const std::vector<std::string> platforms = Platforms();
+			for( size_t i = 0; i < platforms.size(); i++ ) {
+				Sequence sequence( platforms[i] );
+				sequence.Linear();
+				sequence.Linear();
+				sequence.Reject();
+
+				// The scale shrinks but the next attempt still starts from the accepted positions
+				sequence.Linear();
+				sequence.Reject();
+			}
+		}
+
+		void Test::LinearAcceptRejectTest() {
+			const std::vector<std::string> platforms = Platforms();
+			for( size_t i = 0; i < platforms.size(); i++ ) {
+				Sequence sequence( platforms[i] );
+				sequence.Linear();
+				sequence.Accept();
+				sequence.Reject();
+
+				sequence.Linear();
+				sequence.Reject();
+			}
+		}
+
+		void Test::LinearQuadraticRejectTest() {
+			const std::vector<std::string> platforms = Platforms();
+			for( size_t i = 0; i < platforms.size(); i++ ) {
+				Sequence sequence( platforms[i] );
+				sequence.Linear();
+				sequence.Quadratic();
+				sequence.Reject();
+			}
+		}
+
+		// The integrator moves before minimizing, so a reject after accepting the last
+		// minimization and then integrating returns to the minimized positions
+		void Test::IntegrateRejectTest() {
+			const std::vector<std::string> platforms = Platforms();
+			for( size_t i = 0; i < platforms.size(); i++ ) {
+				Sequence sequence( platforms[i] );
+				sequence.Integrate();
+				sequence.Reject();
+
+				sequence.Linear();
+				sequence.Accept();
+				sequence.Integrate();
+				sequence.Linear();
+				sequence.Reject();
+			}
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#include "StepLengthControllerTest.h"
+
+#include "LTMD/StepLengthController.h"
+
+#include <cmath>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::StepLengthController::Test );
+
+namespace LTMD {
+	namespace StepLengthController {
+		// On a quadratic the fit returns the exact line minimum, after a few fits the linear
+		// trial lands on it
+		void Test::ObserveTest() {
+			const double curvature = 1.0e5;
+
+			OpenMM::LTMD::StepLengthController controller;
+			controller.Reset( 4.34e5, 4.34e3, 5.0e6 );
+
+			for( unsigned int i = 0; i < 10; i++ ) {
+				controller.Observe( 1.0 / curvature );
+			}
+
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0 / curvature, controller.Step(), 1e-2 / curvature );
+
+			// Noisy fits settle on their geometric mean
+			for( unsigned int i = 0; i < 40; i++ ) {
+				controller.Observe( ( i % 2 == 0 ? 2.0 : 0.5 ) / curvature );
+			}
+
+			CPPUNIT_ASSERT( controller.Curvature() > 0.5 * curvature && controller.Curvature() < 2.0 * curvature );
+		}
+
+		void Test::LimitsTest() {
+			OpenMM::LTMD::StepLengthController controller;
+			controller.Reset( 100.0, 10.0, 1000.0 );
+
+			controller.Reject();
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 200.0, controller.Curvature(), 1e-12 );
+
+			controller.Accept();
+			CPPUNIT_ASSERT( controller.Curvature() < 200.0 );
+
+			// Fits that are not a step are ignored
+			const double before = controller.Curvature();
+			controller.Observe( 0.0 );
+			controller.Observe( -1.0 );
+			controller.Observe( NAN );
+			CPPUNIT_ASSERT_EQUAL( before, controller.Curvature() );
+
+			for( unsigned int i = 0; i < 10; i++ ) {
+				controller.Reject();
+			}
+			CPPUNIT_ASSERT_EQUAL( 1000.0, controller.Curvature() );
+
+			controller.Observe( 1.0 );
+			controller.Observe( 1.0 );
+			controller.Observe( 1.0 );
+			controller.Observe( 1.0 );
+			CPPUNIT_ASSERT_EQUAL( 10.0, controller.Curvature() );
+		}
+	}
+}
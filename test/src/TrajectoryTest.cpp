@@ -0,0 +1,136 @@
+#include "TrajectoryTest.h"
+
+#include "LTMD/Trajectory.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LTMD::Trajectory::Test );
+
+namespace LTMD {
+	namespace Trajectory {
+		const unsigned int Atoms = 40, Modes = 6, Frames = 200;
+		const double Precision = 1e-4;
+		const char *Filename = "TrajectoryTest.ltmd";
+
+		static double Uniform() {
+			return ( double ) rand() / RAND_MAX - 0.5;
+		}
+
+		static std::vector<double> Masses() {
+			std::vector<double> retVal( Atoms );
+			for( unsigned int i = 0; i < Atoms; i++ ) {
+				retVal[i] = 1.0 + 15.0 * ( i % 4 );
+			}
+			return retVal;
+		}
+
+		// Random orthonormal modes, as rediagonalization produces
+		static OpenMM::LTMD::ModeBasisPtr Basis() {
+			std::vector<std::vector<OpenMM::Vec3> > modes( Modes, std::vector<OpenMM::Vec3>( Atoms ) );
+			for( unsigned int i = 0; i < Modes; i++ ) {
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					modes[i][j] = OpenMM::Vec3( Uniform(), Uniform(), Uniform() );
+				}
+
+				for( unsigned int k = 0; k < i; k++ ) {
+					double dot = 0.0;
+					for( unsigned int j = 0; j < Atoms; j++ ) {
+						dot += modes[i][j].dot( modes[k][j] );
+					}
+					for( unsigned int j = 0; j < Atoms; j++ ) {
+						modes[i][j] -= modes[k][j] * dot;
+					}
+				}
+
+				double norm = 0.0;
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					norm += modes[i][j].dot( modes[i][j] );
+				}
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					modes[i][j] *= 1.0 / std::sqrt( norm );
+				}
+			}
+			return OpenMM::LTMD::ModeBasis::Create( modes );
+		}
+
+		// Frames moving along the modes with a small motion outside them, rediagonalized
+		// part way through
+		static void Write( OpenMM::LTMD::TrajectoryWriter &writer, std::vector<std::vector<OpenMM::Vec3> > &frames ) {
+			const std::vector<double> masses = Masses();
+			OpenMM::LTMD::ModeBasisPtr basis = Basis();
+
+			std::vector<OpenMM::Vec3> positions( Atoms );
+			for( unsigned int j = 0; j < Atoms; j++ ) {
+				positions[j] = OpenMM::Vec3( Uniform(), Uniform(), Uniform() ) * 5.0;
+			}
+
+			for( unsigned int f = 0; f < Frames; f++ ) {
+				if( f == Frames / 2 ) {
+					basis = Basis();
+				}
+
+				for( unsigned int k = 0; k < Modes; k++ ) {
+					const double amplitude = 0.05 * Uniform();
+					for( unsigned int j = 0; j < Atoms; j++ ) {
+						positions[j] += basis->Vector( k, j ) * ( amplitude / std::sqrt( masses[j] ) );
+					}
+				}
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					positions[j] += OpenMM::Vec3( Uniform(), Uniform(), Uniform() ) * 1e-4;
+				}
+
+				writer.WriteFrame( 0.1 * f, positions, basis );
+				frames.push_back( positions );
+			}
+		}
+
+		void Test::RoundTripTest() {
+			std::vector<std::vector<OpenMM::Vec3> > frames;
+			{
+				OpenMM::LTMD::TrajectoryWriter writer( Filename, Masses(), Precision, 10 );
+				Write( writer, frames );
+				CPPUNIT_ASSERT_EQUAL( Frames, writer.Frames() );
+			}
+
+			OpenMM::LTMD::TrajectoryReader reader( Filename );
+			CPPUNIT_ASSERT_EQUAL( Atoms, reader.Particles() );
+
+			double time = 0.0;
+			std::vector<OpenMM::Vec3> positions;
+			for( unsigned int f = 0; f < Frames; f++ ) {
+				CPPUNIT_ASSERT( reader.ReadFrame( time, positions ) );
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1 * f, time, 0.0 );
+
+				for( unsigned int j = 0; j < Atoms; j++ ) {
+					for( unsigned int k = 0; k < 3; k++ ) {
+						CPPUNIT_ASSERT_DOUBLES_EQUAL( frames[f][j][k], positions[j][k], 0.5 * Precision * ( 1.0 + 1e-6 ) );
+					}
+				}
+			}
+			CPPUNIT_ASSERT( !reader.ReadFrame( time, positions ) );
+			CPPUNIT_ASSERT_EQUAL( Modes, reader.Modes() );
+
+			std::remove( Filename );
+		}
+
+		// Motion along the modes must cost a tenth of storing the coordinates, including both
+		// bases and their keyframes
+		void Test::CompressionTest() {
+			std::vector<std::vector<OpenMM::Vec3> > frames;
+
+			OpenMM::LTMD::TrajectoryWriter writer( Filename, Masses(), Precision, 100 );
+			Write( writer, frames );
+			writer.Close();
+
+			const double raw = ( double ) Frames * Atoms * 3 * sizeof( double );
+			CPPUNIT_ASSERT( writer.BytesWritten() * 10 < raw );
+
+			std::remove( Filename );
+		}
+	}
+}